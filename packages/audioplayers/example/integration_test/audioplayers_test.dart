@@ -1,10 +1,74 @@
 import 'dart:async';
+import 'dart:io';
+import 'dart:typed_data';
 
 import 'package:audioplayers/audioplayers.dart';
+import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:integration_test/integration_test.dart';
 
 const Duration _kPlayDuration = Duration(seconds: 1);
+const int _kConcurrentPlayers = 16;
+// Longer than the time the low latency output used to stay prepared while
+// silent.
+const Duration _kIdleDuration = Duration(seconds: 2);
+const MethodChannel _kChannel = MethodChannel('xyz.luan/audioplayers');
+
+Future<int> _waitForPosition(AudioPlayer player, int after) async {
+  for (var i = 0; i < 100; i++) {
+    final position = await player.getCurrentPosition();
+    if (position > after) {
+      return position;
+    }
+    await Future<void>.delayed(const Duration(milliseconds: 10));
+  }
+  fail('position did not advance past $after ms');
+}
+
+/// Serves the bytes of an asset at any path on the loopback interface, and
+/// counts the requests for each path.
+class _AudioServer {
+  _AudioServer._(this._server, this._bytes) {
+    _server.listen((HttpRequest request) {
+      final path = request.uri.path;
+      requests[path] = (requests[path] ?? 0) + 1;
+      request.response
+        ..headers.contentType = ContentType('audio', 'mpeg')
+        ..contentLength = _bytes.length
+        ..add(_bytes)
+        ..close();
+    });
+  }
+
+  static Future<_AudioServer> start(String asset) async {
+    final data = await rootBundle.load(asset);
+    final server = await HttpServer.bind(InternetAddress.loopbackIPv4, 0);
+    return _AudioServer._(server, data.buffer.asUint8List());
+  }
+
+  final HttpServer _server;
+  final Uint8List _bytes;
+  final Map<String, int> requests = <String, int>{};
+
+  int get size => _bytes.length;
+
+  /// A url that was never cached before, as the cache outlives the app.
+  String newUrl(String name) {
+    final id = DateTime.now().microsecondsSinceEpoch;
+    return 'http://127.0.0.1:${_server.port}/$id/$name';
+  }
+
+  Future<void> close() => _server.close(force: true);
+}
+
+Future<Map<Object?, Object?>> _getCacheStats() async =>
+    (await _kChannel.invokeMethod<Map<Object?, Object?>>('getCacheStats'))!;
+
+Future<void> _prefetch(String url) =>
+    _kChannel.invokeMethod<int>('prefetch', <String, dynamic>{'url': url});
+
+Future<void> _setCacheSize(int size) => _kChannel
+    .invokeMethod<int>('setCacheSize', <String, dynamic>{'size': size});
 
 void main() {
   IntegrationTestWidgetsFlutterBinding.ensureInitialized();
@@ -127,5 +191,162 @@ void main() {
 
       await player.dispose();
     });
+
+    testWidgets('drop late events of replaced sources',
+        (WidgetTester tester) async {
+      final audioCache = AudioCache();
+      final firstUri = await audioCache.load('audio.mp3');
+      final secondUri = await audioCache.load('audio2.mp3');
+      final players =
+          List<AudioPlayer>.generate(_kConcurrentPlayers, (_) => AudioPlayer());
+      final seekCounts = List<int>.filled(players.length, 0);
+      for (var i = 0; i < players.length; i++) {
+        players[i].onSeekComplete.listen((event) => seekCounts[i]++);
+      }
+
+      // Replace each source while the previous one is still being prepared.
+      await Future.wait(players.map((player) async {
+        await player.setUrl(firstUri.toString());
+        await player.setUrl(secondUri.toString());
+      }));
+      await Future.wait(players.map((player) => player.seek(_kPlayDuration)));
+      await Future<void>.delayed(_kPlayDuration);
+
+      final expected = await players.first.getDuration();
+      expect(expected, greaterThan(0));
+      for (var i = 0; i < players.length; i++) {
+        expect(await players[i].getDuration(), expected);
+        expect(seekCounts[i], 1);
+        expect(await players[i].getCurrentPosition(),
+            _kPlayDuration.inMilliseconds);
+      }
+      await Future.wait(players.map((player) => player.dispose()));
+    });
+
+    testWidgets('can be played with low latency', (WidgetTester tester) async {
+      final player = AudioPlayer(mode: PlayerMode.LOW_LATENCY);
+      final audioCache = AudioCache();
+      final uri = await audioCache.load('audio2.mp3');
+      await player.play(uri.toString());
+      expect(player.state, PlayerState.PLAYING);
+      await _waitForPosition(player, 0);
+
+      await player.pause();
+      final pausedPosition = await player.getCurrentPosition();
+      await Future<void>.delayed(_kIdleDuration);
+      expect(await player.getCurrentPosition(), pausedPosition);
+
+      // Resumes after being silent for a while.
+      await player.resume();
+      expect(player.state, PlayerState.PLAYING);
+      await _waitForPosition(player, pausedPosition);
+
+      await player.dispose();
+    });
+
+    testWidgets('keep low latency output prepared while silent',
+        (WidgetTester tester) async {
+      await _kChannel.invokeMethod<int>(
+          'setLowLatencyIdleTimeout', <String, dynamic>{'timeout': -1});
+      final audioCache = AudioCache();
+      final uri = await audioCache.load('audio.mp3');
+      final player = AudioPlayer(mode: PlayerMode.LOW_LATENCY);
+      for (var i = 0; i < 2; i++) {
+        await player.play(uri.toString());
+        await _waitForPosition(player, 0);
+        await player.stop();
+        await Future<void>.delayed(_kIdleDuration);
+      }
+      await player.dispose();
+
+      await expectLater(
+          _kChannel.invokeMethod<int>(
+              'setLowLatencyIdleTimeout', <String, dynamic>{'timeout': '1'}),
+          throwsA(isA<PlatformException>()));
+      await _kChannel.invokeMethod<int>(
+          'setLowLatencyIdleTimeout', <String, dynamic>{'timeout': 30000});
+    });
+  });
+
+  group('remote audio cache', () {
+    late _AudioServer server;
+
+    setUp(() async {
+      server = await _AudioServer.start('assets/audio2.mp3');
+    });
+
+    tearDown(() async {
+      await _setCacheSize(64 * 1024 * 1024);
+      await server.close();
+    });
+
+    testWidgets('plays prefetched files from the cache',
+        (WidgetTester tester) async {
+      final url = server.newUrl('audio2.mp3');
+      final path = Uri.parse(url).path;
+      await _prefetch(url);
+      expect(server.requests[path], 1);
+      final stats = await _getCacheStats();
+
+      final player = AudioPlayer();
+      await player.play(url);
+      await _waitForPosition(player, 0);
+      await player.dispose();
+
+      final newStats = await _getCacheStats();
+      expect(newStats['hits'], (stats['hits']! as int) + 1);
+      expect(newStats['misses'], stats['misses']);
+      expect(newStats['bytesSaved'],
+          (stats['bytesSaved']! as int) + server.size);
+      expect(server.requests[path], 1);
+    });
+
+    testWidgets('caches files played on a miss', (WidgetTester tester) async {
+      final url = server.newUrl('audio2.mp3');
+      final path = Uri.parse(url).path;
+      final stats = await _getCacheStats();
+
+      // Streamed while the same file is downloaded into the cache.
+      final player = AudioPlayer();
+      await player.play(url);
+      await _waitForPosition(player, 0);
+      await player.dispose();
+
+      // Waits for the download started by the miss.
+      await _prefetch(url);
+      final requests = server.requests[path];
+      final newStats = await _getCacheStats();
+      expect(newStats['misses'], (stats['misses']! as int) + 1);
+      expect(newStats['size'], (stats['size']! as int) + server.size);
+
+      await _prefetch(url);
+      expect(server.requests[path], requests);
+    });
+
+    testWidgets('evicts the least recently used files',
+        (WidgetTester tester) async {
+      // Room for a single file.
+      await _setCacheSize(server.size * 3 ~/ 2);
+      final first = server.newUrl('first.mp3');
+      final second = server.newUrl('second.mp3');
+      await _prefetch(first);
+      await _prefetch(second);
+      expect((await _getCacheStats())['size'], server.size);
+
+      // The second file is still cached, but the first one is downloaded
+      // again.
+      await _prefetch(second);
+      expect(server.requests[Uri.parse(second).path], 1);
+      await _prefetch(first);
+      expect(server.requests[Uri.parse(first).path], 2);
+    });
+
+    testWidgets('does not cache files larger than the cache',
+        (WidgetTester tester) async {
+      await _setCacheSize(server.size ~/ 2);
+      final url = server.newUrl('audio2.mp3');
+      await expectLater(_prefetch(url), throwsA(isA<PlatformException>()));
+      expect((await _getCacheStats())['size'], 0);
+    });
   });
 }
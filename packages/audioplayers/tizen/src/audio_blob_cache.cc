@@ -0,0 +1,52 @@
+#include "audio_blob_cache.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "log.h"
+
+// 64-bit FNV-1a.
+static uint64_t HashBytes(const std::vector<uint8_t> &data) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint8_t byte : data) {
+    hash = (hash ^ byte) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::shared_ptr<const AudioBlob> AudioBlobCache::Intern(
+    std::vector<uint8_t> &&data) {
+  // Forget the blobs that have been freed.
+  for (auto iter = blobs_.begin(); iter != blobs_.end();) {
+    if (iter->second.expired()) {
+      iter = blobs_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  char base_key[64];
+  snprintf(base_key, sizeof(base_key), "bytes:%016" PRIx64 ":%zu",
+           HashBytes(data), data.size());
+  std::string key = base_key;
+  // On the unlikely collision with different bytes, a suffix is added so
+  // that the key still identifies the content.
+  for (int suffix = 1;; suffix++) {
+    auto iter = blobs_.find(key);
+    if (iter == blobs_.end()) {
+      break;
+    }
+    std::shared_ptr<const AudioBlob> blob = iter->second.lock();
+    if (blob->data == data) {
+      LOG_DEBUG("reuse audio blob %s", key.c_str());
+      return blob;
+    }
+    key = std::string(base_key) + "#" + std::to_string(suffix);
+  }
+
+  auto blob = std::make_shared<AudioBlob>();
+  blob->key = key;
+  blob->data = std::move(data);
+  blobs_[key] = blob;
+  return blob;
+}
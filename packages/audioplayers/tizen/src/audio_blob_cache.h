@@ -0,0 +1,33 @@
+#ifndef AUDIO_BLOB_CACHE_H_
+#define AUDIO_BLOB_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The bytes of an audio file passed from Dart. Immutable once created, and
+// shared by all players playing the same bytes.
+struct AudioBlob {
+  // Identifies the content, derived from its hash and size.
+  std::string key;
+  std::vector<uint8_t> data;
+};
+
+// Deduplicates byte sources so that identical bytes given to any number of
+// players are held in memory once. A blob is freed as soon as no player
+// refers to it anymore.
+//
+// Must only be used on the main thread.
+class AudioBlobCache {
+ public:
+  // Takes over |data| without copying it, and returns the blob holding the
+  // same bytes, either an existing one or a new one.
+  std::shared_ptr<const AudioBlob> Intern(std::vector<uint8_t> &&data);
+
+ private:
+  std::unordered_map<std::string, std::weak_ptr<const AudioBlob>> blobs_;
+};
+
+#endif  // AUDIO_BLOB_CACHE_H_
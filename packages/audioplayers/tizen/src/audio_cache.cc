@@ -0,0 +1,362 @@
+#include "audio_cache.h"
+
+#include <app_common.h>
+#include <curl/curl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "log.h"
+
+#define DEFAULT_CACHE_CAPACITY (64 * 1024 * 1024)  // bytes
+#define CONNECT_TIMEOUT 10                          // seconds
+// Downloads slower than this for LOW_SPEED_TIME seconds are given up.
+#define LOW_SPEED_LIMIT 1024  // bytes per second
+#define LOW_SPEED_TIME 30     // seconds
+#define PART_SUFFIX ".part"
+
+struct AudioCache::DownloadJob {
+  AudioCache *cache;  // null once the cache is destroyed
+  Ecore_Thread *thread = nullptr;
+  std::string url;
+  std::string name;
+  std::string path;
+  std::vector<PrefetchCallback> callbacks;
+  // The capacity of the cache when the job was started. Larger files are
+  // not downloaded any further.
+  int64_t capacity = 0;
+
+  int64_t size = 0;
+  std::string error;
+};
+
+static bool IsRemote(const std::string &url) {
+  return url.compare(0, 7, "http://") == 0 ||
+         url.compare(0, 8, "https://") == 0;
+}
+
+static bool EndsWith(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Names the cached file after a hash of |url|, keeping the extension of the
+// path so that the player can still tell the format from it.
+static std::string GetFileName(const std::string &url) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : url) {
+    hash = (hash ^ (uint8_t)c) * 1099511628211ULL;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016" PRIx64, hash);
+
+  std::string path = url.substr(0, url.find_first_of("?#"));
+  size_t slash = path.rfind('/');
+  size_t dot = path.rfind('.');
+  std::string extension;
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+    extension = path.substr(dot);
+  }
+  bool valid = extension.size() > 1 && extension.size() <= 6 &&
+               std::all_of(extension.begin() + 1, extension.end(),
+                           [](char c) { return isalnum((unsigned char)c); });
+  return valid ? name + extension : name;
+}
+
+struct TransferState {
+  Ecore_Thread *thread;
+  int64_t capacity;
+  bool too_large = false;
+};
+
+static size_t WriteToFile(char *data, size_t size, size_t count,
+                          void *user_data) {
+  return fwrite(data, size, count, (FILE *)user_data);
+}
+
+// Aborts the transfer once the job has been cancelled, or once it has
+// downloaded more than the cache can hold.
+static int CheckProgress(void *user_data, curl_off_t download_total,
+                         curl_off_t downloaded, curl_off_t upload_total,
+                         curl_off_t uploaded) {
+  TransferState *state = (TransferState *)user_data;
+  if (downloaded > state->capacity) {
+    state->too_large = true;
+    return 1;
+  }
+  return ecore_thread_check(state->thread) ? 1 : 0;
+}
+
+AudioCache::AudioCache() : capacity_(DEFAULT_CACHE_CAPACITY) {
+  // Not thread safe, so not left to the first curl_easy_init() on a download
+  // thread. Never cleaned up as download threads may outlive the cache.
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  char *path = app_get_cache_path();
+  if (path) {
+    directory_ = std::string(path) + "audioplayers/";
+    free(path);
+    if (mkdir(directory_.c_str(), 0700) != 0 && errno != EEXIST) {
+      LOG_ERROR("failed to create %s : %s", directory_.c_str(),
+                strerror(errno));
+      directory_.clear();
+    }
+  } else {
+    LOG_ERROR("app_get_cache_path failed");
+  }
+}
+
+AudioCache::~AudioCache() {
+  // Cancelling a job that has not started yet deletes it right away.
+  std::map<std::string, DownloadJob *> downloads = std::move(downloads_);
+  for (auto &entry : downloads) {
+    entry.second->cache = nullptr;
+    ecore_thread_cancel(entry.second->thread);
+  }
+}
+
+std::string AudioCache::Resolve(const std::string &url) {
+  if (!IsRemote(url) || directory_.empty()) {
+    return url;
+  }
+  LoadIndex();
+  std::string name = GetFileName(url);
+  auto iter = index_.find(name);
+  if (iter != index_.end()) {
+    std::string path = GetPath(name);
+    if (utime(path.c_str(), nullptr) == 0) {
+      entries_.splice(entries_.begin(), entries_, iter->second);
+      hits_++;
+      bytes_saved_ += iter->second->second;
+      LOG_DEBUG("play %s from cache", url.c_str());
+      return path;
+    }
+    // Removed behind our back.
+    size_ -= iter->second->second;
+    entries_.erase(iter->second);
+    index_.erase(iter);
+  }
+  misses_++;
+  Prefetch(url, nullptr);
+  return url;
+}
+
+void AudioCache::Prefetch(const std::string &url, PrefetchCallback callback) {
+  if (!IsRemote(url)) {
+    if (callback) {
+      callback(false, "only http and https urls can be cached");
+    }
+    return;
+  }
+  if (directory_.empty()) {
+    if (callback) {
+      callback(false, "no cache directory");
+    }
+    return;
+  }
+  LoadIndex();
+  std::string name = GetFileName(url);
+  if (index_.count(name)) {
+    if (callback) {
+      callback(true, "");
+    }
+    return;
+  }
+  auto iter = downloads_.find(name);
+  if (iter != downloads_.end()) {
+    if (callback) {
+      iter->second->callbacks.push_back(std::move(callback));
+    }
+    return;
+  }
+
+  LOG_DEBUG("prefetch %s", url.c_str());
+  DownloadJob *job = new DownloadJob();
+  job->cache = this;
+  job->url = url;
+  job->name = name;
+  job->path = GetPath(name);
+  job->capacity = capacity_;
+  if (callback) {
+    job->callbacks.push_back(std::move(callback));
+  }
+  downloads_[name] = job;
+  Ecore_Thread *thread = ecore_thread_run(RunDownloadJob, OnDownloadJobEnd,
+                                          OnDownloadJobCancel, job);
+  if (!thread) {
+    // The cancel callback has already deleted the job.
+    LOG_ERROR("failed to start a download thread");
+    return;
+  }
+  job->thread = thread;
+}
+
+void AudioCache::SetCapacity(int64_t capacity) {
+  capacity_ = capacity > 0 ? capacity : 0;
+  LoadIndex();
+  Evict();
+}
+
+// Runs on a worker thread.
+void AudioCache::RunDownloadJob(void *data, Ecore_Thread *thread) {
+  DownloadJob *job = (DownloadJob *)data;
+  std::string part_path = job->path + PART_SUFFIX;
+  FILE *file = fopen(part_path.c_str(), "wb");
+  if (!file) {
+    job->error = "failed to open " + part_path + " : " + strerror(errno);
+    return;
+  }
+
+  TransferState state = {thread, job->capacity};
+  CURL *curl = curl_easy_init();
+  CURLcode code = CURLE_WRITE_ERROR;
+  if (curl) {
+    curl_easy_setopt(curl, CURLOPT_URL, job->url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteToFile);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, file);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)CONNECT_TIMEOUT);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, (long)LOW_SPEED_LIMIT);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)LOW_SPEED_TIME);
+    // Fails before the transfer when the server announces a larger file.
+    // 0 would mean no limit, which CheckProgress() takes care of.
+    if (job->capacity > 0) {
+      curl_easy_setopt(curl, CURLOPT_MAXFILESIZE_LARGE,
+                       (curl_off_t)job->capacity);
+    }
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, CheckProgress);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &state);
+    code = curl_easy_perform(curl);
+    curl_easy_cleanup(curl);
+  }
+  bool written = fclose(file) == 0;
+
+  // The file only gets its final name once complete.
+  struct stat st;
+  if (code != CURLE_OK || !written ||
+      rename(part_path.c_str(), job->path.c_str()) != 0 ||
+      stat(job->path.c_str(), &st) != 0) {
+    if (state.too_large || code == CURLE_FILESIZE_EXCEEDED) {
+      job->error = "file is larger than the cache";
+    } else {
+      job->error = code != CURLE_OK ? curl_easy_strerror(code)
+                                    : "failed to write " + job->path;
+    }
+    unlink(part_path.c_str());
+    return;
+  }
+  job->size = st.st_size;
+}
+
+// Runs on the main thread.
+void AudioCache::OnDownloadJobEnd(void *data, Ecore_Thread *thread) {
+  DownloadJob *job = (DownloadJob *)data;
+  if (job->cache) {
+    AudioCache *cache = job->cache;
+    cache->downloads_.erase(job->name);
+    if (job->error.empty() && job->size > cache->capacity_) {
+      unlink(job->path.c_str());
+      job->error = "file is larger than the cache";
+    }
+    if (job->error.empty()) {
+      cache->AddEntry(job->name, job->size);
+      cache->Evict();
+    } else {
+      LOG_ERROR("failed to download %s : %s", job->url.c_str(),
+                job->error.c_str());
+    }
+    for (auto &callback : job->callbacks) {
+      callback(job->error.empty(), job->error);
+    }
+  }
+  // A file finished after the cache was destroyed is indexed on next start.
+  delete job;
+}
+
+// Runs on the main thread.
+void AudioCache::OnDownloadJobCancel(void *data, Ecore_Thread *thread) {
+  DownloadJob *job = (DownloadJob *)data;
+  if (job->cache) {
+    job->cache->downloads_.erase(job->name);
+    for (auto &callback : job->callbacks) {
+      callback(false, "download was cancelled");
+    }
+  }
+  delete job;
+}
+
+void AudioCache::LoadIndex() {
+  if (index_loaded_) {
+    return;
+  }
+  index_loaded_ = true;
+  DIR *dir = opendir(directory_.c_str());
+  if (!dir) {
+    LOG_ERROR("failed to open %s : %s", directory_.c_str(), strerror(errno));
+    return;
+  }
+  std::vector<std::pair<time_t, std::pair<std::string, int64_t>>> files;
+  while (struct dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    struct stat st;
+    if (name == "." || name == ".." ||
+        stat(GetPath(name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    if (EndsWith(name, PART_SUFFIX)) {
+      // Left over from an interrupted download.
+      unlink(GetPath(name).c_str());
+      continue;
+    }
+    files.push_back({st.st_mtime, {name, st.st_size}});
+  }
+  closedir(dir);
+
+  std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) {
+    return a.first > b.first;
+  });
+  for (auto &file : files) {
+    entries_.push_back(std::move(file.second));
+    index_[entries_.back().first] = std::prev(entries_.end());
+    size_ += entries_.back().second;
+  }
+  Evict();
+}
+
+void AudioCache::AddEntry(const std::string &name, int64_t size) {
+  auto iter = index_.find(name);
+  if (iter != index_.end()) {
+    size_ -= iter->second->second;
+    entries_.erase(iter->second);
+  }
+  entries_.emplace_front(name, size);
+  index_[name] = entries_.begin();
+  size_ += size;
+}
+
+void AudioCache::Evict() {
+  while (size_ > capacity_ && !entries_.empty()) {
+    const auto &entry = entries_.back();
+    LOG_DEBUG("evict %s from cache", entry.first.c_str());
+    unlink(GetPath(entry.first).c_str());
+    size_ -= entry.second;
+    index_.erase(entry.first);
+    entries_.pop_back();
+  }
+}
+
+std::string AudioCache::GetPath(const std::string &name) const {
+  return directory_ + name;
+}
@@ -0,0 +1,81 @@
+#ifndef AUDIO_CACHE_H_
+#define AUDIO_CACHE_H_
+
+#include <Ecore.h>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using PrefetchCallback =
+    std::function<void(bool success, const std::string &error)>;
+
+// Keeps remote audio files in the app's cache directory so that they are
+// downloaded once rather than on every play. Files are evicted in least
+// recently used order once the cache grows beyond its capacity. The order
+// is kept in the modification times of the files, so it survives restarts.
+//
+// Must only be used on the main thread.
+class AudioCache {
+ public:
+  AudioCache();
+  ~AudioCache();
+
+  AudioCache(const AudioCache &) = delete;
+  AudioCache &operator=(const AudioCache &) = delete;
+
+  // Returns the path of the cached copy of |url|, or |url| itself if it is
+  // not cached. A remote |url| that is not cached is prefetched in the
+  // background for the next time.
+  //
+  // On a miss the file is downloaded twice, once by the player streaming
+  // |url| and once by the prefetch. This is deliberate: waiting for the
+  // download would delay the start of playback by the whole file, and a
+  // player cannot switch to the cached copy mid-stream. Call Prefetch()
+  // ahead of time to download a file only once.
+  std::string Resolve(const std::string &url);
+  // Downloads |url| into the cache unless it is cached already, and calls
+  // |callback| when done.
+  void Prefetch(const std::string &url, PrefetchCallback callback);
+  void SetCapacity(int64_t capacity);  // bytes
+
+  int64_t GetHitCount() const { return hits_; }
+  int64_t GetMissCount() const { return misses_; }
+  // Bytes not downloaded thanks to hits.
+  int64_t GetBytesSaved() const { return bytes_saved_; }
+  int64_t GetSize() const { return size_; }  // bytes
+
+ private:
+  struct DownloadJob;
+
+  static void RunDownloadJob(void *data, Ecore_Thread *thread);
+  static void OnDownloadJobEnd(void *data, Ecore_Thread *thread);
+  static void OnDownloadJobCancel(void *data, Ecore_Thread *thread);
+
+  // Reads the files already in the cache directory.
+  void LoadIndex();
+  void AddEntry(const std::string &name, int64_t size);
+  void Evict();
+  std::string GetPath(const std::string &name) const;
+
+  std::string directory_;
+  bool index_loaded_ = false;
+  int64_t capacity_;
+  // File names and sizes, the most recently used first.
+  std::list<std::pair<std::string, int64_t>> entries_;
+  std::unordered_map<std::string,
+                     std::list<std::pair<std::string, int64_t>>::iterator>
+      index_;
+  int64_t size_ = 0;
+  int64_t hits_ = 0;
+  int64_t misses_ = 0;
+  int64_t bytes_saved_ = 0;
+  std::map<std::string, DownloadJob *> downloads_;  // by file name
+};
+
+#endif  // AUDIO_CACHE_H_
@@ -1,44 +1,92 @@
 #include "audio_player.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "audio_player_error.h"
 #include "log.h"
 
+#define DEFAULT_POSITION_UPDATE_INTERVAL 200  // milliseconds
+// How often the fader ramps the volumes during crossfades, and checks
+// whether the next track can start when a crossfade is due.
+#define FADE_INTERVAL 10  // milliseconds
+// The longest the fader sleeps before checking the position again.
+#define MAX_FADER_SLEEP 1000  // milliseconds
+#define HALF_PI 1.57079632679489661923
+
+static int64_t GetNowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
 AudioPlayer::AudioPlayer(const std::string &player_id, bool low_latency,
+                         SoundPool *sound_pool, PlayerPool *player_pool,
+                         AudioCache *audio_cache, EventQueue *event_queue,
                          PreparedListener prepared_listener,
                          StartPlayingListener start_playing_listener,
+                         StopPlayingListener stop_playing_listener,
                          SeekCompletedListener seek_completed_listener,
                          PlayCompletedListener play_completed_listener,
-                         ErrorListener error_listener) {
+                         ErrorListener error_listener,
+                         TrackChangedListener track_changed_listener,
+                         UnderrunListener underrun_listener) {
   LOG_INFO("AudioPlayer %s is constructing...", player_id.c_str());
   player_id_ = player_id;
   low_latency_ = low_latency;
+  sound_pool_ = sound_pool;
+  player_pool_ = player_pool;
+  audio_cache_ = audio_cache;
+  event_queue_ = event_queue;
   prepared_listener_ = prepared_listener;
   start_playing_listener_ = start_playing_listener;
+  stop_playing_listener_ = stop_playing_listener;
   seek_completed_listener_ = seek_completed_listener;
   play_completed_listener_ = play_completed_listener;
   error_listener_ = error_listener;
+  track_changed_listener_ = track_changed_listener;
+  underrun_listener_ = underrun_listener;
+  self_ = std::make_shared<AudioPlayer *>(this);
 
   volume_ = 1.0;
   playback_rate_ = 1.0;
   release_mode_ = RELEASE;
   should_seek_to_ = -1;
+  position_update_interval_ = DEFAULT_POSITION_UPDATE_INTERVAL;
 }
 
 AudioPlayer::~AudioPlayer() {
   LOG_INFO("AudioPlayer %s is destructing...", player_id_.c_str());
+  // The owner is going away, so it is not notified.
+  stop_playing_listener_ = nullptr;
   Release();
+  *self_ = nullptr;
 }
 
 void AudioPlayer::Play() {
   LOG_INFO("AudioPlayer %s will play audio...", player_id_.c_str());
+  if (sound_pool_) {
+    PlaySound();
+    return;
+  }
+  if (!queue_.empty() && !has_next_track_) {
+    PrepareNextTrack();
+  }
   player_state_e state = GetPlayerState();
   if (state == PLAYER_STATE_IDLE && preparing_) {
     LOG_DEBUG("player is preparing, play will be called in prepared callback");
     should_play_ = true;
+    StartFader();
     return;
   }
 
   if (state == PLAYER_STATE_NONE) {
+    if (ReusePreparedPlayer()) {
+      should_play_ = true;
+      HandlePrepared();
+      StartFader();
+      return;
+    }
     CreatePlayer();
   }
 
@@ -46,14 +94,16 @@ void AudioPlayer::Play() {
   switch (state) {
     case PLAYER_STATE_NONE:
     case PLAYER_STATE_IDLE:
-      if (audio_data_.size() > 0) {
-        LOG_DEBUG("set audio buffer, buffer size : %d", audio_data_.size());
-        result = player_set_memory_buffer(player_, (void *)audio_data_.data(),
-                                          audio_data_.size());
+      if (audio_blob_) {
+        // The player reads the shared blob in place.
+        LOG_DEBUG("set audio buffer, buffer size : %d",
+                  audio_blob_->data.size());
+        result = player_set_memory_buffer(player_, audio_blob_->data.data(),
+                                          audio_blob_->data.size());
         HandleResult("player_set_memory_buffer", result);
       } else {
         LOG_DEBUG("set uri (%s)", url_.c_str());
-        result = player_set_uri(player_, url_.c_str());
+        result = player_set_uri(player_, ResolveUrl(url_).c_str());
         HandleResult("player_set_uri", result);
       }
       should_play_ = true;
@@ -70,13 +120,26 @@ void AudioPlayer::Play() {
       LOG_DEBUG("player is already playing audio");
       break;
   }
+  // Started only once the player exists, as the fader reads player_.
+  StartFader();
 }
 
 void AudioPlayer::Pause() {
   LOG_INFO("AudioPlayer %s is pausing...", player_id_.c_str());
+  if (sound_pool_) {
+    if (voice_ != 0 && !paused_) {
+      sound_pool_->Pause(voice_);
+      paused_ = true;
+      stop_playing_listener_(player_id_);
+    }
+    should_play_ = false;
+    return;
+  }
+  CancelFade();
   if (GetPlayerState() == PLAYER_STATE_PLAYING) {
     int result = player_pause(player_);
     HandleResult("player_pause", result);
+    stop_playing_listener_(player_id_);
   }
   should_play_ = false;
 }
@@ -85,11 +148,15 @@ void AudioPlayer::Stop() {
   LOG_INFO("AudioPlayer %s is stopping...", player_id_.c_str());
   if (release_mode_ == RELEASE) {
     Release();
+  } else if (sound_pool_) {
+    StopSound();
   } else {
+    CancelFade();
     player_state_e state = GetPlayerState();
     if (state == PLAYER_STATE_PLAYING || state == PLAYER_STATE_PAUSED) {
       int result = player_stop(player_);
       HandleResult("player_stop", result);
+      stop_playing_listener_(player_id_);
     }
   }
   should_play_ = false;
@@ -98,21 +165,41 @@ void AudioPlayer::Stop() {
 
 void AudioPlayer::Release() {
   LOG_INFO("AudioPlayer %s is releasing...", player_id_.c_str());
+  if (sound_pool_) {
+    StopSound();
+    // The decoded sound stays in the pool's cache.
+    sound_pool_->CancelLoads(this);
+    loading_ = false;
+    sound_ = nullptr;
+    return;
+  }
+  // The queue itself is kept, and continues when played again.
+  StopFader();
+  ReleaseQueuePlayers();
   if (player_ != nullptr) {
-    player_unset_completed_cb(player_);
-    player_unset_interrupted_cb(player_);
-    player_unset_error_cb(player_);
-    player_destroy(player_);
-    player_ = nullptr;
+    RecyclePlayer();
+    if (stop_playing_listener_) {
+      stop_playing_listener_(player_id_);
+    }
   }
 }
 
 void AudioPlayer::Seek(int position) {
   LOG_INFO("AudioPlayer %s is seeking...", player_id_.c_str());
+  if (sound_pool_) {
+    if (voice_ != 0) {
+      sound_pool_->Seek(voice_, position);
+      seek_completed_listener_(player_id_);
+    } else {
+      should_seek_to_ = position;
+    }
+    return;
+  }
   if (seeking_) {
     LOG_DEBUG("player is already seeking, can't seek again");
     return;
   }
+  CancelFade();
 
   player_state_e state = GetPlayerState();
   if (state == PLAYER_STATE_READY || state == PLAYER_STATE_PLAYING ||
@@ -120,7 +207,8 @@ void AudioPlayer::Seek(int position) {
     LOG_DEBUG("set play position %d", position);
     seeking_ = true;
     int result = player_set_play_position(player_, position, true,
-                                          OnSeekCompleted, (void *)this);
+                                          OnSeekCompleted,
+                                          GetCallbackData(player_));
     if (result != PLAYER_ERROR_NONE) {
       seeking_ = false;
       std::string error(get_error_message(result));
@@ -135,28 +223,59 @@ void AudioPlayer::Seek(int position) {
 
 void AudioPlayer::SetUrl(const std::string &url) {
   LOG_INFO("AudioPlayer %s is setting url...", player_id_.c_str());
-  if (url != url_) {
+  if (sound_pool_) {
+    if (url != url_ || audio_blob_) {
+      url_ = url;
+      audio_blob_ = nullptr;
+      StopSound();
+      LoadSound();
+    }
+    return;
+  }
+  if (url != url_ || audio_blob_) {
+    ClearQueue();
+    // The player stays prepared with the previous source in the pool.
+    RecyclePlayer();
     url_ = url;
+    audio_blob_ = nullptr;
+    if (ReusePreparedPlayer()) {
+      HandlePrepared();
+      return;
+    }
     ResetPlayer();
 
     LOG_DEBUG("set new uri (%s)", url.c_str());
-    int result = player_set_uri(player_, url.c_str());
+    int result = player_set_uri(player_, ResolveUrl(url).c_str());
     HandleResult("player_set_uri", result);
 
     PreparePlayer();
   }
-  audio_data_.clear();
 }
 
-void AudioPlayer::SetDataSource(std::vector<uint8_t> &data) {
+void AudioPlayer::SetDataSource(std::shared_ptr<const AudioBlob> blob) {
   LOG_INFO("AudioPlayer %s is setting buffer...", player_id_.c_str());
-  if (data != audio_data_) {
-    audio_data_.swap(data);
+  // Identical bytes are interned into the same blob.
+  if (sound_pool_) {
+    if (blob != audio_blob_) {
+      audio_blob_ = std::move(blob);
+      StopSound();
+      LoadSound();
+    }
+    return;
+  }
+  if (blob != audio_blob_) {
+    ClearQueue();
+    RecyclePlayer();
+    audio_blob_ = std::move(blob);
+    if (ReusePreparedPlayer()) {
+      HandlePrepared();
+      return;
+    }
     ResetPlayer();
 
-    LOG_DEBUG("set audio buffer, buffer size : %d", audio_data_.size());
-    int result = player_set_memory_buffer(player_, (void *)audio_data_.data(),
-                                          audio_data_.size());
+    LOG_DEBUG("set audio buffer, buffer size : %d", audio_blob_->data.size());
+    int result = player_set_memory_buffer(player_, audio_blob_->data.data(),
+                                          audio_blob_->data.size());
     HandleResult("player_set_memory_buffer", result);
 
     PreparePlayer();
@@ -168,6 +287,20 @@ void AudioPlayer::SetVolume(double volume) {
            volume);
   if (volume_ != volume) {
     volume_ = volume;
+    if (sound_pool_) {
+      if (voice_ != 0) {
+        sound_pool_->SetVolume(voice_, volume_);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(fader_mutex_);
+      fader_volume_ = volume_;
+      if (fade_out_player_) {
+        // Applied by the fader on its next step.
+        return;
+      }
+    }
     if (GetPlayerState() != PLAYER_STATE_NONE) {
       LOG_DEBUG("set volume : %f", volume_);
       int result = player_set_volume(player_, volume_, volume_);
@@ -181,12 +314,20 @@ void AudioPlayer::SetPlaybackRate(double rate) {
            rate);
   if (playback_rate_ != rate) {
     playback_rate_ = rate;
+    if (sound_pool_) {
+      if (voice_ != 0) {
+        sound_pool_->SetRate(voice_, rate);
+      }
+      return;
+    }
     player_state_e state = GetPlayerState();
     if (state == PLAYER_STATE_READY || state == PLAYER_STATE_PLAYING ||
         state == PLAYER_STATE_PAUSED) {
       LOG_DEBUG("set plackback rate : %f", rate);
       int result = player_set_playback_rate(player_, rate);
       HandleResult("player_set_playback_rate", result);
+      // The crossfade may now be due sooner.
+      WakeFader();
     }
   }
 }
@@ -196,16 +337,30 @@ void AudioPlayer::SetReleaseMode(ReleaseMode mode) {
            mode);
   if (release_mode_ != mode) {
     release_mode_ = mode;
-    if (GetPlayerState() != PLAYER_STATE_NONE) {
-      LOG_DEBUG("set looping : %d", release_mode_ == LOOP);
-      int result = player_set_looping(player_, (release_mode_ == LOOP));
+    if (sound_pool_) {
+      if (voice_ != 0) {
+        sound_pool_->SetLooping(voice_, release_mode_ == LOOP);
+      }
+    } else if (GetPlayerState() != PLAYER_STATE_NONE) {
+      LOG_DEBUG("set looping : %d", IsLooping());
+      int result = player_set_looping(player_, IsLooping());
       HandleResult("player_set_looping", result);
+      // Whether the queue starts over after the last track has changed.
+      if (!queue_.empty()) {
+        PrepareNextTrack();
+      }
     }
   }
 }
 
 int AudioPlayer::GetDuration() {
-  int duration;
+  if (sound_pool_) {
+    return sound_ ? sound_->GetDuration() : 0;
+  }
+  int duration = duration_;
+  if (duration >= 0) {
+    return duration;
+  }
   int result = player_get_duration(player_, &duration);
   HandleResult("player_get_duration", result);
   LOG_INFO("audio (%s) duration: %d", url_.c_str(), duration);
@@ -213,6 +368,9 @@ int AudioPlayer::GetDuration() {
 }
 
 int AudioPlayer::GetCurrentPosition() {
+  if (sound_pool_) {
+    return voice_ != 0 ? sound_pool_->GetPosition(voice_) : 0;
+  }
   int position;
   int result = player_get_play_position(player_, &position);
   HandleResult("player_get_play_position", result);
@@ -223,43 +381,529 @@ int AudioPlayer::GetCurrentPosition() {
 std::string AudioPlayer::GetPlayerId() const { return player_id_; }
 
 bool AudioPlayer::IsPlaying() {
+  if (sound_pool_) {
+    return voice_ != 0 && !paused_;
+  }
   return (GetPlayerState() == PLAYER_STATE_PLAYING);
 }
 
+void AudioPlayer::SetPositionUpdateInterval(int interval) {
+  LOG_INFO("AudioPlayer %s is setting position update interval %d...",
+           player_id_.c_str(), interval);
+  position_update_interval_ = interval > 0 ? interval : 0;
+}
+
+int AudioPlayer::GetPositionUpdateInterval() const {
+  return position_update_interval_;
+}
+
 void AudioPlayer::CreatePlayer() {
   LOG_INFO("create audio player...");
   should_play_ = false;
   preparing_ = false;
 
-  int result = player_create(&player_);
+  int result = player_pool_ ? player_pool_->AcquireIdle(&player_)
+                           : player_create(&player_);
   HandleResult("player_create", result);
 
   if (low_latency_) {
     result = player_set_audio_latency_mode(player_, AUDIO_LATENCY_MODE_LOW);
     HandleResult("player_set_audio_latency_mode", result);
   }
+  BindCallbacks(player_);
+}
+
+bool AudioPlayer::ReusePreparedPlayer() {
+  if (!player_pool_) {
+    return false;
+  }
+  player_ = player_pool_->AcquirePrepared(GetSourceKey());
+  if (player_ == nullptr) {
+    return false;
+  }
+  LOG_INFO("reuse prepared audio player...");
+  preparing_ = false;
+  seeking_ = false;
+  duration_ = -1;
+
+  BindCallbacks(player_);
 
-  result = player_set_completed_cb(player_, OnPlayCompleted, (void *)this);
+  int result = player_set_volume(player_, volume_, volume_);
+  HandleResult("player_set_volume", result);
+
+  result = player_set_looping(player_, IsLooping());
+  HandleResult("player_set_looping", result);
+  return true;
+}
+
+void AudioPlayer::RecyclePlayer() {
+  if (player_ == nullptr) {
+    return;
+  }
+  player_unset_completed_cb(player_);
+  player_unset_interrupted_cb(player_);
+  player_unset_error_cb(player_);
+  if (player_pool_) {
+    // A player that is still preparing or seeking would call back into this
+    // player later, so it is only kept once unprepared.
+    if (preparing_ || seeking_) {
+      player_unprepare(player_);
+    }
+    callback_contexts_.erase(player_);
+    player_pool_->Recycle(player_, GetSourceKey(), audio_blob_);
+  } else {
+    player_destroy(player_);
+    callback_contexts_.erase(player_);
+  }
+  player_ = nullptr;
+  player_serial_ = 0;
+  preparing_ = false;
+  seeking_ = false;
+  duration_ = -1;
+}
+
+std::string AudioPlayer::ResolveUrl(const std::string &url) {
+  return audio_cache_ ? audio_cache_->Resolve(url) : url;
+}
+
+std::string AudioPlayer::GetSourceKey() const {
+  return audio_blob_ ? audio_blob_->key : url_;
+}
+
+void AudioPlayer::BindCallbacks(player_h player) {
+  // The previous context of |player|, if any, gets no more callbacks: the
+  // player has been unprepared since, or has just been acquired.
+  std::unique_ptr<CallbackContext> &context = callback_contexts_[player];
+  context = std::make_unique<CallbackContext>();
+  context->player = this;
+  context->serial = ++last_serial_;
+  if (player == player_) {
+    player_serial_ = context->serial;
+  } else if (player == next_player_) {
+    next_serial_ = context->serial;
+  }
+
+  int result = player_set_completed_cb(player, OnPlayCompleted, context.get());
   HandleResult("player_set_completed_cb", result);
 
-  result = player_set_interrupted_cb(player_, OnInterrupted, (void *)this);
+  result = player_set_interrupted_cb(player, OnInterrupted, context.get());
   HandleResult("player_set_interrupted_cb", result);
 
-  result = player_set_error_cb(player_, OnErrorOccurred, (void *)this);
+  result = player_set_error_cb(player, OnErrorOccurred, context.get());
   HandleResult("player_set_error_cb", result);
 }
 
+void *AudioPlayer::GetCallbackData(player_h player) {
+  auto iter = callback_contexts_.find(player);
+  if (iter == callback_contexts_.end()) {
+    BindCallbacks(player);
+    iter = callback_contexts_.find(player);
+  }
+  return iter->second.get();
+}
+
+void AudioPlayer::RecycleHandle(player_h player) {
+  player_unset_completed_cb(player);
+  player_unset_interrupted_cb(player);
+  player_unset_error_cb(player);
+  // Cancels a pending prepare, whose callback would use the freed context.
+  // Fails harmlessly if there is nothing to unprepare.
+  player_unprepare(player);
+  if (player == next_player_) {
+    next_serial_ = 0;
+  }
+  if (player_pool_) {
+    callback_contexts_.erase(player);
+    player_pool_->Recycle(player, "", nullptr);
+  } else {
+    player_destroy(player);
+    callback_contexts_.erase(player);
+  }
+}
+
+bool AudioPlayer::IsLooping() const {
+  return release_mode_ == LOOP && queue_.empty();
+}
+
+void AudioPlayer::SetQueue(const std::vector<std::string> &urls,
+                           int crossfade) {
+  LOG_INFO("AudioPlayer %s is setting a queue of %zu tracks...",
+           player_id_.c_str(), urls.size());
+  if (sound_pool_) {
+    throw AudioPlayerError("Not supported",
+                           "queues are not supported in low latency mode");
+  }
+  if (!urls.empty() && (audio_blob_ || url_.empty())) {
+    throw AudioPlayerError("Invalid source", "queues need a url to start with");
+  }
+  ClearQueue();
+  if (urls.empty()) {
+    return;
+  }
+  queue_.push_back(url_);
+  queue_.insert(queue_.end(), urls.begin(), urls.end());
+  crossfade_ = crossfade > 0 ? crossfade : 0;
+
+  if (GetPlayerState() != PLAYER_STATE_NONE) {
+    int result = player_set_looping(player_, IsLooping());
+    HandleResult("player_set_looping", result);
+    PrepareNextTrack();
+    StartFader();
+  }
+}
+
+void AudioPlayer::PrepareNextTrack() {
+  std::unique_lock<std::mutex> lock(fader_mutex_);
+  WaitForFader(lock);
+  if (is_next_started_ && next_player_) {
+    // The fader has already started the next track.
+    return;
+  }
+  bool was_preparing = has_next_track_ && !is_next_prepared_;
+  has_next_track_ = false;
+  is_next_prepared_ = false;
+  is_next_started_ = false;
+  is_advance_pending_ = false;
+  fade_attempted_ = false;
+
+  size_t index = queue_index_ + 1;
+  if (index >= queue_.size()) {
+    if (release_mode_ != LOOP) {
+      if (next_player_) {
+        RecycleHandle(next_player_);
+        next_player_ = nullptr;
+      }
+      return;
+    }
+    index = 0;
+  }
+
+  int result;
+  if (next_player_) {
+    player_state_e state = PLAYER_STATE_NONE;
+    player_get_state(next_player_, &state);
+    // A track still being prepared is cancelled as well, so that its
+    // callback does not come after the binding is replaced below.
+    if (state != PLAYER_STATE_IDLE || was_preparing) {
+      result = player_unprepare(next_player_);
+      HandleResult("player_unprepare", result);
+    }
+  } else {
+    player_h player = nullptr;
+    result = player_pool_ ? player_pool_->AcquireIdle(&player)
+                          : player_create(&player);
+    HandleResult("player_create", result);
+    next_player_ = player;
+  }
+  // Bound again after unpreparing, so that callbacks for the track prepared
+  // before are dropped.
+  BindCallbacks(next_player_);
+
+  const std::string &url = queue_[index];
+  LOG_DEBUG("prepare track %zu (%s)", index, url.c_str());
+  result = player_set_uri(next_player_, ResolveUrl(url).c_str());
+  HandleResult("player_set_uri", result);
+
+  // With a crossfade, the fader raises the volume.
+  double volume = crossfade_ > 0 ? 0.0 : volume_;
+  result = player_set_volume(next_player_, volume, volume);
+  HandleResult("player_set_volume", result);
+
+  result = player_prepare_async(next_player_, OnNextPrepared,
+                                GetCallbackData(next_player_));
+  HandleResult("player_prepare_async", result);
+  has_next_track_ = true;
+  fader_wakeup_ = true;
+  fader_cv_.notify_one();
+}
+
+void AudioPlayer::AdvanceQueue() {
+  if (!has_next_track_ || !is_next_prepared_) {
+    return;
+  }
+  LOG_INFO("AudioPlayer %s moves on to the next track...", player_id_.c_str());
+  std::unique_lock<std::mutex> lock(fader_mutex_);
+  WaitForFader(lock);
+  if (!is_next_started_) {
+    player_set_volume(next_player_, volume_, volume_);
+    int result = player_start(next_player_);
+    if (result != PLAYER_ERROR_NONE) {
+      lock.unlock();
+      std::string error(get_error_message(result));
+      LOG_ERROR("player_start failed : %s", error.c_str());
+      error_listener_(player_id_, "failed to start next track: " + error);
+      return;
+    }
+    is_next_started_ = true;
+  }
+  if (playback_rate_ != 1.0) {
+    player_set_playback_rate(next_player_, playback_rate_);
+  }
+
+  player_h finished = player_;
+  player_ = next_player_;
+  next_player_ = nullptr;
+  next_serial_ = 0;
+  BindCallbacks(player_);
+  // A player fading out is handed back by the fader once silent.
+  if (finished != fade_out_player_) {
+    RecycleHandle(finished);
+  } else {
+    player_unset_completed_cb(finished);
+    player_unset_interrupted_cb(finished);
+    player_unset_error_cb(finished);
+  }
+  lock.unlock();
+
+  queue_index_ = queue_index_ + 1 < queue_.size() ? queue_index_ + 1 : 0;
+  url_ = queue_[queue_index_];
+  int duration = 0;
+  if (player_get_duration(player_, &duration) == PLAYER_ERROR_NONE) {
+    duration_ = duration;
+  }
+
+  track_changed_listener_(player_id_, queue_index_);
+  prepared_listener_(player_id_, duration);
+  int64_t underrun_start = underrun_start_us_.exchange(0);
+  if (underrun_start > 0) {
+    int gap = (GetNowUs() - underrun_start) / 1000;
+    LOG_INFO("next track started %d ms late", gap);
+    underrun_listener_(player_id_, gap);
+  }
+
+  try {
+    PrepareNextTrack();
+  } catch (const AudioPlayerError &e) {
+    // The current track keeps playing and completes normally.
+    error_listener_(player_id_, e.GetMessage() + " : " + e.GetCode());
+  }
+}
+
+void AudioPlayer::ClearQueue() {
+  StopFader();
+  ReleaseQueuePlayers();
+  bool had_queue = !queue_.empty();
+  queue_.clear();
+  queue_index_ = 0;
+  crossfade_ = 0;
+  if (had_queue && GetPlayerState() != PLAYER_STATE_NONE) {
+    player_set_looping(player_, IsLooping());
+  }
+}
+
+void AudioPlayer::ReleaseQueuePlayers() {
+  has_next_track_ = false;
+  is_next_prepared_ = false;
+  is_next_started_ = false;
+  is_advance_pending_ = false;
+  underrun_start_us_ = 0;
+  RecycleFadedOutPlayers();
+  if (next_player_) {
+    RecycleHandle(next_player_);
+    next_player_ = nullptr;
+  }
+  if (fade_out_player_) {
+    if (fade_out_player_ != player_) {
+      RecycleHandle(fade_out_player_);
+    }
+    fade_out_player_ = nullptr;
+    fade_in_player_ = nullptr;
+  }
+}
+
+void AudioPlayer::RecycleFadedOutPlayers() {
+  std::vector<player_h> players;
+  {
+    std::lock_guard<std::mutex> lock(fader_mutex_);
+    players.swap(faded_out_players_);
+  }
+  for (player_h player : players) {
+    player_pause(player);
+    RecycleHandle(player);
+  }
+}
+
+void AudioPlayer::StartFader() {
+  if (fader_thread_.joinable()) {
+    WakeFader();
+    return;
+  }
+  if (crossfade_ <= 0) {
+    return;
+  }
+  fader_volume_ = volume_;
+  fader_running_ = true;
+  fader_thread_ = std::thread(&AudioPlayer::FaderLoop, this);
+}
+
+void AudioPlayer::StopFader() {
+  if (!fader_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(fader_mutex_);
+    fader_running_ = false;
+  }
+  fader_cv_.notify_one();
+  fader_thread_.join();
+}
+
+void AudioPlayer::WakeFader() {
+  if (!fader_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(fader_mutex_);
+    fader_wakeup_ = true;
+  }
+  fader_cv_.notify_one();
+}
+
+void AudioPlayer::WaitForFader(std::unique_lock<std::mutex> &lock) {
+  fader_idle_cv_.wait(lock, [this] { return !fader_busy_; });
+}
+
+void AudioPlayer::CancelFade() {
+  std::unique_lock<std::mutex> lock(fader_mutex_);
+  WaitForFader(lock);
+  if (!fade_out_player_ || fade_out_player_ == player_) {
+    // Nothing to cancel, or the queue has not advanced yet.
+    return;
+  }
+  player_pause(fade_out_player_);
+  RecycleHandle(fade_out_player_);
+  fade_out_player_ = nullptr;
+  fade_in_player_ = nullptr;
+  player_set_volume(player_, fader_volume_, fader_volume_);
+}
+
+// Runs on the fader thread. Outside of crossfades, the position is only
+// checked again when the next crossfade may be due.
+void AudioPlayer::FaderLoop() {
+  std::unique_lock<std::mutex> lock(fader_mutex_);
+  // Calls |func| with fader_mutex_ released. The players it uses are not
+  // recycled meanwhile.
+  auto unlocked = [&](const std::function<void()> &func) {
+    fader_busy_ = true;
+    lock.unlock();
+    func();
+    lock.lock();
+    fader_busy_ = false;
+    fader_idle_cv_.notify_all();
+  };
+
+  int sleep = FADE_INTERVAL;
+  while (fader_running_) {
+    fader_cv_.wait_for(lock, std::chrono::milliseconds(sleep),
+                       [this] { return !fader_running_ || fader_wakeup_; });
+    fader_wakeup_ = false;
+    if (!fader_running_) {
+      break;
+    }
+    sleep = FADE_INTERVAL;
+
+    if (fade_out_player_) {
+      player_h out_player = fade_out_player_;
+      player_h in_player = fade_in_player_;
+      double volume = fader_volume_;
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - fade_start_);
+      double progress = (double)elapsed.count() / fade_duration_;
+      if (progress < 1.0) {
+        // Equal power, so that the loudness stays even.
+        double out = volume * std::cos(progress * HALF_PI);
+        double in = volume * std::sin(progress * HALF_PI);
+        unlocked([&] {
+          player_set_volume(out_player, out, out);
+          player_set_volume(in_player, in, in);
+        });
+        continue;
+      }
+      unlocked([&] { player_set_volume(in_player, volume, volume); });
+      // Until the queue advances on the main thread, the player fading out
+      // is still the current one and is recycled there. Otherwise it is
+      // handed to the main thread, since recycling blocks on the player
+      // service.
+      if (fade_out_player_ != player_) {
+        faded_out_players_.push_back(fade_out_player_);
+        event_queue_->Post([self = self_] {
+          AudioPlayer *player = *self;
+          if (player) {
+            player->RecycleFadedOutPlayers();
+          }
+        });
+      }
+      fade_out_player_ = nullptr;
+      fade_in_player_ = nullptr;
+      continue;
+    }
+
+    if (!has_next_track_ || is_next_started_ || fade_attempted_ || !player_) {
+      // Woken up when this changes.
+      sleep = MAX_FADER_SLEEP;
+      continue;
+    }
+    player_h current = player_;
+    int duration = duration_;
+    int position = 0;
+    bool is_playing = false;
+    unlocked([&] {
+      player_state_e state = PLAYER_STATE_NONE;
+      is_playing =
+          player_get_state(current, &state) == PLAYER_ERROR_NONE &&
+          state == PLAYER_STATE_PLAYING &&
+          player_get_play_position(current, &position) == PLAYER_ERROR_NONE;
+    });
+    if (!is_playing || duration <= 0) {
+      sleep = MAX_FADER_SLEEP;
+      continue;
+    }
+    int remaining = duration - position;
+    if (remaining > crossfade_) {
+      // Half of the time left, in case the playback rate is above 1.
+      sleep = std::min(std::max((remaining - crossfade_) / 2, FADE_INTERVAL),
+                       MAX_FADER_SLEEP);
+      continue;
+    }
+    if (!is_next_prepared_) {
+      int64_t expected = 0;
+      underrun_start_us_.compare_exchange_strong(expected, GetNowUs());
+      continue;
+    }
+
+    // Only one attempt per track, so a failure is not retried every step.
+    fade_attempted_ = true;
+    player_h next = next_player_;
+    int result = PLAYER_ERROR_NONE;
+    unlocked([&] {
+      player_set_volume(next, 0.0, 0.0);
+      result = player_start(next);
+    });
+    if (result != PLAYER_ERROR_NONE) {
+      LOG_ERROR("player_start failed : %s", get_error_message(result));
+      continue;
+    }
+    is_next_started_ = true;
+    fade_out_player_ = current;
+    fade_in_player_ = next;
+    fade_start_ = std::chrono::steady_clock::now();
+    fade_duration_ = remaining > FADE_INTERVAL ? remaining : FADE_INTERVAL;
+    PostCallback(player_serial_,
+                 [](AudioPlayer *player) { player->AdvanceQueue(); });
+  }
+}
+
 void AudioPlayer::PreparePlayer() {
   LOG_DEBUG("set volume %f", volume_);
   int result = player_set_volume(player_, volume_, volume_);
   HandleResult("player_set_volume", result);
 
-  LOG_DEBUG("set looping %d", (release_mode_ == LOOP));
-  result = player_set_looping(player_, (release_mode_ == LOOP));
+  LOG_DEBUG("set looping %d", IsLooping());
+  result = player_set_looping(player_, IsLooping());
   HandleResult("player_set_looping", result);
 
   LOG_DEBUG("prepare audio player asynchronously");
-  result = player_prepare_async(player_, OnPrepared, (void *)this);
+  result = player_prepare_async(player_, OnPrepared, GetCallbackData(player_));
   HandleResult("player_prepare_async", result);
   preparing_ = true;
   seeking_ = false;
@@ -267,6 +911,7 @@ void AudioPlayer::PreparePlayer() {
 
 void AudioPlayer::ResetPlayer() {
   LOG_INFO("reset audio player...");
+  duration_ = -1;
   int result;
   player_state_e state = GetPlayerState();
   switch (state) {
@@ -289,6 +934,10 @@ void AudioPlayer::ResetPlayer() {
       HandleResult("player_unprepare", result);
       break;
   }
+  if (state != PLAYER_STATE_NONE) {
+    // Callbacks for the previous source are dropped.
+    BindCallbacks(player_);
+  }
 }
 
 player_state_e AudioPlayer::GetPlayerState() {
@@ -312,66 +961,226 @@ void AudioPlayer::HandleResult(const std::string &func_name, int result) {
   }
 }
 
-void AudioPlayer::OnPrepared(void *data) {
+void AudioPlayer::LoadSound() {
+  sound_ = nullptr;
+  std::string key = audio_blob_ ? audio_blob_->key : url_;
+  if (key.empty()) {
+    throw AudioPlayerError("Invalid source", "no url or bytes are set");
+  }
+
+  // Results of loads started for a previous source are ignored.
+  uint32_t serial = ++load_serial_;
+  std::shared_ptr<const PcmSound> sound = sound_pool_->Load(
+      key, url_, audio_blob_, this,
+      [this, serial](std::shared_ptr<const PcmSound> sound,
+                     const std::string &error) {
+        if (serial == load_serial_) {
+          OnSoundLoaded(sound, error);
+        }
+      });
+  loading_ = true;
+  if (sound) {
+    OnSoundLoaded(sound, "");
+  }
+}
+
+void AudioPlayer::OnSoundLoaded(std::shared_ptr<const PcmSound> sound,
+                                const std::string &error) {
+  loading_ = false;
+  if (!sound) {
+    should_play_ = false;
+    error_listener_(player_id_, "failed to load sound: " + error);
+    return;
+  }
+  sound_ = sound;
+  prepared_listener_(player_id_, sound_->GetDuration());
+  if (should_play_) {
+    PlaySound();
+  }
+}
+
+void AudioPlayer::PlaySound() {
+  if (!sound_) {
+    LOG_DEBUG("sound is loading, play will be called when loaded");
+    should_play_ = true;
+    if (!loading_) {
+      LoadSound();
+    }
+    return;
+  }
+  should_play_ = false;
+  if (voice_ != 0) {
+    if (paused_) {
+      sound_pool_->Resume(voice_);
+      paused_ = false;
+      start_playing_listener_(player_id_);
+    }
+    return;
+  }
+
+  voice_ = sound_pool_->Play(
+      sound_, volume_, playback_rate_, release_mode_ == LOOP,
+      [this](bool completed) { OnSoundEnded(completed); });
+  paused_ = false;
+  if (should_seek_to_ > 0) {
+    sound_pool_->Seek(voice_, should_seek_to_);
+    seek_completed_listener_(player_id_);
+  }
+  should_seek_to_ = -1;
+  start_playing_listener_(player_id_);
+}
+
+void AudioPlayer::StopSound() {
+  if (voice_ == 0) {
+    return;
+  }
+  sound_pool_->Stop(voice_);
+  voice_ = 0;
+  paused_ = false;
+  if (stop_playing_listener_) {
+    stop_playing_listener_(player_id_);
+  }
+}
+
+void AudioPlayer::OnSoundEnded(bool completed) {
+  voice_ = 0;
+  paused_ = false;
+  stop_playing_listener_(player_id_);
+  if (completed) {
+    if (release_mode_ == RELEASE) {
+      sound_ = nullptr;
+    }
+    play_completed_listener_(player_id_);
+  }
+}
+
+void AudioPlayer::HandlePrepared() {
   LOG_INFO("Audio player is prepared");
-  AudioPlayer *player = (AudioPlayer *)data;
-  player->preparing_ = false;
+  preparing_ = false;
 
+  // The duration does not change once prepared, so it is queried only here.
   int duration = 0;
-  int result = player_get_duration(player->player_, &duration);
+  int result = player_get_duration(player_, &duration);
   if (result == PLAYER_ERROR_NONE) {
-    player->prepared_listener_(player->player_id_, duration);
+    duration_ = duration;
+    prepared_listener_(player_id_, duration);
   }
 
-  player_set_playback_rate(player->player_, player->playback_rate_);
+  player_set_playback_rate(player_, playback_rate_);
 
-  if (player->should_play_) {
+  if (should_play_) {
     LOG_DEBUG("start to play audio");
-    result = player_start(player->player_);
+    result = player_start(player_);
     if (result == PLAYER_ERROR_NONE) {
-      player->start_playing_listener_(player->player_id_);
+      start_playing_listener_(player_id_);
     }
-    player->should_play_ = false;
+    should_play_ = false;
   }
 
-  if (player->should_seek_to_ > 0) {
-    LOG_DEBUG("set play position %d", player->should_seek_to_);
-    player->seeking_ = true;
-    result = player_set_play_position(player->player_, player->should_seek_to_,
-                                      true, OnSeekCompleted, data);
+  if (should_seek_to_ > 0) {
+    LOG_DEBUG("set play position %d", should_seek_to_);
+    seeking_ = true;
+    result = player_set_play_position(player_, should_seek_to_, true,
+                                      OnSeekCompleted,
+                                      GetCallbackData(player_));
     if (result != PLAYER_ERROR_NONE) {
       LOG_ERROR("failed to set play position");
-      player->seeking_ = false;
+      seeking_ = false;
+    }
+    should_seek_to_ = -1;
+  }
+}
+
+void AudioPlayer::HandlePlayCompleted() {
+  LOG_DEBUG("completed to play audio");
+  if (has_next_track_) {
+    if (is_next_started_) {
+      // Crossfading into the next track, which the queue advances to.
+      return;
     }
-    player->should_seek_to_ = -1;
+    if (!is_next_prepared_) {
+      LOG_INFO("next track is not prepared yet");
+      int64_t expected = 0;
+      underrun_start_us_.compare_exchange_strong(expected, GetNowUs());
+      // HandleNextPrepared() advances.
+      is_advance_pending_ = true;
+      return;
+    }
+    AdvanceQueue();
+    return;
   }
+  if (release_mode_ != LOOP) {
+    Stop();
+  }
+  play_completed_listener_(player_id_);
+}
+
+void AudioPlayer::PostCallback(uint32_t serial,
+                               std::function<void(AudioPlayer *)> handler) {
+  // Callbacks of a native player that has been replaced, reset or recycled
+  // since are dropped.
+  event_queue_->Post([self = self_, serial, handler = std::move(handler)] {
+    AudioPlayer *player = *self;
+    if (player && serial != 0 &&
+        (player->player_serial_ == serial || player->next_serial_ == serial)) {
+      handler(player);
+    }
+  });
+}
+
+void AudioPlayer::OnPrepared(void *data) {
+  CallbackContext *context = (CallbackContext *)data;
+  context->player->PostCallback(
+      context->serial, [](AudioPlayer *player) { player->HandlePrepared(); });
 }
 
 void AudioPlayer::OnSeekCompleted(void *data) {
-  LOG_DEBUG("completed to set position");
-  AudioPlayer *player = (AudioPlayer *)data;
-  player->seek_completed_listener_(player->player_id_);
-  player->seeking_ = false;
+  CallbackContext *context = (CallbackContext *)data;
+  context->player->PostCallback(context->serial, [](AudioPlayer *player) {
+    LOG_DEBUG("completed to set position");
+    player->seek_completed_listener_(player->player_id_);
+    player->seeking_ = false;
+    player->WakeFader();
+  });
 }
 
 void AudioPlayer::OnPlayCompleted(void *data) {
-  LOG_DEBUG("completed to play audio");
-  AudioPlayer *player = (AudioPlayer *)data;
-  if (player->release_mode_ != LOOP) {
-    player->Stop();
+  CallbackContext *context = (CallbackContext *)data;
+  context->player->PostCallback(
+      context->serial,
+      [](AudioPlayer *player) { player->HandlePlayCompleted(); });
+}
+
+void AudioPlayer::OnNextPrepared(void *data) {
+  LOG_DEBUG("next track is prepared");
+  CallbackContext *context = (CallbackContext *)data;
+  AudioPlayer *player = context->player;
+  // Set right away, as the fader thread waits for it.
+  if (player->next_serial_ == context->serial) {
+    player->is_next_prepared_ = true;
   }
-  player->play_completed_listener_(player->player_id_);
+  player->PostCallback(context->serial, [](AudioPlayer *player) {
+    if (player->is_advance_pending_.exchange(false)) {
+      player->AdvanceQueue();
+    }
+  });
 }
 
 void AudioPlayer::OnInterrupted(player_interrupted_code_e code, void *data) {
   LOG_ERROR("interruption occurred: %d", code);
-  AudioPlayer *player = (AudioPlayer *)data;
-  player->error_listener_(player->player_id_, "player - Interrupted");
+  CallbackContext *context = (CallbackContext *)data;
+  context->player->PostCallback(context->serial, [](AudioPlayer *player) {
+    player->stop_playing_listener_(player->player_id_);
+    player->error_listener_(player->player_id_, "player - Interrupted");
+  });
 }
 
 void AudioPlayer::OnErrorOccurred(int code, void *data) {
   std::string error(get_error_message(code));
   LOG_ERROR("error occurred: %s", error.c_str());
-  AudioPlayer *player = (AudioPlayer *)data;
-  player->error_listener_(player->player_id_, "error occurred: " + error);
+  CallbackContext *context = (CallbackContext *)data;
+  context->player->PostCallback(
+      context->serial, [error](AudioPlayer *player) {
+        player->error_listener_(player->player_id_, "error occurred: " + error);
+      });
 }
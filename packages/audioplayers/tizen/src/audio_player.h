@@ -3,28 +3,60 @@
 
 #include <player.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "audio_cache.h"
 #include "audio_player_options.h"
+#include "event_queue.h"
+#include "player_pool.h"
+#include "sound_pool.h"
 
 using PreparedListener =
     std::function<void(const std::string &player_id, int duration)>;
 using StartPlayingListener = std::function<void(const std::string &player_id)>;
+// Called when the player stops playing, either paused, stopped, released,
+// completed or interrupted.
+using StopPlayingListener = std::function<void(const std::string &player_id)>;
 using SeekCompletedListener = std::function<void(const std::string &player_id)>;
 using PlayCompletedListener = std::function<void(const std::string &player_id)>;
 using ErrorListener = std::function<void(const std::string &player_id,
                                          const std::string &message)>;
+// Called when the queue moves on to the track at |index|.
+using TrackChangedListener =
+    std::function<void(const std::string &player_id, int index)>;
+// Called when playback stalled for |gap| milliseconds because the next
+// track of the queue was not prepared in time.
+using UnderrunListener =
+    std::function<void(const std::string &player_id, int gap)>;
 
+// All listeners are called on the main thread.
 class AudioPlayer {
  public:
+  // If |sound_pool| is given, sounds are decoded into memory and played by
+  // the pool instead of a native player. Otherwise native players are taken
+  // from and returned to |player_pool| if given, and remote urls are played
+  // from |audio_cache| once cached. Native player callbacks are handled on
+  // the main thread through |event_queue|.
   AudioPlayer(const std::string &player_id, bool low_latency,
+              SoundPool *sound_pool, PlayerPool *player_pool,
+              AudioCache *audio_cache, EventQueue *event_queue,
               PreparedListener prepared_listener,
               StartPlayingListener start_playing_listener,
+              StopPlayingListener stop_playing_listener,
               SeekCompletedListener seek_completed_listener,
               PlayCompletedListener play_completed_listener,
-              ErrorListener error_listener);
+              ErrorListener error_listener,
+              TrackChangedListener track_changed_listener,
+              UnderrunListener underrun_listener);
   ~AudioPlayer();
 
   void Play();
@@ -36,35 +68,126 @@ class AudioPlayer {
   // If you use HTTP or RTSP, URI must start with "http://" or "rtsp://".
   // The default protocol is "file://".
   void SetUrl(const std::string &url);
-  void SetDataSource(std::vector<uint8_t> &data);
+  // |blob| is shared with the other players given the same bytes.
+  void SetDataSource(std::shared_ptr<const AudioBlob> blob);
   void SetVolume(double volume);
   void SetPlaybackRate(double rate);
   void SetReleaseMode(ReleaseMode mode);
+  // Returns the duration cached when the player was prepared, if any.
   int GetDuration();
   int GetCurrentPosition();
   std::string GetPlayerId() const;
   bool IsPlaying();
+  // The interval between position updates while playing, or 0 if position
+  // updates are disabled.
+  void SetPositionUpdateInterval(int interval);  // milliseconds
+  int GetPositionUpdateInterval() const;
+  // Plays |urls| after the current url without a gap. Each track is
+  // prepared on a second native player while the previous one plays. With
+  // a |crossfade| duration, the next track fades in over the end of the
+  // previous one. In LOOP mode the queue starts over after the last track.
+  // Setting another source clears the queue.
+  void SetQueue(const std::vector<std::string> &urls,
+                int crossfade);  // milliseconds
 
  private:
   // the player state should be none before call this function
   void CreatePlayer();
+  // Takes a player already prepared with the current source from the pool,
+  // and returns whether there was one.
+  bool ReusePreparedPlayer();
+  // Hands the player back to the pool, or destroys it.
+  void RecyclePlayer();
+  // Identifies the current source for reusing prepared players.
+  std::string GetSourceKey() const;
+  // Returns the cached copy of |url| if there is one.
+  std::string ResolveUrl(const std::string &url);
+  // Registers the callbacks of |player| with a new serial. Callbacks
+  // registered with an earlier serial are dropped from then on.
+  void BindCallbacks(player_h player);
+  // Returns the user data for other callbacks of |player|, such as the
+  // prepared and seek completed callbacks.
+  void *GetCallbackData(player_h player);
+  // Returns |player| to the pool, or destroys it.
+  void RecycleHandle(player_h player);
+  // Whether the native player loops, which it never does with a queue.
+  bool IsLooping() const;
+
+  // Queue mode.
+  void PrepareNextTrack();
+  // Starts the next track unless the fader did, and makes it current. Runs
+  // on the main thread.
+  void AdvanceQueue();
+  void ClearQueue();
+  void ReleaseQueuePlayers();
+  // Starts the fader, or makes it check the position again if running.
+  void StartFader();
+  void StopFader();
+  void WakeFader();
+  void FaderLoop();
+  // Waits until the fader is not using any player. Must be called with
+  // |lock| on fader_mutex_ held before recycling a player it may use.
+  void WaitForFader(std::unique_lock<std::mutex> &lock);
+  // Ends a crossfade in progress right away.
+  void CancelFade();
+  // Recycles the players the fader has finished fading out.
+  void RecycleFadedOutPlayers();
   // the player state should be idle before call this function
   void PreparePlayer();
   void ResetPlayer();
   player_state_e GetPlayerState();
   void HandleResult(const std::string &func_name, int result);
 
+  // Sound pool mode.
+  void LoadSound();
+  void OnSoundLoaded(std::shared_ptr<const PcmSound> sound,
+                     const std::string &error);
+  void PlaySound();
+  void StopSound();
+  void OnSoundEnded(bool completed);
+
+  // Native player callbacks come on other threads and are posted to the
+  // main thread, where the Handle* methods run.
+  void PostCallback(uint32_t serial,
+                    std::function<void(AudioPlayer *)> handler);
+  void HandlePrepared();
+  void HandlePlayCompleted();
+
   static void OnPrepared(void *data);
   static void OnSeekCompleted(void *data);
   static void OnPlayCompleted(void *data);
   static void OnInterrupted(player_interrupted_code_e code, void *data);
   static void OnErrorOccurred(int code, void *data);
+  static void OnNextPrepared(void *data);
 
   player_h player_ = nullptr;
   std::string player_id_;
   bool low_latency_;
+  SoundPool *sound_pool_;
+  PlayerPool *player_pool_;
+  AudioCache *audio_cache_;
+  EventQueue *event_queue_;
+  // The user data of native player callbacks. The serial is bound when the
+  // callbacks are registered, so that a late callback of a native player
+  // that has been replaced, reset or recycled since can be told apart.
+  struct CallbackContext {
+    AudioPlayer *player;
+    uint32_t serial;
+  };
+  // The latest binding of each native player in use. Only accessed on the
+  // main thread.
+  std::map<player_h, std::unique_ptr<CallbackContext>> callback_contexts_;
+  uint32_t last_serial_ = 0;
+  // The serials of the current bindings of player_ and next_player_, or 0.
+  std::atomic<uint32_t> player_serial_{0};
+  std::atomic<uint32_t> next_serial_{0};
+  std::shared_ptr<const PcmSound> sound_;
+  uint32_t voice_ = 0;
+  uint32_t load_serial_ = 0;
+  bool loading_ = false;
+  bool paused_ = false;
   std::string url_;
-  std::vector<uint8_t> audio_data_;
+  std::shared_ptr<const AudioBlob> audio_blob_;
   double volume_;
   double playback_rate_;
   ReleaseMode release_mode_;
@@ -72,11 +195,57 @@ class AudioPlayer {
   bool preparing_ = false;
   bool seeking_ = false;
   bool should_play_ = false;
+  // Cached once prepared, -1 until then. Also read by the fader thread.
+  std::atomic<int> duration_{-1};
+  int position_update_interval_;
   PreparedListener prepared_listener_;
   StartPlayingListener start_playing_listener_;
+  StopPlayingListener stop_playing_listener_;
   SeekCompletedListener seek_completed_listener_;
   PlayCompletedListener play_completed_listener_;
   ErrorListener error_listener_;
+  TrackChangedListener track_changed_listener_;
+  UnderrunListener underrun_listener_;
+
+  // The current url followed by the urls passed to SetQueue(), or empty.
+  std::vector<std::string> queue_;
+  size_t queue_index_ = 0;
+  // Prepared with the next track while the current one plays.
+  player_h next_player_ = nullptr;
+  std::atomic<bool> has_next_track_{false};
+  std::atomic<bool> is_next_prepared_{false};
+  std::atomic<bool> is_next_started_{false};
+  // Set when the current track completed before the next one was prepared.
+  std::atomic<bool> is_advance_pending_{false};
+  // When the next track should have started but was not prepared yet.
+  std::atomic<int64_t> underrun_start_us_{0};
+
+  // Ramps the volumes during crossfades. player_ and next_player_ are only
+  // changed with fader_mutex_ held while the fader thread runs.
+  std::thread fader_thread_;
+  std::mutex fader_mutex_;
+  std::condition_variable fader_cv_;
+  bool fader_running_ = false;
+  // Set to make the fader check the position before its next step is due.
+  bool fader_wakeup_ = false;
+  // Player calls block on the player service, so the fader makes them with
+  // fader_mutex_ released and fader_busy_ set.
+  bool fader_busy_ = false;
+  std::condition_variable fader_idle_cv_;
+  int crossfade_ = 0;  // milliseconds
+  double fader_volume_ = 1.0;
+  bool fade_attempted_ = false;
+  player_h fade_out_player_ = nullptr;
+  player_h fade_in_player_ = nullptr;
+  std::chrono::steady_clock::time_point fade_start_;
+  int fade_duration_ = 0;  // milliseconds
+  // Faded out by the fader thread and waiting to be recycled on the main
+  // thread.
+  std::vector<player_h> faded_out_players_;
+
+  // Cleared on destruction so that pending main loop calls can tell that
+  // the player is gone.
+  std::shared_ptr<AudioPlayer *> self_;
 };
 
 #endif  // AUDIO_PLAYER_H_
@@ -1,19 +1,78 @@
 #include "audioplayers_tizen_plugin.h"
 
 #include <Ecore.h>
+#include <flutter/byte_streams.h>
 #include <flutter/encodable_value.h>
+#include <flutter/engine_method_result.h>
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar.h>
+#include <flutter/standard_codec_serializer.h>
 #include <flutter/standard_method_codec.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <map>
+#include <optional>
+#include <set>
 
+#include "audio_blob_cache.h"
+#include "audio_cache.h"
 #include "audio_player.h"
 #include "audio_player_error.h"
 #include "audio_player_options.h"
+#include "event_queue.h"
 #include "log.h"
+#include "player_pool.h"
+#include "sound_pool.h"
 
-#define TIMEOUT 0.2
+// Returns the value of |key| in |map|, or a null value if there is none.
+static const flutter::EncodableValue &GetValue(
+    const flutter::EncodableMap &map, const char *key) {
+  static const flutter::EncodableValue null_value;
+  auto iter = map.find(flutter::EncodableValue(key));
+  return iter != map.end() ? iter->second : null_value;
+}
+
+#define CHANNEL_NAME "xyz.luan/audioplayers"
+
+// Reads values in place from a platform message.
+class MessageReader : public flutter::ByteStreamReader {
+ public:
+  MessageReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  uint8_t ReadByte() override {
+    if (position_ >= size_) {
+      failed_ = true;
+      return 0;
+    }
+    return data_[position_++];
+  }
+
+  void ReadBytes(uint8_t *buffer, size_t length) override {
+    if (length > size_ - position_) {
+      failed_ = true;
+      memset(buffer, 0, length);
+      position_ = size_;
+      return;
+    }
+    memcpy(buffer, data_ + position_, length);
+    position_ += length;
+  }
+
+  void ReadAlignment(uint8_t alignment) override {
+    size_t padding = (alignment - position_ % alignment) % alignment;
+    position_ = std::min(position_ + padding, size_);
+  }
+
+  bool failed() const { return failed_; }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t position_ = 0;
+  bool failed_ = false;
+};
 
 class AudioplayersTizenPlugin : public flutter::Plugin {
  public:
@@ -23,17 +82,20 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
   }
 
   AudioplayersTizenPlugin(flutter::PluginRegistrar *registrar) {
-    auto channel =
+    // Method calls are decoded by HandleMessage(), so the channel is only
+    // used to call into Dart.
+    channel_ =
         std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-            registrar->messenger(), "xyz.luan/audioplayers",
+            registrar->messenger(), CHANNEL_NAME,
             &flutter::StandardMethodCodec::GetInstance());
-    channel->SetMethodCallHandler(
-        [plugin = this](const auto &call, auto result) {
-          plugin->HandleMethodCall(call, std::move(result));
+    registrar->messenger()->SetMessageHandler(
+        CHANNEL_NAME, [plugin = this](const uint8_t *message,
+                                      size_t message_size,
+                                      flutter::BinaryReply reply) {
+          plugin->HandleMessage(message, message_size, std::move(reply));
         });
-
-    channel_ = std::move(channel);
     timer_ = nullptr;
+    timer_interval_ = 0;
   }
 
   virtual ~AudioplayersTizenPlugin() {
@@ -44,15 +106,66 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
   }
 
  private:
+  // Decodes method calls here rather than through a MethodChannel, which
+  // only passes the arguments as const, so that the bytes given to
+  // playBytes can be moved out of them instead of copied.
+  void HandleMessage(const uint8_t *message, size_t message_size,
+                     flutter::BinaryReply reply) {
+    const flutter::StandardCodecSerializer &serializer =
+        flutter::StandardCodecSerializer::GetInstance();
+    MessageReader reader(message, message_size);
+    flutter::EncodableValue method_name = serializer.ReadValue(&reader);
+    flutter::EncodableValue arguments = serializer.ReadValue(&reader);
+    if (reader.failed() || !std::holds_alternative<std::string>(method_name)) {
+      LOG_ERROR("failed to decode a method call");
+      reply(nullptr, 0);
+      return;
+    }
+
+    std::optional<std::vector<uint8_t>> bytes;
+    if (std::get<std::string>(method_name).compare("playBytes") == 0 &&
+        std::holds_alternative<flutter::EncodableMap>(arguments)) {
+      auto &encodables = std::get<flutter::EncodableMap>(arguments);
+      auto iter = encodables.find(flutter::EncodableValue("bytes"));
+      if (iter != encodables.end() &&
+          std::holds_alternative<std::vector<uint8_t>>(iter->second)) {
+        bytes = std::move(std::get<std::vector<uint8_t>>(iter->second));
+        encodables.erase(iter);
+      }
+    }
+    flutter::MethodCall<flutter::EncodableValue> method_call(
+        std::get<std::string>(method_name),
+        std::make_unique<flutter::EncodableValue>(std::move(arguments)));
+    HandleMethodCall(
+        method_call,
+        std::make_unique<flutter::EngineMethodResult<flutter::EncodableValue>>(
+            std::move(reply), &flutter::StandardMethodCodec::GetInstance()),
+        std::move(bytes));
+  }
+
+  // |bytes| are the bytes given to playBytes, moved out of the arguments.
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
-      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+      std::optional<std::vector<uint8_t>> bytes) {
     LOG_DEBUG("HandleMethodCall: %s", method_call.method_name().c_str());
+    const std::string &method_name = method_call.method_name();
+    if (method_name.compare("prefetch") == 0 ||
+        method_name.compare("setCacheSize") == 0 ||
+        method_name.compare("getCacheStats") == 0) {
+      HandleCacheMethodCall(method_call, std::move(result));
+      return;
+    }
+    if (method_name.compare("setLowLatencyIdleTimeout") == 0) {
+      HandleIdleTimeoutMethodCall(method_call, std::move(result));
+      return;
+    }
     const flutter::EncodableValue *args = method_call.arguments();
     if (std::holds_alternative<flutter::EncodableMap>(*args)) {
-      flutter::EncodableMap encodables = std::get<flutter::EncodableMap>(*args);
-      flutter::EncodableValue &player_id_value =
-          encodables[flutter::EncodableValue("playerId")];
+      const flutter::EncodableMap &encodables =
+          std::get<flutter::EncodableMap>(*args);
+      const flutter::EncodableValue &player_id_value =
+          GetValue(encodables, "playerId");
       std::string player_id;
       if (std::holds_alternative<std::string>(player_id_value)) {
         player_id = std::get<std::string>(player_id_value);
@@ -63,8 +176,7 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
         return;
       }
 
-      flutter::EncodableValue &mode_value =
-          encodables[flutter::EncodableValue("mode")];
+      const flutter::EncodableValue &mode_value = GetValue(encodables, "mode");
       std::string mode;
       if (std::holds_alternative<std::string>(mode_value)) {
         mode = std::get<std::string>(mode_value);
@@ -74,36 +186,33 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
       AudioPlayer *player = GetAudioPlayer(player_id, mode);
       try {
         if (method_call.method_name().compare("play") == 0) {
-          flutter::EncodableValue &volume =
-              encodables[flutter::EncodableValue("volume")];
+          const flutter::EncodableValue &volume =
+              GetValue(encodables, "volume");
           if (std::holds_alternative<double>(volume)) {
             player->SetVolume(std::get<double>(volume));
           }
-          flutter::EncodableValue &url =
-              encodables[flutter::EncodableValue("url")];
+          const flutter::EncodableValue &url = GetValue(encodables, "url");
           if (std::holds_alternative<std::string>(url)) {
             player->SetUrl(std::get<std::string>(url));
           }
           player->Play();
-          flutter::EncodableValue &position =
-              encodables[flutter::EncodableValue("position")];
+          const flutter::EncodableValue &position =
+              GetValue(encodables, "position");
           if (std::holds_alternative<int32_t>(position)) {
             player->Seek(std::get<int32_t>(position));
           }
         } else if (method_call.method_name().compare("playBytes") == 0) {
-          flutter::EncodableValue &volume =
-              encodables[flutter::EncodableValue("volume")];
+          const flutter::EncodableValue &volume =
+              GetValue(encodables, "volume");
           if (std::holds_alternative<double>(volume)) {
             player->SetVolume(std::get<double>(volume));
           }
-          flutter::EncodableValue &bytes =
-              encodables[flutter::EncodableValue("bytes")];
-          if (std::holds_alternative<std::vector<uint8_t>>(bytes)) {
-            player->SetDataSource(std::get<std::vector<uint8_t>>(bytes));
+          if (bytes) {
+            player->SetDataSource(blob_cache_.Intern(std::move(*bytes)));
           }
           player->Play();
-          flutter::EncodableValue &position =
-              encodables[flutter::EncodableValue("position")];
+          const flutter::EncodableValue &position =
+              GetValue(encodables, "position");
           if (std::holds_alternative<int32_t>(position)) {
             player->Seek(std::get<int32_t>(position));
           }
@@ -116,8 +225,8 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
         } else if (method_call.method_name().compare("release") == 0) {
           player->Release();
         } else if (method_call.method_name().compare("seek") == 0) {
-          flutter::EncodableValue &position =
-              encodables[flutter::EncodableValue("position")];
+          const flutter::EncodableValue &position =
+              GetValue(encodables, "position");
           if (std::holds_alternative<int32_t>(position)) {
             player->Seek(std::get<int32_t>(position));
           } else {
@@ -125,8 +234,8 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
                           "seek failed because of invalid position");
           }
         } else if (method_call.method_name().compare("setVolume") == 0) {
-          flutter::EncodableValue &volume =
-              encodables[flutter::EncodableValue("volume")];
+          const flutter::EncodableValue &volume =
+              GetValue(encodables, "volume");
           if (std::holds_alternative<double>(volume)) {
             player->SetVolume(std::get<double>(volume));
           } else {
@@ -134,8 +243,7 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
                           "setVolume failed because of invalid volume");
           }
         } else if (method_call.method_name().compare("setUrl") == 0) {
-          flutter::EncodableValue &url =
-              encodables[flutter::EncodableValue("url")];
+          const flutter::EncodableValue &url = GetValue(encodables, "url");
           if (std::holds_alternative<std::string>(url)) {
             player->SetUrl(std::get<std::string>(url));
           } else {
@@ -143,8 +251,8 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
                           "SetUrl failed because of invalid url");
           }
         } else if (method_call.method_name().compare("setPlaybackRate") == 0) {
-          flutter::EncodableValue &rate =
-              encodables[flutter::EncodableValue("playbackRate")];
+          const flutter::EncodableValue &rate =
+              GetValue(encodables, "playbackRate");
           if (std::holds_alternative<double>(rate)) {
             player->SetPlaybackRate(std::get<double>(rate));
           } else {
@@ -152,8 +260,8 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
                           "setPlaybackRate failed because of invalid rate");
           }
         } else if (method_call.method_name().compare("setReleaseMode") == 0) {
-          flutter::EncodableValue &release_mode_value =
-              encodables[flutter::EncodableValue("releaseMode")];
+          const flutter::EncodableValue &release_mode_value =
+              GetValue(encodables, "releaseMode");
           if (std::holds_alternative<std::string>(release_mode_value)) {
             std::string release_mode =
                 std::get<std::string>(release_mode_value);
@@ -169,6 +277,48 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
                 "Invalid ReleaseMode",
                 "setReleaseMode failed because of invalid ReleaseMode");
           }
+        } else if (method_call.method_name().compare(
+                       "setPositionUpdateInterval") == 0) {
+          const flutter::EncodableValue &interval =
+              GetValue(encodables, "interval");
+          if (std::holds_alternative<int32_t>(interval)) {
+            player->SetPositionUpdateInterval(std::get<int32_t>(interval));
+          } else {
+            result->Error("Invalid interval",
+                          "setPositionUpdateInterval failed because of "
+                          "invalid interval");
+            return;
+          }
+          const flutter::EncodableValue &batched =
+              GetValue(encodables, "batched");
+          if (std::holds_alternative<bool>(batched) &&
+              std::get<bool>(batched)) {
+            batched_players_.insert(player_id);
+          } else {
+            batched_players_.erase(player_id);
+          }
+          UpdatePositionTimer();
+        } else if (method_call.method_name().compare("setQueue") == 0) {
+          const flutter::EncodableValue &urls_value =
+              GetValue(encodables, "urls");
+          if (!std::holds_alternative<flutter::EncodableList>(urls_value)) {
+            result->Error("Invalid urls",
+                          "setQueue failed because of invalid urls");
+            return;
+          }
+          std::vector<std::string> urls;
+          for (const auto &url : std::get<flutter::EncodableList>(urls_value)) {
+            if (std::holds_alternative<std::string>(url)) {
+              urls.push_back(std::get<std::string>(url));
+            }
+          }
+          int crossfade = 0;
+          const flutter::EncodableValue &crossfade_value =
+              GetValue(encodables, "crossfade");
+          if (std::holds_alternative<int32_t>(crossfade_value)) {
+            crossfade = std::get<int32_t>(crossfade_value);
+          }
+          player->SetQueue(urls, crossfade);
         } else if (method_call.method_name().compare("getDuration") == 0) {
           int duration = player->GetDuration();
           result->Success(flutter::EncodableValue(duration));
@@ -192,6 +342,94 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
     }
   }
 
+  // Handles the methods of the cache of remote files, which is shared by all
+  // players.
+  void HandleCacheMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue> &method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    const std::string &method_name = method_call.method_name();
+    if (method_name.compare("getCacheStats") == 0) {
+      int64_t hits = audio_cache_.GetHitCount();
+      int64_t requests = hits + audio_cache_.GetMissCount();
+      double hit_ratio = requests > 0 ? (double)hits / requests : 0.0;
+      flutter::EncodableMap stats = {
+          {flutter::EncodableValue("hits"), flutter::EncodableValue(hits)},
+          {flutter::EncodableValue("misses"),
+           flutter::EncodableValue(audio_cache_.GetMissCount())},
+          {flutter::EncodableValue("hitRatio"),
+           flutter::EncodableValue(hit_ratio)},
+          {flutter::EncodableValue("bytesSaved"),
+           flutter::EncodableValue(audio_cache_.GetBytesSaved())},
+          {flutter::EncodableValue("size"),
+           flutter::EncodableValue(audio_cache_.GetSize())}};
+      result->Success(flutter::EncodableValue(stats));
+      return;
+    }
+
+    const flutter::EncodableValue *args = method_call.arguments();
+    if (!args || !std::holds_alternative<flutter::EncodableMap>(*args)) {
+      result->Error("Invalid arguments",
+                    "Invalid arguments for method " + method_name);
+      return;
+    }
+    const flutter::EncodableMap &encodables =
+        std::get<flutter::EncodableMap>(*args);
+    if (method_name.compare("setCacheSize") == 0) {
+      auto iter = encodables.find(flutter::EncodableValue("size"));
+      if (iter == encodables.end() ||
+          !(std::holds_alternative<int32_t>(iter->second) ||
+            std::holds_alternative<int64_t>(iter->second))) {
+        result->Error("Invalid size",
+                      "setCacheSize failed because of invalid size");
+        return;
+      }
+      audio_cache_.SetCapacity(iter->second.LongValue());
+      result->Success(flutter::EncodableValue(1));
+    } else {
+      auto iter = encodables.find(flutter::EncodableValue("url"));
+      if (iter == encodables.end() ||
+          !std::holds_alternative<std::string>(iter->second)) {
+        result->Error("Invalid url", "prefetch failed because of invalid url");
+        return;
+      }
+      // Replied to once the file is cached.
+      std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+          shared_result = std::move(result);
+      audio_cache_.Prefetch(
+          std::get<std::string>(iter->second),
+          [shared_result](bool success, const std::string &error) {
+            if (success) {
+              shared_result->Success(flutter::EncodableValue(1));
+            } else {
+              shared_result->Error("Prefetch failed", error);
+            }
+          });
+    }
+  }
+
+  void HandleIdleTimeoutMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue> &method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    const flutter::EncodableValue *args = method_call.arguments();
+    if (!args || !std::holds_alternative<flutter::EncodableMap>(*args)) {
+      result->Error("Invalid arguments",
+                    "Invalid arguments for method " +
+                        method_call.method_name());
+      return;
+    }
+    const flutter::EncodableValue &timeout =
+        GetValue(std::get<flutter::EncodableMap>(*args), "timeout");
+    if (!std::holds_alternative<int32_t>(timeout)) {
+      result->Error("Invalid timeout",
+                    "setLowLatencyIdleTimeout failed because of invalid "
+                    "timeout");
+      return;
+    }
+    // A negative timeout keeps the output of low latency players prepared.
+    sound_pool_.SetIdleTimeout(std::get<int32_t>(timeout));
+    result->Success(flutter::EncodableValue(1));
+  }
+
   AudioPlayer *GetAudioPlayer(const std::string &player_id,
                               const std::string &mode) {
     auto iter = audio_players_.find(player_id);
@@ -227,8 +465,12 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
 
     StartPlayingListener start_playing_listener =
         [plugin = this](const std::string &player_id) {
-          ecore_main_loop_thread_safe_call_async(StartPositionUpdates,
-                                                 (void *)plugin);
+          plugin->UpdatePositionTimer();
+        };
+
+    StopPlayingListener stop_playing_listener =
+        [plugin = this](const std::string &player_id) {
+          plugin->UpdatePositionTimer();
         };
 
     PlayCompletedListener play_completed_listener =
@@ -252,59 +494,129 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
       channel->InvokeMethod("audio.onError", std::move(arguments));
     };
 
+    TrackChangedListener track_changed_listener =
+        [channel = channel_.get()](const std::string &player_id, int index) {
+          flutter::EncodableMap wrapped = {{flutter::EncodableValue("playerId"),
+                                            flutter::EncodableValue(player_id)},
+                                           {flutter::EncodableValue("value"),
+                                            flutter::EncodableValue(index)}};
+          auto arguments = std::make_unique<flutter::EncodableValue>(wrapped);
+          channel->InvokeMethod("audio.onQueueIndexChanged",
+                                std::move(arguments));
+        };
+
+    UnderrunListener underrun_listener =
+        [channel = channel_.get()](const std::string &player_id, int gap) {
+          flutter::EncodableMap wrapped = {{flutter::EncodableValue("playerId"),
+                                            flutter::EncodableValue(player_id)},
+                                           {flutter::EncodableValue("value"),
+                                            flutter::EncodableValue(gap)}};
+          auto arguments = std::make_unique<flutter::EncodableValue>(wrapped);
+          channel->InvokeMethod("audio.onUnderrun", std::move(arguments));
+        };
+
     auto player = std::make_unique<AudioPlayer>(
-        player_id, low_latency, prepared_listener, start_playing_listener,
-        seek_completed_listener, play_completed_listener, error_listener);
+        player_id, low_latency, low_latency ? &sound_pool_ : nullptr,
+        low_latency ? nullptr : &player_pool_, &audio_cache_, &event_queue_,
+        prepared_listener, start_playing_listener, stop_playing_listener,
+        seek_completed_listener, play_completed_listener, error_listener,
+        track_changed_listener, underrun_listener);
     audio_players_[player_id] = std::move(player);
     return audio_players_[player_id].get();
   }
 
-  static void StartPositionUpdates(void *data) {
-    AudioplayersTizenPlugin *plugin = (AudioplayersTizenPlugin *)data;
-    if (!plugin->timer_) {
+  // Runs the timer at the shortest update interval of the playing players,
+  // and removes it as soon as none of them is playing.
+  void UpdatePositionTimer() {
+    int interval = 0;
+    for (const auto &entry : audio_players_) {
+      AudioPlayer *player = entry.second.get();
+      int player_interval = player->GetPositionUpdateInterval();
+      if (player_interval > 0 && player->IsPlaying() &&
+          (interval == 0 || player_interval < interval)) {
+        interval = player_interval;
+      }
+    }
+
+    if (interval == 0) {
+      if (timer_) {
+        LOG_DEBUG("no audio is playing, remove the position timer");
+        ecore_timer_del(timer_);
+        timer_ = nullptr;
+      }
+      return;
+    }
+    if (!timer_) {
       LOG_DEBUG("add timer to update position of playing audio");
-      plugin->timer_ = ecore_timer_add(TIMEOUT, UpdatePosition, data);
-      if (plugin->timer_ == nullptr) {
+      timer_ = ecore_timer_add(interval / 1000.0, UpdatePosition, this);
+      if (timer_ == nullptr) {
         LOG_ERROR("failed to add timer for UpdatePosition");
+        return;
       }
+    } else if (interval != timer_interval_) {
+      ecore_timer_interval_set(timer_, interval / 1000.0);
     }
+    timer_interval_ = interval;
   }
 
   static Eina_Bool UpdatePosition(void *data) {
     AudioplayersTizenPlugin *plugin = (AudioplayersTizenPlugin *)data;
+    auto now = std::chrono::steady_clock::now();
     bool none_playing = true;
-    auto iter = plugin->audio_players_.begin();
-    while (iter != plugin->audio_players_.end()) {
+    flutter::EncodableMap batched_positions;
+    for (const auto &entry : plugin->audio_players_) {
+      const std::string &player_id = entry.first;
+      AudioPlayer *player = entry.second.get();
+      int interval = player->GetPositionUpdateInterval();
+      if (interval <= 0 || !player->IsPlaying()) {
+        continue;
+      }
+      none_playing = false;
+
+      // Players with a longer interval than the timer skip some ticks. Half
+      // a tick of slack keeps the timer jitter from skipping one too many.
+      auto &last_update = plugin->last_position_updates_[player_id];
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         now - last_update)
+                         .count();
+      if (elapsed < interval - plugin->timer_interval_ / 2) {
+        continue;
+      }
+      last_update = now;
+
+      int position;
       try {
-        std::string player_id = iter->second->GetPlayerId();
-        if (iter->second->IsPlaying()) {
-          LOG_DEBUG("Audio player %s is playing", player_id.c_str());
-          none_playing = false;
-          flutter::EncodableMap duration = {
-              {flutter::EncodableValue("playerId"),
-               flutter::EncodableValue(player_id)},
-              {flutter::EncodableValue("value"),
-               flutter::EncodableValue(iter->second->GetDuration())}};
-          plugin->channel_->InvokeMethod(
-              "audio.onDuration",
-              std::make_unique<flutter::EncodableValue>(duration));
-
-          flutter::EncodableMap position = {
-              {flutter::EncodableValue("playerId"),
-               flutter::EncodableValue(player_id)},
-              {flutter::EncodableValue("value"),
-               flutter::EncodableValue(iter->second->GetCurrentPosition())}};
-          plugin->channel_->InvokeMethod(
-              "audio.onCurrentPosition",
-              std::make_unique<flutter::EncodableValue>(position));
-        }
-        iter++;
-      } catch (...) {
+        position = player->GetCurrentPosition();
+      } catch (const AudioPlayerError &e) {
         LOG_ERROR("failed to update position for player %s",
-                  iter->second->GetPlayerId().c_str());
+                  player_id.c_str());
+        continue;
+      }
+      if (plugin->batched_players_.count(player_id)) {
+        batched_positions[flutter::EncodableValue(player_id)] =
+            flutter::EncodableValue(position);
+      } else {
+        flutter::EncodableMap arguments = {
+            {flutter::EncodableValue("playerId"),
+             flutter::EncodableValue(player_id)},
+            {flutter::EncodableValue("value"),
+             flutter::EncodableValue(position)}};
+        plugin->channel_->InvokeMethod(
+            "audio.onCurrentPosition",
+            std::make_unique<flutter::EncodableValue>(arguments));
       }
     }
 
+    if (!batched_positions.empty()) {
+      // A single message for all players that opted in to batching.
+      flutter::EncodableMap arguments = {
+          {flutter::EncodableValue("value"),
+           flutter::EncodableValue(batched_positions)}};
+      plugin->channel_->InvokeMethod(
+          "audio.onCurrentPositions",
+          std::make_unique<flutter::EncodableValue>(arguments));
+    }
+
     if (none_playing) {
       plugin->timer_ = nullptr;
       return ECORE_CALLBACK_CANCEL;
@@ -314,7 +626,19 @@ class AudioplayersTizenPlugin : public flutter::Plugin {
   }
 
   Ecore_Timer *timer_;
+  int timer_interval_;  // milliseconds
+  std::map<std::string, std::chrono::steady_clock::time_point>
+      last_position_updates_;
+  // Players whose positions are sent together in audio.onCurrentPositions.
+  std::set<std::string> batched_players_;
   std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+  AudioBlobCache blob_cache_;
+  // All must outlive audio_players_.
+  EventQueue event_queue_;
+  SoundPool sound_pool_;
+  PlayerPool player_pool_;
+  AudioCache audio_cache_;
+  // Only used on the main thread, where all player callbacks are handled.
   std::map<std::string, std::unique_ptr<AudioPlayer>> audio_players_;
 };
 
@@ -0,0 +1,48 @@
+#include "event_queue.h"
+
+#include "log.h"
+
+EventQueue::EventQueue() {
+  pipe_ = ecore_pipe_add(OnWakeup, this);
+  if (!pipe_) {
+    LOG_ERROR("failed to add pipe for events");
+  }
+}
+
+EventQueue::~EventQueue() {
+  // Tasks still pending are dropped along with the pipe.
+  if (pipe_) {
+    ecore_pipe_del(pipe_);
+  }
+}
+
+void EventQueue::Post(Task task) {
+  bool wakeup;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A wakeup is already on its way if tasks are pending.
+    wakeup = tasks_.empty();
+    tasks_.push_back(std::move(task));
+  }
+  if (wakeup && pipe_) {
+    char signal = 0;
+    ecore_pipe_write(pipe_, &signal, sizeof(signal));
+  }
+}
+
+// Runs on the main thread.
+void EventQueue::OnWakeup(void *data, void *buffer, unsigned int size) {
+  EventQueue *queue = (EventQueue *)data;
+  std::vector<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    tasks.swap(queue->tasks_);
+  }
+  if (tasks.size() > 1) {
+    LOG_DEBUG("run %zu events", tasks.size());
+  }
+  // Tasks posted while these run come in the next batch.
+  for (Task &task : tasks) {
+    task();
+  }
+}
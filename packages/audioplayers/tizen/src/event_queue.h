@@ -0,0 +1,33 @@
+#ifndef EVENT_QUEUE_H_
+#define EVENT_QUEUE_H_
+
+#include <Ecore.h>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Runs tasks posted from any thread on the main thread, in the order they
+// were posted. Tasks posted before the main loop gets to them run together
+// in a single batch, so a burst of native callbacks costs one wakeup.
+class EventQueue {
+ public:
+  using Task = std::function<void()>;
+
+  EventQueue();
+  ~EventQueue();
+
+  EventQueue(const EventQueue &) = delete;
+  EventQueue &operator=(const EventQueue &) = delete;
+
+  void Post(Task task);
+
+ private:
+  static void OnWakeup(void *data, void *buffer, unsigned int size);
+
+  std::mutex mutex_;
+  std::vector<Task> tasks_;
+  Ecore_Pipe *pipe_ = nullptr;
+};
+
+#endif  // EVENT_QUEUE_H_
@@ -0,0 +1,247 @@
+#include "pcm_decoder.h"
+
+#include <player.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
+#include "audio_player_error.h"
+#include "log.h"
+
+// Sounds longer than about 95 seconds are not meant to be held in memory.
+#define MAX_PCM_SIZE (16 * 1024 * 1024)  // bytes
+#define DECODE_TIMEOUT 30                // seconds
+
+struct DecodeContext {
+  std::mutex mutex;
+  std::condition_variable cv;
+  PcmSound *sound;
+  bool done = false;
+  bool too_long = false;
+  int error = PLAYER_ERROR_NONE;
+};
+
+static uint16_t ReadLe16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+static uint32_t ReadLe32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Converts an uncompressed 8 or 16-bit mono or stereo WAV file. Returns false
+// if |data| is in any other format.
+static bool DecodeWav(const std::vector<uint8_t> &data, PcmSound &sound) {
+  if (data.size() < 12 || memcmp(data.data(), "RIFF", 4) != 0 ||
+      memcmp(data.data() + 8, "WAVE", 4) != 0) {
+    return false;
+  }
+  const uint8_t *fmt = nullptr;
+  const uint8_t *pcm = nullptr;
+  size_t pcm_size = 0;
+  size_t offset = 12;
+  while (offset + 8 <= data.size()) {
+    const uint8_t *chunk = data.data() + offset;
+    size_t size = ReadLe32(chunk + 4);
+    size_t available = data.size() - offset - 8;
+    if (memcmp(chunk, "data", 4) == 0) {
+      // Truncated files are played up to where they end.
+      pcm = chunk + 8;
+      pcm_size = std::min(size, available);
+      break;
+    }
+    if (size > available) {
+      // Also keeps the offset from wrapping around.
+      break;
+    }
+    if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      fmt = chunk + 8;
+    }
+    offset += 8 + size + (size & 1);
+  }
+  if (!fmt || !pcm) {
+    return false;
+  }
+  uint16_t format = ReadLe16(fmt);
+  int channels = ReadLe16(fmt + 2);
+  uint32_t sample_rate = ReadLe32(fmt + 4);
+  int bits = ReadLe16(fmt + 14);
+  if (format != 1 || (channels != 1 && channels != 2) ||
+      (bits != 8 && bits != 16) || sample_rate == 0) {
+    return false;
+  }
+
+  size_t frame_size = channels * bits / 8;
+  size_t src_frames = pcm_size / frame_size;
+  size_t dst_frames = (uint64_t)src_frames * kPcmSampleRate / sample_rate;
+  if (src_frames == 0 || dst_frames == 0) {
+    throw AudioPlayerError("Invalid data", "WAV file has no samples");
+  }
+  if (dst_frames * kPcmChannels * sizeof(int16_t) > MAX_PCM_SIZE) {
+    throw AudioPlayerError("Too long", "sound is too long to be decoded");
+  }
+  auto sample_at = [&](size_t frame, int channel) -> int64_t {
+    const uint8_t *p =
+        pcm + frame * frame_size + (channel % channels) * (bits / 8);
+    return bits == 16 ? (int16_t)ReadLe16(p) : ((int32_t)p[0] - 128) << 8;
+  };
+
+  // Resample with linear interpolation, which is enough for short effects.
+  sound.samples.resize(dst_frames * kPcmChannels);
+  for (size_t i = 0; i < dst_frames; i++) {
+    uint64_t position = (uint64_t)i * sample_rate * 65536 / kPcmSampleRate;
+    size_t frame = position >> 16;
+    int64_t fraction = position & 0xffff;
+    size_t next = std::min(frame + 1, src_frames - 1);
+    for (int channel = 0; channel < kPcmChannels; channel++) {
+      int64_t a = sample_at(frame, channel);
+      int64_t b = sample_at(next, channel);
+      sound.samples[i * kPcmChannels + channel] =
+          (int16_t)(a + (((b - a) * fraction) >> 16));
+    }
+  }
+  return true;
+}
+
+static void OnPcmExtracted(player_audio_raw_data_s *frame, void *data) {
+  DecodeContext *context = (DecodeContext *)data;
+  std::lock_guard<std::mutex> lock(context->mutex);
+  if (context->done) {
+    return;
+  }
+  std::vector<int16_t> &samples = context->sound->samples;
+  size_t count = frame->size / sizeof(int16_t);
+  if ((samples.size() + count) * sizeof(int16_t) > MAX_PCM_SIZE) {
+    context->too_long = true;
+    context->done = true;
+    context->cv.notify_one();
+    return;
+  }
+  const int16_t *begin = (const int16_t *)frame->data;
+  samples.insert(samples.end(), begin, begin + count);
+}
+
+static void OnDecodeCompleted(void *data) {
+  DecodeContext *context = (DecodeContext *)data;
+  std::lock_guard<std::mutex> lock(context->mutex);
+  context->done = true;
+  context->cv.notify_one();
+}
+
+static void OnDecodeError(int code, void *data) {
+  DecodeContext *context = (DecodeContext *)data;
+  std::lock_guard<std::mutex> lock(context->mutex);
+  context->error = code;
+  context->done = true;
+  context->cv.notify_one();
+}
+
+// Plays the source through a player without output, as fast as it can be
+// decoded, and collects the extracted PCM.
+static void DecodeWithPlayer(const std::string &url,
+                             const std::vector<uint8_t> &data,
+                             PcmSound &sound) {
+  player_h player = nullptr;
+  int result = player_create(&player);
+  if (result != PLAYER_ERROR_NONE) {
+    throw AudioPlayerError(get_error_message(result), "player_create failed");
+  }
+
+  DecodeContext context;
+  context.sound = &sound;
+  if (url.empty()) {
+    result = player_set_memory_buffer(player, data.data(), data.size());
+  } else {
+    result = player_set_uri(player, url.c_str());
+  }
+  if (result == PLAYER_ERROR_NONE) {
+    result = player_set_pcm_extraction_mode(player, false, OnPcmExtracted,
+                                            &context);
+  }
+  if (result == PLAYER_ERROR_NONE) {
+    result = player_set_pcm_spec(player, "S16LE", kPcmSampleRate,
+                                 kPcmChannels);
+  }
+  if (result == PLAYER_ERROR_NONE) {
+    result = player_set_completed_cb(player, OnDecodeCompleted, &context);
+  }
+  if (result == PLAYER_ERROR_NONE) {
+    result = player_set_error_cb(player, OnDecodeError, &context);
+  }
+  if (result == PLAYER_ERROR_NONE) {
+    result = player_prepare(player);
+  }
+  if (result == PLAYER_ERROR_NONE) {
+    result = player_start(player);
+  }
+
+  bool timed_out = false;
+  if (result == PLAYER_ERROR_NONE) {
+    std::unique_lock<std::mutex> lock(context.mutex);
+    timed_out =
+        !context.cv.wait_for(lock, std::chrono::seconds(DECODE_TIMEOUT),
+                             [&context] { return context.done; });
+    // Late callbacks are ignored from here on.
+    context.done = true;
+  }
+  player_unset_completed_cb(player);
+  player_unset_error_cb(player);
+  player_unprepare(player);
+  player_destroy(player);
+
+  if (result != PLAYER_ERROR_NONE) {
+    std::string error(get_error_message(result));
+    LOG_ERROR("failed to decode audio : %s", error.c_str());
+    throw AudioPlayerError(error, "failed to decode audio");
+  }
+  if (context.error != PLAYER_ERROR_NONE) {
+    std::string error(get_error_message(context.error));
+    LOG_ERROR("error occurred while decoding audio : %s", error.c_str());
+    throw AudioPlayerError(error, "failed to decode audio");
+  }
+  if (timed_out) {
+    throw AudioPlayerError("Timed out", "decoding audio took too long");
+  }
+  if (context.too_long) {
+    throw AudioPlayerError("Too long", "sound is too long to be decoded");
+  }
+  if (sound.samples.empty()) {
+    throw AudioPlayerError("Invalid data", "no audio was decoded");
+  }
+}
+
+void DecodePcm(const std::string &url, const std::vector<uint8_t> &data,
+               PcmSound &sound) {
+  sound.samples.clear();
+  if (url.empty()) {
+    if (!DecodeWav(data, sound)) {
+      DecodeWithPlayer(url, data, sound);
+    }
+    return;
+  }
+
+  std::string path;
+  if (url.compare(0, 7, "file://") == 0) {
+    path = url.substr(7);
+  } else if (url.find("://") == std::string::npos) {
+    path = url;
+  }
+  if (!path.empty()) {
+    // Only WAV files are read here. Anything else is left to the player.
+    std::ifstream file(path, std::ios::binary);
+    char header[12] = {};
+    if (file.read(header, sizeof(header)) && memcmp(header, "RIFF", 4) == 0 &&
+        memcmp(header + 8, "WAVE", 4) == 0) {
+      file.seekg(0);
+      std::vector<uint8_t> content((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+      if (DecodeWav(content, sound)) {
+        return;
+      }
+    }
+  }
+  DecodeWithPlayer(url, data, sound);
+}
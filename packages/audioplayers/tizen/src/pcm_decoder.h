@@ -0,0 +1,28 @@
+#ifndef PCM_DECODER_H_
+#define PCM_DECODER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The format of decoded sounds: interleaved 16-bit stereo.
+constexpr int kPcmSampleRate = 44100;
+constexpr int kPcmChannels = 2;
+
+struct PcmSound {
+  std::vector<int16_t> samples;
+
+  size_t GetFrameCount() const { return samples.size() / kPcmChannels; }
+  int GetDuration() const {  // milliseconds
+    return (int64_t)GetFrameCount() * 1000 / kPcmSampleRate;
+  }
+};
+
+// Decodes the whole of |url|, or |data| if |url| is empty, into |sound|.
+// Uncompressed WAV is converted directly, and other formats are decoded by a
+// native player. Blocks until done, so must not be called on the main
+// thread. Throws AudioPlayerError on failure.
+void DecodePcm(const std::string &url, const std::vector<uint8_t> &data,
+               PcmSound &sound);
+
+#endif  // PCM_DECODER_H_
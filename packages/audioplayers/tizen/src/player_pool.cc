@@ -0,0 +1,122 @@
+#include "player_pool.h"
+
+#include "log.h"
+
+// Prepared players hold decoder resources, so only a few are kept.
+#define MAX_PREPARED_PLAYERS 4
+#define MAX_IDLE_PLAYERS 2
+
+PlayerPool::~PlayerPool() {
+  if (idler_) {
+    ecore_idler_del(idler_);
+  }
+  for (PreparedPlayer &entry : prepared_players_) {
+    player_unprepare(entry.player);
+    player_destroy(entry.player);
+  }
+  for (player_h player : idle_players_) {
+    player_destroy(player);
+  }
+}
+
+player_h PlayerPool::AcquirePrepared(const std::string &source) {
+  for (auto iter = prepared_players_.begin(); iter != prepared_players_.end();
+       ++iter) {
+    if (iter->source == source && *iter->rewound) {
+      LOG_DEBUG("reuse prepared player for %s", source.c_str());
+      player_h player = iter->player;
+      prepared_players_.erase(iter);
+      return player;
+    }
+  }
+  return nullptr;
+}
+
+int PlayerPool::AcquireIdle(player_h *player) {
+  // Refill the pool once the main loop is idle.
+  if (!idler_) {
+    idler_ = ecore_idler_add(OnIdle, this);
+  }
+  if (!idle_players_.empty()) {
+    *player = idle_players_.back();
+    idle_players_.pop_back();
+    return PLAYER_ERROR_NONE;
+  }
+  return player_create(player);
+}
+
+void PlayerPool::Recycle(player_h player, const std::string &source,
+                         std::shared_ptr<const AudioBlob> blob) {
+  player_state_e state = PLAYER_STATE_NONE;
+  int result = player_get_state(player, &state);
+  if (result != PLAYER_ERROR_NONE) {
+    LOG_ERROR("player_get_state failed : %s", get_error_message(result));
+    player_destroy(player);
+    return;
+  }
+
+  if (!source.empty() && state != PLAYER_STATE_IDLE) {
+    if (state == PLAYER_STATE_PLAYING) {
+      result = player_pause(player);
+    }
+    auto rewound = std::make_unique<std::atomic<bool>>(false);
+    if (result == PLAYER_ERROR_NONE) {
+      result = player_set_play_position(player, 0, false, OnRewound,
+                                        rewound.get());
+    }
+    if (result == PLAYER_ERROR_NONE) {
+      prepared_players_.push_front(
+          {source, player, std::move(blob), std::move(rewound)});
+      if (prepared_players_.size() <= MAX_PREPARED_PLAYERS) {
+        return;
+      }
+      // Its flag is freed once the player is unprepared or destroyed.
+      PreparedPlayer evicted = std::move(prepared_players_.back());
+      prepared_players_.pop_back();
+      RecycleIdle(evicted.player);
+      return;
+    }
+    LOG_ERROR("failed to rewind player : %s", get_error_message(result));
+  }
+  RecycleIdle(player);
+}
+
+void PlayerPool::RecycleIdle(player_h player) {
+  if (idle_players_.size() >= MAX_IDLE_PLAYERS) {
+    player_destroy(player);
+    return;
+  }
+  player_state_e state = PLAYER_STATE_NONE;
+  player_get_state(player, &state);
+  if (state != PLAYER_STATE_IDLE) {
+    int result = player_unprepare(player);
+    if (result != PLAYER_ERROR_NONE) {
+      LOG_ERROR("player_unprepare failed : %s", get_error_message(result));
+      player_destroy(player);
+      return;
+    }
+  }
+  idle_players_.push_back(player);
+}
+
+void PlayerPool::OnRewound(void *data) {
+  ((std::atomic<bool> *)data)->store(true);
+}
+
+Eina_Bool PlayerPool::OnIdle(void *data) {
+  PlayerPool *pool = (PlayerPool *)data;
+  if (pool->idle_players_.size() >= MAX_IDLE_PLAYERS) {
+    pool->idler_ = nullptr;
+    return ECORE_CALLBACK_CANCEL;
+  }
+  // One player per idle round, not to block the main loop for long.
+  player_h player = nullptr;
+  int result = player_create(&player);
+  if (result != PLAYER_ERROR_NONE) {
+    LOG_ERROR("player_create failed : %s", get_error_message(result));
+    pool->idler_ = nullptr;
+    return ECORE_CALLBACK_CANCEL;
+  }
+  pool->idle_players_.push_back(player);
+  return ECORE_CALLBACK_RENEW;
+}
@@ -0,0 +1,68 @@
+#ifndef PLAYER_POOL_H_
+#define PLAYER_POOL_H_
+
+#include <Ecore.h>
+#include <player.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_blob_cache.h"
+
+// Keeps native players around for reuse, shared by all players of the
+// plugin. Creating and preparing a native player takes tens of
+// milliseconds, which is noticeable for sounds that are played over and
+// over again.
+//
+// A few created but unprepared players are kept ready to be given a
+// source, and the players that were last released while prepared are kept
+// prepared, rewound to the start, so that playing the same source again
+// needs no preparation at all.
+//
+// Must only be used on the main thread.
+class PlayerPool {
+ public:
+  PlayerPool() = default;
+  ~PlayerPool();
+
+  PlayerPool(const PlayerPool &) = delete;
+  PlayerPool &operator=(const PlayerPool &) = delete;
+
+  // Returns a player prepared with |source|, ready to be started from the
+  // start, or nullptr if there is none. Players still being rewound are
+  // skipped, since seeking them again would fail until then.
+  player_h AcquirePrepared(const std::string &source);
+  // Returns a player in the idle state, creating one if none is available.
+  int AcquireIdle(player_h *player);
+  // Takes |player| back. No callbacks may be set on it. If |source| is not
+  // empty, the player is prepared with it and is kept prepared if possible.
+  // |blob| is the memory the player was given as its source, if any.
+  void Recycle(player_h player, const std::string &source,
+               std::shared_ptr<const AudioBlob> blob);
+
+ private:
+  struct PreparedPlayer {
+    std::string source;
+    player_h player;
+    std::shared_ptr<const AudioBlob> blob;
+    // Set by the seek callback on another thread once the player has been
+    // rewound. Only freed after that, or after the player is unprepared or
+    // destroyed, which cancels the callback.
+    std::unique_ptr<std::atomic<bool>> rewound;
+  };
+
+  static void OnRewound(void *data);
+  static Eina_Bool OnIdle(void *data);
+
+  void RecycleIdle(player_h player);
+
+  // The most recently released player first.
+  std::list<PreparedPlayer> prepared_players_;
+  std::vector<player_h> idle_players_;
+  Ecore_Idler *idler_ = nullptr;
+};
+
+#endif  // PLAYER_POOL_H_
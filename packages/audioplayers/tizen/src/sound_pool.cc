@@ -0,0 +1,514 @@
+#include "sound_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <tizen.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio_player_error.h"
+#include "log.h"
+
+// The maximum total size of decoded sounds kept in the cache.
+#define SOUND_CACHE_CAPACITY (32 * 1024 * 1024)  // bytes
+// Frames mixed per write, about 5.8 ms. Commands are applied between writes.
+#define MIX_PERIOD_FRAMES 256
+// The output is released after being silent for this long by default.
+// Preparing it again delays the next sound by tens of milliseconds, so the
+// timeout is long enough to cover the pauses between sounds of most apps.
+#define DEFAULT_IDLE_TIMEOUT_MS 30000
+#define UNIT_STEP (1ULL << 32)
+
+struct SoundPool::LoadJob {
+  SoundPool *pool;  // null once the pool is destroyed
+  Ecore_Thread *thread = nullptr;
+  std::string key;
+  std::string url;
+  std::shared_ptr<const AudioBlob> blob;
+  std::vector<std::pair<const void *, SoundLoadedCallback>> callbacks;
+
+  std::shared_ptr<PcmSound> sound;
+  std::string error;
+};
+
+static int32_t VolumeToGain(double volume) {
+  return (int32_t)std::lround(std::clamp(volume, 0.0, 1.0) * 4096);
+}
+
+static uint64_t RateToStep(double rate) {
+  return (uint64_t)(std::clamp(rate, 0.25, 4.0) * UNIT_STEP);
+}
+
+SoundPool::SoundPool() : idle_timeout_ms_(DEFAULT_IDLE_TIMEOUT_MS) {
+  voice_event_pipe_ = ecore_pipe_add(OnVoiceEvents, this);
+  if (!voice_event_pipe_) {
+    LOG_ERROR("failed to add pipe for voice events");
+  }
+}
+
+SoundPool::~SoundPool() {
+  if (mixer_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    cv_.notify_one();
+    mixer_thread_.join();
+  }
+  if (audio_out_) {
+    audio_out_destroy(audio_out_);
+  }
+  if (voice_event_pipe_) {
+    ecore_pipe_del(voice_event_pipe_);
+  }
+  // Cancelling a job that has not started yet deletes it right away.
+  std::set<LoadJob *> jobs = std::move(load_jobs_);
+  for (LoadJob *job : jobs) {
+    job->pool = nullptr;
+    ecore_thread_cancel(job->thread);
+  }
+}
+
+std::shared_ptr<const PcmSound> SoundPool::Load(
+    const std::string &key, const std::string &url,
+    std::shared_ptr<const AudioBlob> blob, const void *owner,
+    SoundLoadedCallback callback) {
+  auto iter = cache_index_.find(key);
+  if (iter != cache_index_.end()) {
+    cache_.splice(cache_.begin(), cache_, iter->second);
+    return iter->second->second;
+  }
+  for (LoadJob *job : load_jobs_) {
+    if (job->key == key) {
+      job->callbacks.emplace_back(owner, std::move(callback));
+      return nullptr;
+    }
+  }
+
+  LOG_DEBUG("decode sound %s", key.c_str());
+  LoadJob *job = new LoadJob();
+  job->pool = this;
+  job->key = key;
+  job->url = url;
+  job->blob = std::move(blob);
+  job->callbacks.emplace_back(owner, std::move(callback));
+  load_jobs_.insert(job);
+  Ecore_Thread *thread =
+      ecore_thread_run(RunLoadJob, OnLoadJobEnd, OnLoadJobCancel, job);
+  if (!thread) {
+    // The cancel callback has already deleted the job.
+    throw AudioPlayerError("Internal error", "failed to start a thread");
+  }
+  job->thread = thread;
+  return nullptr;
+}
+
+void SoundPool::CancelLoads(const void *owner) {
+  for (LoadJob *job : load_jobs_) {
+    auto &callbacks = job->callbacks;
+    callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(),
+                                   [owner](const auto &entry) {
+                                     return entry.first == owner;
+                                   }),
+                    callbacks.end());
+  }
+}
+
+// Runs on a worker thread.
+void SoundPool::RunLoadJob(void *data, Ecore_Thread *thread) {
+  LoadJob *job = (LoadJob *)data;
+  job->sound = std::make_shared<PcmSound>();
+  try {
+    if (job->blob) {
+      DecodePcm(std::string(), job->blob->data, *job->sound);
+    } else {
+      DecodePcm(job->url, std::vector<uint8_t>(), *job->sound);
+    }
+  } catch (const AudioPlayerError &e) {
+    job->error = e.GetMessage() + " : " + e.GetCode();
+  }
+}
+
+// Runs on the main thread.
+void SoundPool::OnLoadJobEnd(void *data, Ecore_Thread *thread) {
+  LoadJob *job = (LoadJob *)data;
+  if (job->pool) {
+    job->pool->load_jobs_.erase(job);
+    std::shared_ptr<const PcmSound> sound;
+    if (job->error.empty()) {
+      sound = job->sound;
+      job->pool->CacheSound(job->key, sound);
+    } else {
+      LOG_ERROR("failed to decode sound %s : %s", job->key.c_str(),
+                job->error.c_str());
+    }
+    for (auto &entry : job->callbacks) {
+      entry.second(sound, job->error);
+    }
+  }
+  delete job;
+}
+
+// Runs on the main thread.
+void SoundPool::OnLoadJobCancel(void *data, Ecore_Thread *thread) {
+  LoadJob *job = (LoadJob *)data;
+  if (job->pool) {
+    job->pool->load_jobs_.erase(job);
+  }
+  delete job;
+}
+
+void SoundPool::CacheSound(const std::string &key,
+                           std::shared_ptr<const PcmSound> sound) {
+  size_t size = sound->samples.size() * sizeof(int16_t);
+  if (size > SOUND_CACHE_CAPACITY || cache_index_.count(key)) {
+    return;
+  }
+  cache_size_ += size;
+  cache_.emplace_front(key, std::move(sound));
+  cache_index_[key] = cache_.begin();
+  // Evicted sounds stay alive while they are being played.
+  while (cache_size_ > SOUND_CACHE_CAPACITY) {
+    cache_size_ -= cache_.back().second->samples.size() * sizeof(int16_t);
+    cache_index_.erase(cache_.back().first);
+    cache_.pop_back();
+  }
+}
+
+uint32_t SoundPool::Play(std::shared_ptr<const PcmSound> sound, double volume,
+                         double rate, bool looping,
+                         VoiceEndedCallback on_ended) {
+  EnsureMixerThread();
+  uint32_t voice = next_voice_id_++;
+  if (next_voice_id_ == 0) {
+    next_voice_id_ = 1;
+  }
+  voices_[voice] = std::move(on_ended);
+
+  Command command = {};
+  command.type = CommandType::kPlay;
+  command.voice = voice;
+  command.sound = std::move(sound);
+  command.gain = VolumeToGain(volume);
+  command.step = RateToStep(rate);
+  command.looping = looping;
+  PushCommand(command);
+  return voice;
+}
+
+void SoundPool::Stop(uint32_t voice) {
+  if (voices_.erase(voice)) {
+    PushCommand({CommandType::kStop, voice});
+  }
+}
+
+void SoundPool::Pause(uint32_t voice) {
+  PushCommand({CommandType::kPause, voice});
+}
+
+void SoundPool::Resume(uint32_t voice) {
+  PushCommand({CommandType::kResume, voice});
+}
+
+void SoundPool::Seek(uint32_t voice, int position) {
+  Command command = {CommandType::kSeek, voice};
+  command.position = ((uint64_t)std::max(position, 0) * kPcmSampleRate / 1000)
+                     << 32;
+  PushCommand(command);
+}
+
+void SoundPool::SetVolume(uint32_t voice, double volume) {
+  Command command = {CommandType::kSetGain, voice};
+  command.gain = VolumeToGain(volume);
+  PushCommand(command);
+}
+
+void SoundPool::SetRate(uint32_t voice, double rate) {
+  Command command = {CommandType::kSetStep, voice};
+  command.step = RateToStep(rate);
+  PushCommand(command);
+}
+
+void SoundPool::SetLooping(uint32_t voice, bool looping) {
+  Command command = {CommandType::kSetLooping, voice};
+  command.looping = looping;
+  PushCommand(command);
+}
+
+bool SoundPool::IsActive(uint32_t voice) const {
+  return voices_.count(voice) > 0;
+}
+
+int SoundPool::GetPosition(uint32_t voice) const {
+  for (size_t i = 0; i < kMaxVoices; i++) {
+    if (published_ids_[i] == voice) {
+      return (int64_t)published_positions_[i] * 1000 / kPcmSampleRate;
+    }
+  }
+  return 0;
+}
+
+// Runs on the main thread.
+void SoundPool::OnVoiceEvents(void *data, void *buffer, unsigned int size) {
+  SoundPool *pool = (SoundPool *)data;
+  const VoiceEvent *events = (const VoiceEvent *)buffer;
+  for (size_t i = 0; i < size / sizeof(VoiceEvent); i++) {
+    auto iter = pool->voices_.find(events[i].voice);
+    if (iter == pool->voices_.end()) {
+      // Already stopped.
+      continue;
+    }
+    VoiceEndedCallback on_ended = std::move(iter->second);
+    pool->voices_.erase(iter);
+    if (on_ended) {
+      on_ended(events[i].completed);
+    }
+  }
+}
+
+void SoundPool::SetIdleTimeout(int timeout) {
+  // Read by the mixer thread on every period.
+  idle_timeout_ms_ = timeout;
+}
+
+void SoundPool::PushCommand(const Command &command) {
+  if (!mixer_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands_.push_back(command);
+  }
+  cv_.notify_one();
+}
+
+void SoundPool::EnsureMixerThread() {
+  if (mixer_thread_.joinable()) {
+    return;
+  }
+  if (!audio_out_) {
+    int result = audio_out_create_new(kPcmSampleRate, AUDIO_CHANNEL_STEREO,
+                                      AUDIO_SAMPLE_TYPE_S16_LE, &audio_out_);
+    if (result != AUDIO_IO_ERROR_NONE) {
+      audio_out_ = nullptr;
+      std::string error(get_error_message(result));
+      LOG_ERROR("audio_out_create_new failed : %s", error.c_str());
+      throw AudioPlayerError(error, "audio_out_create_new failed");
+    }
+  }
+  running_ = true;
+  mixer_thread_ = std::thread(&SoundPool::MixerLoop, this);
+}
+
+void SoundPool::MixerLoop() {
+  // Writes must not be delayed by other work, or the output underruns.
+  sched_param param = {};
+  int min_priority = sched_get_priority_min(SCHED_FIFO);
+  int max_priority = sched_get_priority_max(SCHED_FIFO);
+  param.sched_priority = (min_priority + max_priority) / 2;
+  int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (result != 0) {
+    LOG_INFO("mixer thread runs without real-time priority : %d", result);
+  }
+
+  std::vector<int16_t> output(MIX_PERIOD_FRAMES * kPcmChannels);
+  mix_buffer_.resize(MIX_PERIOD_FRAMES * kPcmChannels);
+  std::vector<Command> commands;
+  std::vector<VoiceEvent> events;
+  bool prepared = false;
+  size_t idle_periods = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!prepared) {
+        // Nothing is playing, so sleep until a command arrives.
+        cv_.wait(lock, [this] { return !running_ || !commands_.empty(); });
+      }
+      if (!running_) {
+        break;
+      }
+      commands.swap(commands_);
+    }
+    for (const Command &command : commands) {
+      ApplyCommand(command, events);
+    }
+    commands.clear();
+
+    bool active = Mix(output.data(), MIX_PERIOD_FRAMES, events);
+    PublishPositions();
+    if (!events.empty() && voice_event_pipe_) {
+      ecore_pipe_write(voice_event_pipe_, events.data(),
+                       events.size() * sizeof(VoiceEvent));
+      events.clear();
+    }
+
+    int idle_timeout = idle_timeout_ms_;
+    size_t idle_periods_limit =
+        (size_t)std::max(idle_timeout, 0) * kPcmSampleRate / 1000 /
+        MIX_PERIOD_FRAMES;
+    if (active) {
+      idle_periods = 0;
+    } else if (++idle_periods >= idle_periods_limit && idle_timeout >= 0 &&
+               prepared) {
+      LOG_DEBUG("release idle audio output");
+      audio_out_unprepare(audio_out_);
+      prepared = false;
+    }
+    if (!active && !prepared) {
+      continue;
+    }
+    if (!prepared) {
+      result = audio_out_prepare(audio_out_);
+      if (result != AUDIO_IO_ERROR_NONE) {
+        LOG_ERROR("audio_out_prepare failed : %s", get_error_message(result));
+        // The voices cannot be heard, so end them rather than wait.
+        for (Voice &voice : mixer_voices_) {
+          if (voice.id != 0) {
+            events.push_back({voice.id, false});
+            voice = Voice();
+          }
+        }
+        PublishPositions();
+        if (!events.empty() && voice_event_pipe_) {
+          ecore_pipe_write(voice_event_pipe_, events.data(),
+                           events.size() * sizeof(VoiceEvent));
+        }
+        events.clear();
+        continue;
+      }
+      prepared = true;
+    }
+    // Blocks until the output has room, which paces the loop.
+    audio_out_write(audio_out_, output.data(),
+                    output.size() * sizeof(int16_t));
+  }
+  if (prepared) {
+    audio_out_unprepare(audio_out_);
+  }
+}
+
+void SoundPool::ApplyCommand(const Command &command,
+                             std::vector<VoiceEvent> &events) {
+  if (command.type == CommandType::kPlay) {
+    Voice *slot = nullptr;
+    for (Voice &voice : mixer_voices_) {
+      if (voice.id == 0) {
+        slot = &voice;
+        break;
+      }
+    }
+    if (!slot) {
+      // Steal the oldest voice, preferring one that is not looping.
+      for (Voice &voice : mixer_voices_) {
+        if (!slot || (slot->looping && !voice.looping) ||
+            (slot->looping == voice.looping && voice.started < slot->started)) {
+          slot = &voice;
+        }
+      }
+      LOG_INFO("all voices are busy, steal voice %u", slot->id);
+      events.push_back({slot->id, false});
+    }
+    *slot = Voice();
+    slot->id = command.voice;
+    slot->sound = command.sound;
+    slot->step = command.step;
+    slot->gain = command.gain;
+    slot->looping = command.looping;
+    slot->started = started_count_++;
+    return;
+  }
+
+  for (Voice &voice : mixer_voices_) {
+    if (voice.id != command.voice) {
+      continue;
+    }
+    switch (command.type) {
+      case CommandType::kStop:
+        voice = Voice();
+        break;
+      case CommandType::kPause:
+        voice.paused = true;
+        break;
+      case CommandType::kResume:
+        voice.paused = false;
+        break;
+      case CommandType::kSeek:
+        // Past the end, the voice ends or loops on the next mix.
+        voice.position = command.position;
+        break;
+      case CommandType::kSetGain:
+        voice.gain = command.gain;
+        break;
+      case CommandType::kSetStep:
+        voice.step = command.step;
+        break;
+      case CommandType::kSetLooping:
+        voice.looping = command.looping;
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+}
+
+bool SoundPool::Mix(int16_t *output, size_t frames,
+                    std::vector<VoiceEvent> &events) {
+  int32_t *mix = mix_buffer_.data();
+  std::fill(mix, mix + frames * kPcmChannels, 0);
+  bool active = false;
+  for (Voice &voice : mixer_voices_) {
+    if (voice.id == 0) {
+      continue;
+    }
+    if (voice.paused) {
+      continue;
+    }
+    active = true;
+    const int16_t *samples = voice.sound->samples.data();
+    size_t frame_count = voice.sound->GetFrameCount();
+    uint64_t length = (uint64_t)frame_count << 32;
+    for (size_t i = 0; i < frames; i++) {
+      if (voice.position >= length) {
+        if (!voice.looping) {
+          break;
+        }
+        voice.position %= length;
+      }
+      size_t frame = voice.position >> 32;
+      int32_t left = samples[frame * 2];
+      int32_t right = samples[frame * 2 + 1];
+      if (voice.step != UNIT_STEP) {
+        // Interpolate between source frames when resampling.
+        size_t next = frame + 1 < frame_count ? frame + 1
+                                               : (voice.looping ? 0 : frame);
+        int32_t fraction = (voice.position >> 16) & 0xffff;
+        int64_t next_left = samples[next * 2];
+        int64_t next_right = samples[next * 2 + 1];
+        left += (int32_t)((next_left - left) * fraction >> 16);
+        right += (int32_t)((next_right - right) * fraction >> 16);
+      }
+      mix[i * 2] += (left * voice.gain) >> 12;
+      mix[i * 2 + 1] += (right * voice.gain) >> 12;
+      voice.position += voice.step;
+    }
+    if (voice.position >= length && !voice.looping) {
+      events.push_back({voice.id, true});
+      voice = Voice();
+    }
+  }
+
+  for (size_t i = 0; i < frames * kPcmChannels; i++) {
+    output[i] = (int16_t)std::clamp(mix[i], -32768, 32767);
+  }
+  return active;
+}
+
+void SoundPool::PublishPositions() {
+  for (size_t i = 0; i < kMaxVoices; i++) {
+    const Voice &voice = mixer_voices_[i];
+    published_ids_[i] = voice.id;
+    published_positions_[i] = (uint32_t)(voice.position >> 32);
+  }
+}
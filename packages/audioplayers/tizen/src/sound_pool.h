@@ -0,0 +1,162 @@
+#ifndef SOUND_POOL_H_
+#define SOUND_POOL_H_
+
+#include <Ecore.h>
+#include <audio_io.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "audio_blob_cache.h"
+#include "pcm_decoder.h"
+
+using SoundLoadedCallback =
+    std::function<void(std::shared_ptr<const PcmSound> sound,
+                       const std::string &error)>;
+// |completed| is false if the voice was stopped or stolen.
+using VoiceEndedCallback = std::function<void(bool completed)>;
+
+// Plays short sounds with low latency. Sounds are decoded once into PCM and
+// cached, and all voices are mixed into a single audio output on a
+// real-time thread. When all voices are busy, starting a new one steals the
+// oldest voice.
+//
+// All methods must be called on the main thread, which is also where the
+// callbacks are called.
+class SoundPool {
+ public:
+  SoundPool();
+  ~SoundPool();
+
+  // Returns the sound cached under |key|, or nullptr after starting to
+  // decode |blob|, or |url| if |blob| is null, in the background. In the
+  // latter case |callback| is called with the result unless the load is
+  // cancelled with CancelLoads(|owner|).
+  std::shared_ptr<const PcmSound> Load(const std::string &key,
+                                       const std::string &url,
+                                       std::shared_ptr<const AudioBlob> blob,
+                                       const void *owner,
+                                       SoundLoadedCallback callback);
+  void CancelLoads(const void *owner);
+
+  // Starts playing |sound| and returns the ID of the voice. |on_ended| is
+  // called when the voice ends by itself or is stolen, but not when it is
+  // stopped.
+  uint32_t Play(std::shared_ptr<const PcmSound> sound, double volume,
+                double rate, bool looping, VoiceEndedCallback on_ended);
+  void Stop(uint32_t voice);
+  void Pause(uint32_t voice);
+  void Resume(uint32_t voice);
+  void Seek(uint32_t voice, int position);  // milliseconds
+  void SetVolume(uint32_t voice, double volume);
+  void SetRate(uint32_t voice, double rate);
+  void SetLooping(uint32_t voice, bool looping);
+  bool IsActive(uint32_t voice) const;
+  int GetPosition(uint32_t voice) const;  // milliseconds
+  // Sets how long the audio output stays prepared while no voice is
+  // playing. Starting a voice after the output was released takes longer.
+  // A negative |timeout| keeps the output prepared until the pool is
+  // destroyed.
+  void SetIdleTimeout(int timeout);  // milliseconds
+
+ private:
+  struct LoadJob;
+
+  enum class CommandType {
+    kPlay,
+    kStop,
+    kPause,
+    kResume,
+    kSeek,
+    kSetGain,
+    kSetStep,
+    kSetLooping
+  };
+
+  struct Command {
+    CommandType type;
+    uint32_t voice;
+    std::shared_ptr<const PcmSound> sound;
+    int32_t gain;       // Q12
+    uint64_t step;      // source frames per output frame, 32.32 fixed point
+    uint64_t position;  // frames, 32.32 fixed point
+    bool looping;
+  };
+
+  // Only accessed on the mixer thread.
+  struct Voice {
+    uint32_t id = 0;
+    std::shared_ptr<const PcmSound> sound;
+    uint64_t position = 0;  // frames, 32.32 fixed point
+    uint64_t step = 0;
+    int32_t gain = 0;
+    bool looping = false;
+    bool paused = false;
+    uint64_t started = 0;  // order of starting, for voice stealing
+  };
+
+  struct VoiceEvent {
+    uint32_t voice;
+    bool completed;
+  };
+
+  static void RunLoadJob(void *data, Ecore_Thread *thread);
+  static void OnLoadJobEnd(void *data, Ecore_Thread *thread);
+  static void OnLoadJobCancel(void *data, Ecore_Thread *thread);
+  static void OnVoiceEvents(void *data, void *buffer, unsigned int size);
+
+  void CacheSound(const std::string &key,
+                  std::shared_ptr<const PcmSound> sound);
+  void PushCommand(const Command &command);
+  void EnsureMixerThread();
+  void MixerLoop();
+  void ApplyCommand(const Command &command, std::vector<VoiceEvent> &events);
+  // Mixes the active voices into |output|, and returns whether any voice is
+  // playing. Paused voices do not keep the output prepared.
+  bool Mix(int16_t *output, size_t frames, std::vector<VoiceEvent> &events);
+  void PublishPositions();
+
+  // Sound cache, the most recently used sound first.
+  using CacheEntry = std::pair<std::string, std::shared_ptr<const PcmSound>>;
+  std::list<CacheEntry> cache_;
+  std::unordered_map<std::string, std::list<CacheEntry>::iterator>
+      cache_index_;
+  size_t cache_size_ = 0;  // bytes
+  std::set<LoadJob *> load_jobs_;
+
+  // Main thread state of the voices.
+  uint32_t next_voice_id_ = 1;
+  std::map<uint32_t, VoiceEndedCallback> voices_;
+  Ecore_Pipe *voice_event_pipe_ = nullptr;
+
+  // Mixer thread and the commands passed to it.
+  std::thread mixer_thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Command> commands_;
+  bool running_ = false;
+  audio_out_h audio_out_ = nullptr;
+  std::atomic<int> idle_timeout_ms_;
+
+  static constexpr size_t kMaxVoices = 16;
+  std::array<Voice, kMaxVoices> mixer_voices_;
+  std::vector<int32_t> mix_buffer_;
+  uint64_t started_count_ = 0;
+  // Published by the mixer thread for GetPosition().
+  std::array<std::atomic<uint32_t>, kMaxVoices> published_ids_{};
+  std::array<std::atomic<uint32_t>, kMaxVoices> published_positions_{};
+};
+
+#endif  // SOUND_POOL_H_
@@ -0,0 +1,241 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "batch_resizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <thread>
+
+#include "log.h"
+
+// Each worker holds a decoded and a scaled image at most, so this also caps
+// the memory used by a batch.
+#define MAX_WORKERS 4
+
+// The value of Batch::jobs for files that need no resizing.
+#define NO_JOB SIZE_MAX
+
+struct BatchResizer::Batch {
+  BatchResizer* resizer;  // null once the resizer is destroyed
+  // The resized copies missing from the cache: the file to resize, and the
+  // name and path of its copy in the cache.
+  std::vector<std::string> files;
+  std::vector<std::string> names;
+  std::vector<std::string> targets;
+  // Each slot is written by the worker that took its index, and read on the
+  // main thread once the worker has reported it.
+  std::vector<uint8_t> resized;
+  std::atomic<size_t> next_index{0};
+  // For each requested file, its index in |files|, or NO_JOB if its slot
+  // in |paths| is already filled in.
+  std::vector<size_t> jobs;
+  std::vector<std::string> paths;
+  size_t cache_hits = 0;
+  BatchResizeCallback callback;
+
+  // Only accessed on the main thread.
+  size_t reported = 0;
+  size_t running_workers = 0;
+  bool done = false;
+};
+
+struct BatchResizer::Worker {
+  std::shared_ptr<Batch> batch;
+  std::unique_ptr<ImageResize> image_resize;
+  Ecore_Thread* thread = nullptr;
+};
+
+static size_t GetWorkerCount(size_t file_count) {
+  size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  return std::min({file_count, cores, (size_t)MAX_WORKERS});
+}
+
+BatchResizer::~BatchResizer() {
+  // Cancelling a worker that has not started yet finishes it right away.
+  std::vector<Worker*> workers = std::move(workers_);
+  for (Worker* worker : workers) {
+    worker->batch->resizer = nullptr;
+    ecore_thread_cancel(worker->thread);
+  }
+}
+
+void BatchResizer::SetSize(unsigned int w, unsigned int h, int q) {
+  max_width_ = w;
+  max_height_ = h;
+  quality_ = q;
+}
+
+void BatchResizer::SetFilter(std::optional<ResampleFilter> filter) {
+  filter_ = filter;
+}
+
+void BatchResizer::SetCopyExif(bool copy_exif) { copy_exif_ = copy_exif; }
+
+void BatchResizer::SetCacheCapacity(int64_t capacity) {
+  cache_.SetCapacity(capacity);
+}
+
+void BatchResizer::Resize(const std::vector<std::string>& files,
+                          BatchResizeCallback callback) {
+  if (max_width_ == 0 && max_height_ == 0 &&
+      (quality_ <= 0 || quality_ > 100)) {
+    callback(files);
+    return;
+  }
+
+  char options[64];
+  snprintf(options, sizeof(options), "%u %u %d %d %d", max_width_,
+           max_height_, quality_, filter_ ? (int)*filter_ : -1, copy_exif_);
+
+  auto batch = std::make_shared<Batch>();
+  batch->resizer = this;
+  batch->jobs.resize(files.size(), NO_JOB);
+  batch->paths.resize(files.size());
+  batch->callback = std::move(callback);
+
+  // Copies picked twice in a batch are only resized once.
+  std::map<std::string, size_t> jobs;
+  for (size_t i = 0; i < files.size(); i++) {
+    std::string name = cache_.GetName(files[i], options);
+    if (name.empty()) {
+      batch->paths[i] = files[i];
+    } else if (cache_.Lookup(name)) {
+      LOG_DEBUG("use cached copy of %s", files[i].c_str());
+      batch->paths[i] = cache_.GetPath(name);
+      batch->cache_hits++;
+    } else if (jobs.count(name)) {
+      batch->jobs[i] = jobs[name];
+    } else {
+      batch->jobs[i] = jobs[name] = batch->files.size();
+      batch->files.push_back(files[i]);
+      batch->targets.push_back(cache_.GetPath(name));
+      batch->names.push_back(std::move(name));
+    }
+  }
+  batch->resized.resize(batch->files.size());
+
+  // Keeps the batch from completing while the workers are being started.
+  batch->running_workers++;
+
+  size_t count = GetWorkerCount(batch->files.size());
+  LOG_DEBUG("resize %zu images on %zu workers", batch->files.size(), count);
+  for (size_t i = 0; i < count; i++) {
+    Worker* worker = new Worker();
+    worker->batch = batch;
+    if (!idle_resizers_.empty()) {
+      worker->image_resize = std::move(idle_resizers_.back());
+      idle_resizers_.pop_back();
+    } else {
+      worker->image_resize = std::make_unique<ImageResize>();
+    }
+    worker->image_resize->SetSize(max_width_, max_height_, quality_);
+    worker->image_resize->SetFilter(filter_);
+    worker->image_resize->SetCopyExif(copy_exif_);
+    workers_.push_back(worker);
+    batch->running_workers++;
+
+    Ecore_Thread* thread =
+        ecore_thread_feedback_run(RunWorker, OnWorkerFeedback, OnWorkerEnd,
+                                  OnWorkerCancel, worker, EINA_FALSE);
+    if (!thread) {
+      // The cancel callback has already finished the worker.
+      LOG_ERROR("failed to start a resize worker");
+      continue;
+    }
+    worker->thread = thread;
+  }
+
+  // Files left over because no worker could be started keep their original
+  // path.
+  if (--batch->running_workers == 0) {
+    CompleteBatch(batch.get());
+  }
+}
+
+// Runs on a worker thread.
+void BatchResizer::RunWorker(void* data, Ecore_Thread* thread) {
+  Worker* worker = (Worker*)data;
+  Batch* batch = worker->batch.get();
+  while (!ecore_thread_check(thread)) {
+    size_t index = batch->next_index++;
+    if (index >= batch->files.size()) {
+      break;
+    }
+    batch->resized[index] = worker->image_resize->Resize(
+        batch->files[index], batch->targets[index]);
+    ecore_thread_feedback(thread, nullptr);
+  }
+}
+
+// Runs on the main thread, once for every image a worker is done with.
+void BatchResizer::OnWorkerFeedback(void* data, Ecore_Thread* thread,
+                                    void* msg_data) {
+  Batch* batch = ((Worker*)data)->batch.get();
+  if (++batch->reported == batch->files.size()) {
+    CompleteBatch(batch);
+  }
+}
+
+// Runs on the main thread.
+void BatchResizer::OnWorkerEnd(void* data, Ecore_Thread* thread) {
+  FinishWorker((Worker*)data);
+}
+
+// Runs on the main thread.
+void BatchResizer::OnWorkerCancel(void* data, Ecore_Thread* thread) {
+  FinishWorker((Worker*)data);
+}
+
+void BatchResizer::FinishWorker(Worker* worker) {
+  std::shared_ptr<Batch> batch = worker->batch;
+  BatchResizer* resizer = batch->resizer;
+  if (resizer) {
+    auto& workers = resizer->workers_;
+    workers.erase(std::remove(workers.begin(), workers.end(), worker),
+                  workers.end());
+    resizer->idle_resizers_.push_back(std::move(worker->image_resize));
+  }
+  delete worker;
+
+  // All files have been resized once the last worker is gone, even those
+  // whose feedback was dropped.
+  if (--batch->running_workers == 0) {
+    CompleteBatch(batch.get());
+  }
+}
+
+void BatchResizer::CompleteBatch(Batch* batch) {
+  if (batch->done) {
+    return;
+  }
+  batch->done = true;
+  BatchResizer* resizer = batch->resizer;
+  if (!resizer) {
+    // The copies are not in the index, so they are removed on next start.
+    return;
+  }
+  // Files that failed to resize, or were not reached, keep their original
+  // path.
+  size_t added = 0;
+  for (size_t i = 0; i < batch->files.size(); i++) {
+    if (batch->resized[i]) {
+      resizer->cache_.Add(batch->names[i]);
+      added++;
+    }
+  }
+  resizer->cache_.Commit(batch->cache_hits + added);
+
+  for (size_t i = 0; i < batch->jobs.size(); i++) {
+    size_t job = batch->jobs[i];
+    if (job != NO_JOB) {
+      batch->paths[i] =
+          batch->resized[job] ? batch->targets[job] : batch->files[job];
+    }
+  }
+  batch->callback(batch->paths);
+}
@@ -0,0 +1,69 @@
+#ifndef FLUTTER_PLUGIN_BATCH_RESIZER_H_
+#define FLUTTER_PLUGIN_BATCH_RESIZER_H_
+
+#include <Ecore.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "image_resize.h"
+#include "resize_cache.h"
+
+// |paths| holds a path for each of the requested files, in the same order:
+// the resized copy, or the original file if it was not resized.
+using BatchResizeCallback =
+    std::function<void(const std::vector<std::string>& paths)>;
+
+// Resizes a batch of images on a few worker threads. Each worker holds at
+// most one decoded image at a time, which bounds the memory used by a batch
+// regardless of its size. Workers keep their ImageResize, and with it the
+// image_util handles, for the following images and batches. Resized copies
+// are kept in a ResizeCache, and images found there are not resized again.
+//
+// Must only be used on the main thread, which is also where the callback is
+// called.
+class BatchResizer {
+ public:
+  BatchResizer() {}
+  ~BatchResizer();
+
+  BatchResizer(const BatchResizer&) = delete;
+  BatchResizer& operator=(const BatchResizer&) = delete;
+
+  void SetSize(unsigned int w, unsigned int h, int q);
+  void SetFilter(std::optional<ResampleFilter> filter);
+  void SetCopyExif(bool copy_exif);
+  void SetCacheCapacity(int64_t capacity);  // bytes
+  void Resize(const std::vector<std::string>& files,
+              BatchResizeCallback callback);
+
+ private:
+  struct Batch;
+  struct Worker;
+
+  static void RunWorker(void* data, Ecore_Thread* thread);
+  static void OnWorkerFeedback(void* data, Ecore_Thread* thread,
+                               void* msg_data);
+  static void OnWorkerEnd(void* data, Ecore_Thread* thread);
+  static void OnWorkerCancel(void* data, Ecore_Thread* thread);
+
+  static void FinishWorker(Worker* worker);
+  static void CompleteBatch(Batch* batch);
+
+  unsigned int max_width_ = 0;
+  unsigned int max_height_ = 0;
+  int quality_ = 0;
+  std::optional<ResampleFilter> filter_;
+  bool copy_exif_ = false;
+
+  // Resizers not in use by a worker.
+  std::vector<std::unique_ptr<ImageResize>> idle_resizers_;
+  std::vector<Worker*> workers_;
+  ResizeCache cache_;
+};
+
+#endif
@@ -19,8 +19,9 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
-#include "image_resize.h"
+#include "batch_resizer.h"
 #include "log.h"
 
 enum class ImageSource {
@@ -65,6 +66,17 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
     LOG_DEBUG("method : %s", method_call.method_name().data());
 
+    if (method_call.method_name().compare("setResizeFilter") == 0) {
+      SetResizeFilter(*method_call.arguments(), std::move(result));
+      return;
+    } else if (method_call.method_name().compare("setCopyExif") == 0) {
+      SetCopyExif(*method_call.arguments(), std::move(result));
+      return;
+    } else if (method_call.method_name().compare("setCacheSize") == 0) {
+      SetCacheSize(*method_call.arguments(), std::move(result));
+      return;
+    }
+
     if (result_) {
       SendResultWithError("already_active", "Cancelled by a second request");
       return;
@@ -75,8 +87,6 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
 
     ImageSource source = ImageSource::GALLERY;
     if (method_call.method_name().compare("pickImage") == 0) {
-      double width = 0.0, height = 0.0;
-      int quality = 0;
       if (std::holds_alternative<flutter::EncodableMap>(arguments)) {
         flutter::EncodableMap values =
             std::get<flutter::EncodableMap>(arguments);
@@ -84,26 +94,13 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
         if (std::holds_alternative<int>(s)) {
           source = (ImageSource)std::get<int>(s);
         }
-        auto w = values[flutter::EncodableValue("maxWidth")];
-        if (std::holds_alternative<double>(w)) {
-          width = std::get<double>(w);
-        }
-        auto h = values[flutter::EncodableValue("maxHeight")];
-        if (std::holds_alternative<double>(h)) {
-          height = std::get<double>(h);
-        }
-        auto q = values[flutter::EncodableValue("imageQuality")];
-        if (std::holds_alternative<int>(q)) {
-          quality = std::get<int>(q);
-        }
-        image_resize_.SetSize((unsigned int)width, (unsigned int)height,
-                              quality);
-
+        SetResizeOptions(values);
       } else {
         SendResultWithError("Invalid arguments");
         return;
       }
 
+      multi_selection_ = false;
       if (source == ImageSource::CAMERA) {
         // TODO: we need to check this feature after webcam is prepared
         SendResultWithError("Not supported on this device");
@@ -113,6 +110,17 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
         SendResultWithError("Invalid image source");
       }
 
+    } else if (method_call.method_name().compare("pickMultiImage") == 0) {
+      if (std::holds_alternative<flutter::EncodableMap>(arguments)) {
+        SetResizeOptions(std::get<flutter::EncodableMap>(arguments));
+      } else {
+        SendResultWithError("Invalid arguments");
+        return;
+      }
+
+      multi_selection_ = true;
+      CheckPermissionAndPickImage("image");
+
     } else if (method_call.method_name().compare("pickVideo") == 0) {
       if (std::holds_alternative<flutter::EncodableMap>(arguments)) {
         flutter::EncodableMap values =
@@ -126,6 +134,7 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
         return;
       }
 
+      multi_selection_ = false;
       if (source == ImageSource::CAMERA) {
         // TODO: we need to check this feature after webcam is prepared
         SendResultWithError("Not supported on this device");
@@ -140,6 +149,92 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
     }
   }
 
+  void SetResizeOptions(const flutter::EncodableMap &arguments) {
+    flutter::EncodableMap values = arguments;
+    double width = 0.0, height = 0.0;
+    int quality = 0;
+    auto w = values[flutter::EncodableValue("maxWidth")];
+    if (std::holds_alternative<double>(w)) {
+      width = std::get<double>(w);
+    }
+    auto h = values[flutter::EncodableValue("maxHeight")];
+    if (std::holds_alternative<double>(h)) {
+      height = std::get<double>(h);
+    }
+    auto q = values[flutter::EncodableValue("imageQuality")];
+    if (std::holds_alternative<int>(q)) {
+      quality = std::get<int>(q);
+    }
+    batch_resizer_.SetSize((unsigned int)width, (unsigned int)height,
+                           quality);
+  }
+
+  // Selects how picked images are scaled: "imageUtil", the default, or one
+  // of the filters of ImageResampler.
+  void SetResizeFilter(
+      const flutter::EncodableValue &arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    std::string name;
+    if (std::holds_alternative<flutter::EncodableMap>(arguments)) {
+      flutter::EncodableMap values =
+          std::get<flutter::EncodableMap>(arguments);
+      auto f = values[flutter::EncodableValue("filter")];
+      if (std::holds_alternative<std::string>(f)) {
+        name = std::get<std::string>(f);
+      }
+    }
+    ResampleFilter filter;
+    if (name == "imageUtil") {
+      batch_resizer_.SetFilter(std::nullopt);
+    } else if (ParseResampleFilter(name, filter)) {
+      batch_resizer_.SetFilter(filter);
+    } else {
+      result->Error("Invalid arguments", "Unknown filter: " + name);
+      return;
+    }
+    result->Success();
+  }
+
+  // Selects whether resized JPEG images keep the EXIF fields of the picked
+  // image that still apply to them.
+  void SetCopyExif(
+      const flutter::EncodableValue &arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    if (std::holds_alternative<flutter::EncodableMap>(arguments)) {
+      flutter::EncodableMap values =
+          std::get<flutter::EncodableMap>(arguments);
+      auto e = values[flutter::EncodableValue("enabled")];
+      if (std::holds_alternative<bool>(e)) {
+        batch_resizer_.SetCopyExif(std::get<bool>(e));
+        result->Success();
+        return;
+      }
+    }
+    result->Error("Invalid arguments");
+  }
+
+  // Sets the size in bytes up to which resized images are kept for when the
+  // same image is picked again with the same options.
+  void SetCacheSize(
+      const flutter::EncodableValue &arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    if (std::holds_alternative<flutter::EncodableMap>(arguments)) {
+      flutter::EncodableMap values =
+          std::get<flutter::EncodableMap>(arguments);
+      auto s = values[flutter::EncodableValue("size")];
+      if (std::holds_alternative<int32_t>(s)) {
+        batch_resizer_.SetCacheCapacity(std::get<int32_t>(s));
+        result->Success();
+        return;
+      } else if (std::holds_alternative<int64_t>(s)) {
+        batch_resizer_.SetCacheCapacity(std::get<int64_t>(s));
+        result->Success();
+        return;
+      }
+    }
+    result->Error("Invalid arguments");
+  }
+
   void CheckPermissionAndPickImage(const std::string &mimeType) {
 #ifndef TV_PROFILE
     const char *privilege = "http://tizen.org/privilege/mediastorage";
@@ -188,6 +283,12 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
     mime_type_ = "";
     RET_IF_ERROR(ret);
 
+    if (multi_selection_) {
+      ret = app_control_add_extra_data(handle, APP_CONTROL_DATA_SELECTION_MODE,
+                                       "multiple");
+      RET_IF_ERROR(ret);
+    }
+
     ret = app_control_send_launch_request(handle, PickImageReplyCb, this);
     RET_IF_ERROR(ret);
 
@@ -233,30 +334,41 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
       return;
     }
 
-    if (count == 1) {
-      LOG_INFO("image path: %s", value[0]);
-      std::string src_path = value[0];
-      std::string dst_path;
-      if (plugin->image_resize_.Resize(src_path, dst_path)) {
-        plugin->SendResultWithSuccess(dst_path);
-      } else {
-        plugin->SendResultWithSuccess(src_path);
-      }
-      free(value[0]);
-    } else {
+    if (count == 0 || (count > 1 && !plugin->multi_selection_)) {
       plugin->SendResultWithError("Not Found Images");
+    } else {
+      std::vector<std::string> files;
+      for (int i = 0; i < count; i++) {
+        LOG_INFO("image path: %s", value[i]);
+        files.push_back(value[i]);
+      }
+      plugin->batch_resizer_.Resize(
+          files, [plugin](const std::vector<std::string> &paths) {
+            if (plugin->multi_selection_) {
+              flutter::EncodableList list;
+              for (const std::string &path : paths) {
+                list.push_back(flutter::EncodableValue(path));
+              }
+              plugin->SendResultWithSuccess(flutter::EncodableValue(list));
+            } else {
+              plugin->SendResultWithSuccess(flutter::EncodableValue(paths[0]));
+            }
+          });
     }
 
     if (value) {
+      for (int i = 0; i < count; i++) {
+        free(value[i]);
+      }
       free(value);
     }
   }
 
-  void SendResultWithSuccess(std::string imagePath) {
+  void SendResultWithSuccess(const flutter::EncodableValue &value) {
     if (result_ == nullptr) {
       return;
     }
-    result_->Success(flutter::EncodableValue(imagePath));
+    result_->Success(value);
     result_ = nullptr;
   }
 
@@ -273,7 +385,8 @@ class ImagePickerTizenPlugin : public flutter::Plugin {
     mime_type_ = mimeType + "/*";
   }
 
-  ImageResize image_resize_;
+  BatchResizer batch_resizer_;
+  bool multi_selection_ = false;
   std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result_;
   std::string mime_type_;
 };
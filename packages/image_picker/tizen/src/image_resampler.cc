@@ -0,0 +1,398 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "image_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+// Weights are fixed point numbers with this many fractional bits, so that
+// they fit in 16 bits together with the sign and the overshoot of Lanczos.
+#define PRECISION_BITS 14
+// Output rows produced per band.
+#define BAND_ROWS 16
+
+static double Sinc(double x) {
+  if (x == 0.0) {
+    return 1.0;
+  }
+  x *= M_PI;
+  return std::sin(x) / x;
+}
+
+static double GetSupport(ResampleFilter filter) {
+  switch (filter) {
+    case ResampleFilter::kBox:
+      return 0.5;
+    case ResampleFilter::kBilinear:
+      return 1.0;
+    case ResampleFilter::kLanczos:
+    default:
+      return 3.0;
+  }
+}
+
+static double ApplyFilter(ResampleFilter filter, double x) {
+  switch (filter) {
+    case ResampleFilter::kBox:
+      return x > -0.5 && x <= 0.5 ? 1.0 : 0.0;
+    case ResampleFilter::kBilinear:
+      x = std::fabs(x);
+      return x < 1.0 ? 1.0 - x : 0.0;
+    case ResampleFilter::kLanczos:
+    default:
+      return x > -3.0 && x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+  }
+}
+
+static inline uint8_t Clamp(int32_t value) {
+  return value < 0 ? 0 : value > 255 ? 255 : (uint8_t)value;
+}
+
+bool ParseResampleFilter(const std::string& name, ResampleFilter& filter) {
+  if (name == "box") {
+    filter = ResampleFilter::kBox;
+  } else if (name == "bilinear") {
+    filter = ResampleFilter::kBilinear;
+  } else if (name == "lanczos") {
+    filter = ResampleFilter::kLanczos;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void ImageResampler::ComputeKernel(unsigned int src_size,
+                                   unsigned int dst_size,
+                                   ResampleFilter filter, Kernel& kernel) {
+  double scale = (double)src_size / dst_size;
+  // Widen the filter when scaling down, so that every source pixel counts.
+  double filter_scale = std::max(scale, 1.0);
+  double support = GetSupport(filter) * filter_scale;
+  int size = (int)std::ceil(support) * 2 + 1;
+
+  kernel.size = size;
+  kernel.start.resize(dst_size);
+  kernel.count.resize(dst_size);
+  kernel.weights.assign((size_t)dst_size * size, 0);
+
+  std::vector<double> weights(size);
+  for (unsigned int i = 0; i < dst_size; i++) {
+    double center = (i + 0.5) * scale;
+    int start = std::max((int)(center - support + 0.5), 0);
+    int end = std::min((int)(center + support + 0.5), (int)src_size);
+    int count = std::min(std::max(end - start, 1), size);
+    start = std::min(start, (int)src_size - count);
+
+    double total = 0.0;
+    for (int j = 0; j < count; j++) {
+      weights[j] =
+          ApplyFilter(filter, (start + j - center + 0.5) / filter_scale);
+      total += weights[j];
+    }
+    if (total == 0.0) {
+      weights[0] = total = 1.0;
+    }
+
+    // Round to fixed point, and put the rounding error on the largest
+    // weight so that the weights still add up to exactly one.
+    int16_t* fixed = &kernel.weights[(size_t)i * size];
+    int sum = 0;
+    int largest = 0;
+    for (int j = 0; j < count; j++) {
+      fixed[j] =
+          (int16_t)std::lround(weights[j] / total * (1 << PRECISION_BITS));
+      sum += fixed[j];
+      if (fixed[j] > fixed[largest]) {
+        largest = j;
+      }
+    }
+    fixed[largest] += (1 << PRECISION_BITS) - sum;
+
+    kernel.start[i] = start;
+    kernel.count[i] = count;
+  }
+}
+
+void ImageResampler::ScaleRow(const uint8_t* src, uint8_t* dst,
+                              unsigned int dst_width) {
+  const Kernel& kernel = horizontal_;
+  for (unsigned int x = 0; x < dst_width; x++) {
+    const uint8_t* pixels = src + (size_t)kernel.start[x] * 4;
+    const int16_t* weights = &kernel.weights[(size_t)x * kernel.size];
+    int count = kernel.count[x];
+#if defined(USE_NEON)
+    int32x4_t acc = vdupq_n_s32(1 << (PRECISION_BITS - 1));
+    for (int j = 0; j < count; j++) {
+      uint32_t pixel;
+      memcpy(&pixel, pixels + j * 4, 4);
+      int16x4_t channels = vget_low_s16(vreinterpretq_s16_u16(
+          vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(pixel)))));
+      acc = vmlal_n_s16(acc, channels, weights[j]);
+    }
+    int16x4_t narrow = vqshrn_n_s32(acc, PRECISION_BITS);
+    uint8x8_t result = vqmovun_s16(vcombine_s16(narrow, narrow));
+    uint32_t pixel = vget_lane_u32(vreinterpret_u32_u8(result), 0);
+    memcpy(dst + x * 4, &pixel, 4);
+#elif defined(USE_SSE2)
+    // Multiplies two source pixels at a time, with their channels
+    // interleaved so that each 32-bit lane sums one channel.
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_set1_epi32(1 << (PRECISION_BITS - 1));
+    int j = 0;
+    for (; j + 1 < count; j += 2) {
+      __m128i two = _mm_unpacklo_epi8(
+          _mm_loadl_epi64((const __m128i*)(pixels + j * 4)), zero);
+      __m128i pairs = _mm_unpacklo_epi16(two, _mm_unpackhi_epi64(two, two));
+      __m128i weight = _mm_set1_epi32(
+          (uint16_t)weights[j] | ((uint32_t)(uint16_t)weights[j + 1] << 16));
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, weight));
+    }
+    if (j < count) {
+      int32_t pixel;
+      memcpy(&pixel, pixels + j * 4, 4);
+      __m128i one = _mm_unpacklo_epi16(
+          _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+      __m128i weight = _mm_set1_epi32((uint16_t)weights[j]);
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(one, weight));
+    }
+    acc = _mm_srai_epi32(acc, PRECISION_BITS);
+    acc = _mm_packs_epi32(acc, acc);
+    int32_t pixel = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+    memcpy(dst + x * 4, &pixel, 4);
+#else
+    int32_t acc[4] = {};
+    for (int j = 0; j < count; j++) {
+      for (int c = 0; c < 4; c++) {
+        acc[c] += pixels[j * 4 + c] * weights[j];
+      }
+    }
+    for (int c = 0; c < 4; c++) {
+      dst[x * 4 + c] = Clamp((acc[c] + (1 << (PRECISION_BITS - 1))) >>
+                             PRECISION_BITS);
+    }
+#endif
+  }
+}
+
+void ImageResampler::ScaleColumns(const uint8_t* rows, int first_row, int y,
+                                  uint8_t* dst, unsigned int width) {
+  const Kernel& kernel = vertical_;
+  size_t stride = (size_t)width * 4;
+  const uint8_t* src = rows + (kernel.start[y] - first_row) * stride;
+  const int16_t* weights = &kernel.weights[(size_t)y * kernel.size];
+  int count = kernel.count[y];
+
+  // The same weights apply across the whole row, so 16 channels are scaled
+  // at a time.
+  size_t i = 0;
+#if defined(USE_NEON)
+  for (; i + 16 <= stride; i += 16) {
+    int32x4_t acc[4];
+    for (int k = 0; k < 4; k++) {
+      acc[k] = vdupq_n_s32(1 << (PRECISION_BITS - 1));
+    }
+    for (int j = 0; j < count; j++) {
+      uint8x16_t channels = vld1q_u8(src + j * stride + i);
+      int16x8_t low = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(channels)));
+      int16x8_t high = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(channels)));
+      acc[0] = vmlal_n_s16(acc[0], vget_low_s16(low), weights[j]);
+      acc[1] = vmlal_n_s16(acc[1], vget_high_s16(low), weights[j]);
+      acc[2] = vmlal_n_s16(acc[2], vget_low_s16(high), weights[j]);
+      acc[3] = vmlal_n_s16(acc[3], vget_high_s16(high), weights[j]);
+    }
+    int16x8_t low = vcombine_s16(vqshrn_n_s32(acc[0], PRECISION_BITS),
+                                 vqshrn_n_s32(acc[1], PRECISION_BITS));
+    int16x8_t high = vcombine_s16(vqshrn_n_s32(acc[2], PRECISION_BITS),
+                                  vqshrn_n_s32(acc[3], PRECISION_BITS));
+    vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(low), vqmovun_s16(high)));
+  }
+#elif defined(USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= stride; i += 16) {
+    __m128i acc[4];
+    for (int k = 0; k < 4; k++) {
+      acc[k] = _mm_set1_epi32(1 << (PRECISION_BITS - 1));
+    }
+    // Interleaves the channels of two rows, so that each 32-bit lane sums
+    // one channel over both.
+    for (int j = 0; j < count; j += 2) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(src + j * stride + i));
+      __m128i b = zero;
+      uint32_t weight = (uint16_t)weights[j];
+      if (j + 1 < count) {
+        b = _mm_loadu_si128((const __m128i*)(src + (j + 1) * stride + i));
+        weight |= (uint32_t)(uint16_t)weights[j + 1] << 16;
+      }
+      __m128i weight_pair = _mm_set1_epi32(weight);
+      __m128i a_low = _mm_unpacklo_epi8(a, zero);
+      __m128i a_high = _mm_unpackhi_epi8(a, zero);
+      __m128i b_low = _mm_unpacklo_epi8(b, zero);
+      __m128i b_high = _mm_unpackhi_epi8(b, zero);
+      acc[0] = _mm_add_epi32(
+          acc[0],
+          _mm_madd_epi16(_mm_unpacklo_epi16(a_low, b_low), weight_pair));
+      acc[1] = _mm_add_epi32(
+          acc[1],
+          _mm_madd_epi16(_mm_unpackhi_epi16(a_low, b_low), weight_pair));
+      acc[2] = _mm_add_epi32(
+          acc[2],
+          _mm_madd_epi16(_mm_unpacklo_epi16(a_high, b_high), weight_pair));
+      acc[3] = _mm_add_epi32(
+          acc[3],
+          _mm_madd_epi16(_mm_unpackhi_epi16(a_high, b_high), weight_pair));
+    }
+    for (int k = 0; k < 4; k++) {
+      acc[k] = _mm_srai_epi32(acc[k], PRECISION_BITS);
+    }
+    __m128i low = _mm_packs_epi32(acc[0], acc[1]);
+    __m128i high = _mm_packs_epi32(acc[2], acc[3]);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(low, high));
+  }
+#endif
+  for (; i < stride; i++) {
+    int32_t acc = 1 << (PRECISION_BITS - 1);
+    for (int j = 0; j < count; j++) {
+      acc += src[j * stride + i] * weights[j];
+    }
+    dst[i] = Clamp(acc >> PRECISION_BITS);
+  }
+}
+
+// Maps (x, y) in an image of |width| by |height| to where EXIF |orientation|
+// puts it.
+static inline void Orient(int orientation, unsigned int x, unsigned int y,
+                          unsigned int width, unsigned int height,
+                          unsigned int& oriented_x, unsigned int& oriented_y) {
+  switch (orientation) {
+    case 2:  // Flipped horizontally.
+      oriented_x = width - 1 - x;
+      oriented_y = y;
+      break;
+    case 3:  // Rotated by 180 degrees.
+      oriented_x = width - 1 - x;
+      oriented_y = height - 1 - y;
+      break;
+    case 4:  // Flipped vertically.
+      oriented_x = x;
+      oriented_y = height - 1 - y;
+      break;
+    case 5:  // Transposed.
+      oriented_x = y;
+      oriented_y = x;
+      break;
+    case 6:  // Rotated by 90 degrees clockwise.
+      oriented_x = height - 1 - y;
+      oriented_y = x;
+      break;
+    case 7:  // Transversed.
+      oriented_x = height - 1 - y;
+      oriented_y = width - 1 - x;
+      break;
+    case 8:  // Rotated by 90 degrees counterclockwise.
+      oriented_x = y;
+      oriented_y = width - 1 - x;
+      break;
+    default:
+      oriented_x = x;
+      oriented_y = y;
+      break;
+  }
+}
+
+void ImageResampler::OrientBand(unsigned int y0, unsigned int y1,
+                                unsigned int width, unsigned int height,
+                                int orientation) {
+  bool transposed = orientation >= 5 && orientation <= 8;
+  unsigned int oriented_width = transposed ? height : width;
+  auto copy = [&](unsigned int x, unsigned int y) {
+    unsigned int oriented_x, oriented_y;
+    Orient(orientation, x, y, width, height, oriented_x, oriented_y);
+    memcpy(&output_[((size_t)oriented_y * oriented_width + oriented_x) * 4],
+           &scaled_band_[((size_t)(y - y0) * width + x) * 4], 4);
+  };
+  // Walk the band in the order that writes the output contiguously.
+  if (transposed) {
+    for (unsigned int x = 0; x < width; x++) {
+      for (unsigned int y = y0; y < y1; y++) {
+        copy(x, y);
+      }
+    }
+  } else {
+    for (unsigned int y = y0; y < y1; y++) {
+      for (unsigned int x = 0; x < width; x++) {
+        copy(x, y);
+      }
+    }
+  }
+}
+
+const std::vector<uint8_t>& ImageResampler::Resample(
+    const uint8_t* src, unsigned int src_width, unsigned int src_height,
+    unsigned int dst_width, unsigned int dst_height, ResampleFilter filter,
+    int orientation) {
+  ComputeKernel(src_width, dst_width, filter, horizontal_);
+  ComputeKernel(src_height, dst_height, filter, vertical_);
+
+  size_t src_stride = (size_t)src_width * 4;
+  size_t dst_stride = (size_t)dst_width * 4;
+  output_.resize(dst_stride * dst_height);
+  bool oriented = orientation > 1 && orientation <= 8;
+  if (oriented) {
+    scaled_band_.resize(dst_stride * BAND_ROWS);
+  }
+
+  // The source rows held in |band_|.
+  int band_first = 0;
+  int band_end = 0;
+  for (unsigned int y0 = 0; y0 < dst_height; y0 += BAND_ROWS) {
+    unsigned int y1 = std::min(y0 + BAND_ROWS, dst_height);
+    int first = vertical_.start[y0];
+    int end = first;
+    for (unsigned int y = y0; y < y1; y++) {
+      end = std::max(end, vertical_.start[y] + vertical_.count[y]);
+    }
+
+    // Bands overlap by the filter support, so keep the rows that the
+    // previous band has already scaled.
+    int kept = 0;
+    if (first >= band_first && first < band_end) {
+      kept = std::min(band_end, end) - first;
+    }
+    if (band_.size() < (end - first) * dst_stride) {
+      band_.resize((end - first) * dst_stride);
+    }
+    if (kept > 0 && first > band_first) {
+      memmove(band_.data(), band_.data() + (first - band_first) * dst_stride,
+              kept * dst_stride);
+    }
+    for (int row = first + kept; row < end; row++) {
+      ScaleRow(src + row * src_stride,
+               band_.data() + (row - first) * dst_stride, dst_width);
+    }
+    band_first = first;
+    band_end = end;
+
+    // An image that needs orienting is scaled into |scaled_band_| first,
+    // and copied to its place in the output while still in cache.
+    for (unsigned int y = y0; y < y1; y++) {
+      uint8_t* dst = oriented ? &scaled_band_[(y - y0) * dst_stride]
+                              : &output_[y * dst_stride];
+      ScaleColumns(band_.data(), first, y, dst, dst_width);
+    }
+    if (oriented) {
+      OrientBand(y0, y1, dst_width, dst_height, orientation);
+    }
+  }
+  return output_;
+}
@@ -0,0 +1,73 @@
+#ifndef FLUTTER_PLUGIN_IMAGE_RESAMPLER_H_
+#define FLUTTER_PLUGIN_IMAGE_RESAMPLER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ResampleFilter {
+  kBox,
+  kBilinear,
+  kLanczos,  // 3 lobes
+};
+
+// Returns false if |name| is not one of "box", "bilinear" and "lanczos".
+bool ParseResampleFilter(const std::string& name, ResampleFilter& filter);
+
+// Scales RGBA8888 images with a separable filter: rows are first scaled
+// horizontally into an intermediate buffer, which is then scaled vertically.
+// The output is produced in bands of rows, so that the intermediate buffer
+// only holds the source rows that the current band needs and stays in cache.
+// Rotating or flipping the result is folded into the same pass. Uses NEON
+// or SSE2 where available.
+//
+// The buffers are kept for the following images, so an instance must only
+// be used by one thread at a time.
+class ImageResampler {
+ public:
+  ImageResampler() {}
+
+  ImageResampler(const ImageResampler&) = delete;
+  ImageResampler& operator=(const ImageResampler&) = delete;
+
+  // Scales the tightly packed image in |src| and returns the result, which
+  // stays valid until the next call. The result is then oriented as given
+  // by the EXIF |orientation|, which swaps its width and height for the
+  // values 5 to 8.
+  const std::vector<uint8_t>& Resample(const uint8_t* src,
+                                       unsigned int src_width,
+                                       unsigned int src_height,
+                                       unsigned int dst_width,
+                                       unsigned int dst_height,
+                                       ResampleFilter filter,
+                                       int orientation);
+
+ private:
+  // The source range and weights of each output pixel along one axis.
+  struct Kernel {
+    std::vector<int> start;
+    std::vector<int> count;
+    std::vector<int16_t> weights;  // |size| per output pixel, Q14
+    int size = 0;
+  };
+
+  static void ComputeKernel(unsigned int src_size, unsigned int dst_size,
+                            ResampleFilter filter, Kernel& kernel);
+  void ScaleRow(const uint8_t* src, uint8_t* dst, unsigned int dst_width);
+  void ScaleColumns(const uint8_t* rows, int first_row, int y, uint8_t* dst,
+                    unsigned int width);
+  // Copies rows |y0| to |y1| of the scaled image from |scaled_band_| to
+  // their oriented place in the output.
+  void OrientBand(unsigned int y0, unsigned int y1, unsigned int width,
+                  unsigned int height, int orientation);
+
+  Kernel horizontal_;
+  Kernel vertical_;
+  // Horizontally scaled source rows for the current band.
+  std::vector<uint8_t> band_;
+  // Vertically scaled rows of the current band, before orienting.
+  std::vector<uint8_t> scaled_band_;
+  std::vector<uint8_t> output_;
+};
+
+#endif
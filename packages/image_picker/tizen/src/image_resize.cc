@@ -5,59 +5,40 @@
 
 #include "image_resize.h"
 
-#include <app_common.h>
-
 #include <algorithm>
 
+#include "jpeg_metadata.h"
 #include "log.h"
 
-void ImageResize::SetSize(unsigned int w, unsigned int h, int q) {
-  max_width_ = w;
-  max_height_ = h;
-  quality_ = q;
-}
+// The quality image_util uses unless told otherwise.
+#define DEFAULT_JPEG_QUALITY 75
 
-bool ImageResize::DecodeImage(image_util_decode_h decode_h,
-                              image_util_image_h& src_image,
-                              const std::string& src_file) {
-  int ret = image_util_decode_set_input_path(decode_h, src_file.c_str());
-  if (ret != IMAGE_UTIL_ERROR_NONE) {
-    LOG_ERROR("image_util_decode_set_input_path fail! [%s]",
-              get_error_message(ret));
-    return false;
+ImageResize::~ImageResize() {
+  if (decode_h_) {
+    image_util_decode_destroy(decode_h_);
   }
-
-  // TODO: we need to check this api later
-  // ret = image_util_decode_set_colorspace(decode_h, colorspace);
-
-  ret = image_util_decode_run2(decode_h, &src_image);
-  if (ret != IMAGE_UTIL_ERROR_NONE) {
-    LOG_ERROR("image_util_decode_run2 fail! [%s]", get_error_message(ret));
-    return false;
+  if (transform_h_) {
+    image_util_transform_destroy(transform_h_);
+  }
+  for (auto& entry : encoders_) {
+    image_util_encode_destroy(entry.second);
   }
-
-  return true;
 }
 
-bool ImageResize::TransformImage(transformation_h transform_h,
-                                 image_util_image_h src_image,
-                                 image_util_image_h& dst_image) {
-  unsigned int org_width;
-  unsigned int org_height;
-  int ret = image_util_get_image(src_image, &org_width, &org_height, nullptr,
-                                 nullptr, nullptr);
-  if (ret != IMAGE_UTIL_ERROR_NONE) {
-    LOG_ERROR("image_util_get_image fail! [%s]", get_error_message(ret));
-    return false;
-  }
+void ImageResize::SetSize(unsigned int w, unsigned int h, int q) {
+  max_width_ = w;
+  max_height_ = h;
+  quality_ = q;
+}
 
+void ImageResize::GetTargetSize(unsigned int org_width,
+                                unsigned int org_height, unsigned int& width,
+                                unsigned int& height) {
   bool has_max_width = max_width_ != 0;
   bool has_max_height = max_height_ != 0;
 
-  unsigned int width =
-      has_max_width ? std::min(org_width, max_width_) : org_width;
-  unsigned int height =
-      has_max_height ? std::min(org_height, max_height_) : org_height;
+  width = has_max_width ? std::min(org_width, max_width_) : org_width;
+  height = has_max_height ? std::min(org_height, max_height_) : org_height;
 
   bool should_downscale_width = has_max_width && max_width_ < org_width;
   bool should_downscale_height = has_max_height && max_height_ < org_height;
@@ -86,9 +67,118 @@ bool ImageResize::TransformImage(transformation_h transform_h,
       }
     }
   }
+}
+
+void ImageResize::GetScaledSize(unsigned int org_width,
+                                unsigned int org_height, int orientation,
+                                unsigned int& width, unsigned int& height) {
+  // The maximum size applies to the image as displayed.
+  if (orientation >= 5) {
+    GetTargetSize(org_height, org_width, height, width);
+  } else {
+    GetTargetSize(org_width, org_height, width, height);
+  }
+}
+
+void ImageResize::SetCopyExif(bool copy_exif) { copy_exif_ = copy_exif; }
+
+void ImageResize::SetFilter(std::optional<ResampleFilter> filter) {
+  filter_ = filter;
+}
+
+bool ImageResize::DecodeImage(image_util_decode_h decode_h,
+                              image_util_image_h& src_image,
+                              const std::string& src_file,
+                              const JpegMetadata* jpeg,
+                              unsigned int& org_width,
+                              unsigned int& org_height) {
+  int ret = image_util_decode_set_input_path(decode_h, src_file.c_str());
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("image_util_decode_set_input_path fail! [%s]",
+              get_error_message(ret));
+    return false;
+  }
+
+  // TODO: we need to check this api later
+  // ret = image_util_decode_set_colorspace(decode_h, colorspace);
+
+  // Let libjpeg scale a JPEG image down by up to 1/8 while decoding, as long
+  // as it stays at least as large as the target size. The full resolution
+  // image is then never held in memory, which for a photo from a recent
+  // camera can take hundreds of megabytes.
+  if (jpeg) {
+    org_width = jpeg->width;
+    org_height = jpeg->height;
+    unsigned int width, height;
+    GetScaledSize(org_width, org_height, jpeg->orientation, width, height);
+    image_util_scale_e scale = IMAGE_UTIL_DOWNSCALE_1_1;
+    for (unsigned int denominator = 8; denominator > 1; denominator /= 2) {
+      // libjpeg rounds scaled dimensions up.
+      if ((org_width + denominator - 1) / denominator >= width &&
+          (org_height + denominator - 1) / denominator >= height) {
+        scale = denominator == 8   ? IMAGE_UTIL_DOWNSCALE_1_8
+                : denominator == 4 ? IMAGE_UTIL_DOWNSCALE_1_4
+                                   : IMAGE_UTIL_DOWNSCALE_1_2;
+        break;
+      }
+    }
+    // Always set, since the handle may still hold the scale of the previous
+    // image.
+    ret = image_util_decode_set_jpeg_downscale(decode_h, scale);
+    if (ret != IMAGE_UTIL_ERROR_NONE) {
+      LOG_ERROR("image_util_decode_set_jpeg_downscale fail! [%s]",
+                get_error_message(ret));
+      return false;
+    }
+  }
+
+  ret = image_util_decode_run2(decode_h, &src_image);
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("image_util_decode_run2 fail! [%s]", get_error_message(ret));
+    return false;
+  }
+
+  unsigned int decoded_width;
+  unsigned int decoded_height;
+  ret = image_util_get_image(src_image, &decoded_width, &decoded_height,
+                             nullptr, nullptr, nullptr);
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("image_util_get_image fail! [%s]", get_error_message(ret));
+    return false;
+  }
+  if (!jpeg) {
+    org_width = decoded_width;
+    org_height = decoded_height;
+  }
+  // The decoded image is the largest buffer held during a resize.
+  LOG_DEBUG("decoded %ux%u image as %ux%u, %zu bytes", org_width, org_height,
+            decoded_width, decoded_height,
+            (size_t)decoded_width * decoded_height * 4);
+
+  return true;
+}
+
+bool ImageResize::TransformImage(transformation_h transform_h,
+                                 image_util_image_h src_image,
+                                 unsigned int org_width,
+                                 unsigned int org_height, int orientation,
+                                 image_util_image_h& dst_image) {
+  unsigned int width;
+  unsigned int height;
+  GetScaledSize(org_width, org_height, orientation, width, height);
+
+  // image_util would need a separate pass to rotate, and cannot transpose,
+  // so images that need orienting always go through the resampler.
+  if ((filter_ || orientation != 1) &&
+      ResampleImage(src_image, width, height, orientation, dst_image)) {
+    return true;
+  }
+  if (orientation != 1) {
+    LOG_WARN("orientation [%d] is not applied", orientation);
+  }
 
   LOG_DEBUG("transform width:[%d], height:[%d]", width, height);
-  ret = image_util_transform_set_resolution(transform_h, width, height);
+  int ret = image_util_transform_set_resolution(transform_h, width, height);
   if (ret != IMAGE_UTIL_ERROR_NONE) {
     LOG_ERROR("image_util_transform_set_resolution fail! [%s]",
               get_error_message(ret));
@@ -103,19 +193,67 @@ bool ImageResize::TransformImage(transformation_h transform_h,
   return true;
 }
 
+bool ImageResize::ResampleImage(image_util_image_h src_image,
+                                unsigned int width, unsigned int height,
+                                int orientation,
+                                image_util_image_h& dst_image) {
+  unsigned int src_width;
+  unsigned int src_height;
+  image_util_colorspace_e colorspace;
+  unsigned char* data = nullptr;
+  size_t size = 0;
+  int ret = image_util_get_image(src_image, &src_width, &src_height,
+                                 &colorspace, &data, &size);
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("image_util_get_image fail! [%s]", get_error_message(ret));
+    return false;
+  }
+  if (colorspace != IMAGE_UTIL_COLORSPACE_RGBA8888 ||
+      size < (size_t)src_width * src_height * 4) {
+    LOG_DEBUG("colorspace [%d] is left to image_util", (int)colorspace);
+    free(data);
+    return false;
+  }
+
+  LOG_DEBUG("resample width:[%d], height:[%d], orientation:[%d]", width,
+            height, orientation);
+  const std::vector<uint8_t>& pixels = resampler_.Resample(
+      data, src_width, src_height, width, height,
+      filter_.value_or(ResampleFilter::kBilinear), orientation);
+  free(data);
+
+  if (orientation >= 5) {
+    std::swap(width, height);
+  }
+  ret = image_util_create_image(width, height, IMAGE_UTIL_COLORSPACE_RGBA8888,
+                                pixels.data(), pixels.size(), &dst_image);
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("image_util_create_image fail! [%s]", get_error_message(ret));
+    dst_image = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
 bool ImageResize::EncodeImage(image_util_encode_h encode_h,
                               image_util_image_h dst_image,
                               image_util_type_e encoder_type,
-                              const std::string& dst_file) {
+                              const std::string& dst_file,
+                              const std::vector<uint8_t>& exif_segment) {
   if (encoder_type == IMAGE_UTIL_JPEG) {
+    // The encoder is reused, so the quality of a previous image must not
+    // carry over.
+    int quality = DEFAULT_JPEG_QUALITY;
     if (quality_ > 0 && quality_ <= 100) {
       LOG_DEBUG("quality_ [%d]", quality_);
-      int ret = image_util_encode_set_quality(encode_h, quality_);
-      if (ret != IMAGE_UTIL_ERROR_NONE) {
-        LOG_ERROR("image_util_encode_set_quality fail! [%s]",
-                  get_error_message(ret));
-        return false;
-      }
+      quality = quality_;
+    }
+    int ret = image_util_encode_set_quality(encode_h, quality);
+    if (ret != IMAGE_UTIL_ERROR_NONE) {
+      LOG_ERROR("image_util_encode_set_quality fail! [%s]",
+                get_error_message(ret));
+      return false;
     }
   } else {
     LOG_DEBUG(
@@ -124,6 +262,23 @@ bool ImageResize::EncodeImage(image_util_encode_h encode_h,
   }
 
   LOG_DEBUG("dst_path : %s", dst_file.c_str());
+  if (encoder_type == IMAGE_UTIL_JPEG && !exif_segment.empty()) {
+    // Encode to memory, so that the EXIF segment can be added while writing
+    // the file rather than by rewriting it.
+    unsigned char* buffer = nullptr;
+    size_t size = 0;
+    int ret =
+        image_util_encode_run_to_buffer(encode_h, dst_image, &buffer, &size);
+    if (ret != IMAGE_UTIL_ERROR_NONE) {
+      LOG_ERROR("image_util_encode_run_to_buffer fail! [%s]",
+                get_error_message(ret));
+      return false;
+    }
+    bool written = WriteJpegWithExif(dst_file, buffer, size, exif_segment);
+    free(buffer);
+    return written;
+  }
+
   int ret =
       image_util_encode_run_to_file(encode_h, dst_image, dst_file.c_str());
   if (ret != IMAGE_UTIL_ERROR_NONE) {
@@ -135,7 +290,23 @@ bool ImageResize::EncodeImage(image_util_encode_h encode_h,
   return true;
 }
 
-bool ImageResize::Resize(const std::string& src_file, std::string& dst_file) {
+image_util_encode_h ImageResize::GetEncoder(image_util_type_e encoder_type) {
+  auto iter = encoders_.find(encoder_type);
+  if (iter != encoders_.end()) {
+    return iter->second;
+  }
+  image_util_encode_h encode_h = nullptr;
+  int ret = image_util_encode_create(encoder_type, &encode_h);
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("image_util_encode_create fail! [%s]", get_error_message(ret));
+    return nullptr;
+  }
+  encoders_[encoder_type] = encode_h;
+  return encode_h;
+}
+
+bool ImageResize::Resize(const std::string& src_file,
+                         const std::string& dst_file) {
   LOG_DEBUG("source image path: %s", src_file.c_str());
 
   if (max_width_ == 0 && max_height_ == 0 &&
@@ -146,16 +317,21 @@ bool ImageResize::Resize(const std::string& src_file, std::string& dst_file) {
   // ===========================================================
   image_util_image_h src_image = nullptr;
   image_util_image_h dst_image = nullptr;
-  image_util_decode_h decode_h = nullptr;
-
-  int ret = image_util_decode_create(&decode_h);
-  if (ret != IMAGE_UTIL_ERROR_NONE) {
-    LOG_ERROR("image_util_decode_create fail! [%s]", get_error_message(ret));
-    return false;
+  unsigned int org_width = 0;
+  unsigned int org_height = 0;
+  JpegMetadata jpeg;
+  bool is_jpeg = ReadJpegMetadata(src_file, jpeg);
+
+  if (!decode_h_) {
+    int ret = image_util_decode_create(&decode_h_);
+    if (ret != IMAGE_UTIL_ERROR_NONE) {
+      LOG_ERROR("image_util_decode_create fail! [%s]", get_error_message(ret));
+      decode_h_ = nullptr;
+      return false;
+    }
   }
-  bool is_decoded = DecodeImage(decode_h, src_image, src_file);
-  image_util_decode_destroy(decode_h);
-  if (!is_decoded) {
+  if (!DecodeImage(decode_h_, src_image, src_file, is_jpeg ? &jpeg : nullptr,
+                   org_width, org_height)) {
     if (src_image) {
       image_util_destroy_image(src_image);
     }
@@ -163,19 +339,20 @@ bool ImageResize::Resize(const std::string& src_file, std::string& dst_file) {
   }
 
   // ===========================================================
-  transformation_h transform_h = nullptr;
-  ret = image_util_transform_create(&transform_h);
-  if (ret != IMAGE_UTIL_ERROR_NONE) {
-    LOG_ERROR("image_util_transform_create fail! [%s]", get_error_message(ret));
-    if (src_image) {
-      image_util_destroy_image(src_image);
+  if (!transform_h_) {
+    int ret = image_util_transform_create(&transform_h_);
+    if (ret != IMAGE_UTIL_ERROR_NONE) {
+      LOG_ERROR("image_util_transform_create fail! [%s]",
+                get_error_message(ret));
+      transform_h_ = nullptr;
+      if (src_image) {
+        image_util_destroy_image(src_image);
+      }
+      return false;
     }
-    return false;
   }
-
-  bool is_transformed = TransformImage(transform_h, src_image, dst_image);
-  image_util_transform_destroy(transform_h);
-  if (!is_transformed) {
+  if (!TransformImage(transform_h_, src_image, org_width, org_height,
+                      jpeg.orientation, dst_image)) {
     if (src_image) {
       image_util_destroy_image(src_image);
     }
@@ -188,20 +365,7 @@ bool ImageResize::Resize(const std::string& src_file, std::string& dst_file) {
   image_util_destroy_image(src_image);
 
   // ===========================================================
-  char* temp = app_get_cache_path();
-  dst_file = std::string(temp);
-  free(temp);
-
-  size_t found = src_file.rfind("/");
-  if (found != std::string::npos) {
-    dst_file += "scaled_" + src_file.substr(found + 1);
-    LOG_DEBUG("dest image path: %s", dst_file.c_str());
-  } else {
-    if (dst_image) {
-      image_util_destroy_image(dst_image);
-    }
-    return false;
-  }
+  LOG_DEBUG("dest image path: %s", dst_file.c_str());
 
   image_util_type_e encoder_type = IMAGE_UTIL_JPEG;
   size_t pos = dst_file.rfind(".");
@@ -218,18 +382,14 @@ bool ImageResize::Resize(const std::string& src_file, std::string& dst_file) {
     }
   }
 
-  image_util_encode_h encode_h = nullptr;
-  ret = image_util_encode_create(encoder_type, &encode_h);
-  if (ret != IMAGE_UTIL_ERROR_NONE) {
-    LOG_ERROR("image_util_encode_create fail! [%s]", get_error_message(ret));
-    if (dst_image) {
-      image_util_destroy_image(dst_image);
-    }
-    return false;
+  std::vector<uint8_t> exif_segment;
+  if (copy_exif_ && is_jpeg) {
+    exif_segment = BuildExifSegment(jpeg.exif);
   }
-  bool is_encoded = EncodeImage(encode_h, dst_image, encoder_type, dst_file);
-  image_util_encode_destroy(encode_h);
-  if (!is_encoded) {
+
+  image_util_encode_h encode_h = GetEncoder(encoder_type);
+  if (!encode_h || !EncodeImage(encode_h, dst_image, encoder_type, dst_file,
+                                exif_segment)) {
     if (dst_image) {
       image_util_destroy_image(dst_image);
     }
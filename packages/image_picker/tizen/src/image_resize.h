@@ -3,25 +3,75 @@
 
 #include <image_util.h>
 
+#include <map>
+#include <optional>
 #include <string>
+#include <vector>
 
+#include "image_resampler.h"
+#include "jpeg_metadata.h"
+
+// Decodes, scales and re-encodes images. The image_util handles are created
+// on first use and kept for the following images, so an instance must only
+// be used by one thread at a time.
 class ImageResize {
  public:
   ImageResize() {}
-  bool Resize(const std::string& src_file, std::string& dst_file);
+  ~ImageResize();
+
+  ImageResize(const ImageResize&) = delete;
+  ImageResize& operator=(const ImageResize&) = delete;
+
+  // Writes a resized copy of |src_file| to |dst_file|, in the format given
+  // by the extension of |dst_file|. Returns false if there is nothing to do
+  // or the resize fails.
+  bool Resize(const std::string& src_file, const std::string& dst_file);
   void SetSize(unsigned int w, unsigned int h, int q);
+  // Scales images with ImageResampler and |filter| rather than with
+  // image_util, unless |filter| is empty.
+  void SetFilter(std::optional<ResampleFilter> filter);
+  // Copies the EXIF fields that still apply from a JPEG image to its resized
+  // copy. See BuildExifSegment().
+  void SetCopyExif(bool copy_exif);
 
  private:
+  // Scales the size of an image with the given original size to fit within
+  // the maximum size, keeping the aspect ratio.
+  void GetTargetSize(unsigned int org_width, unsigned int org_height,
+                     unsigned int& width, unsigned int& height);
+  // Like GetTargetSize(), but returns the size to scale the image to before
+  // applying the EXIF |orientation|.
+  void GetScaledSize(unsigned int org_width, unsigned int org_height,
+                     int orientation, unsigned int& width,
+                     unsigned int& height);
+  // |org_width| and |org_height| receive the size of the original image,
+  // which |src_image| may be smaller than. |jpeg| is null unless |src_file|
+  // is a JPEG file.
   bool DecodeImage(image_util_decode_h decode_h, image_util_image_h& src_image,
-                   const std::string& src_file);
+                   const std::string& src_file, const JpegMetadata* jpeg,
+                   unsigned int& org_width, unsigned int& org_height);
   bool TransformImage(transformation_h transform_h,
-                      image_util_image_h src_image,
+                      image_util_image_h src_image, unsigned int org_width,
+                      unsigned int org_height, int orientation,
                       image_util_image_h& dst_image);
+  bool ResampleImage(image_util_image_h src_image, unsigned int width,
+                     unsigned int height, int orientation,
+                     image_util_image_h& dst_image);
   bool EncodeImage(image_util_encode_h encode_h, image_util_image_h dst_image,
-                   image_util_type_e encoder_type, const std::string& dst_file);
-  unsigned int max_width_;
-  unsigned int max_height_;
-  int quality_;
+                   image_util_type_e encoder_type, const std::string& dst_file,
+                   const std::vector<uint8_t>& exif_segment);
+  image_util_encode_h GetEncoder(image_util_type_e encoder_type);
+
+  unsigned int max_width_ = 0;
+  unsigned int max_height_ = 0;
+  int quality_ = 0;
+  std::optional<ResampleFilter> filter_;
+  bool copy_exif_ = false;
+
+  image_util_decode_h decode_h_ = nullptr;
+  transformation_h transform_h_ = nullptr;
+  std::map<image_util_type_e, image_util_encode_h> encoders_;
+  ImageResampler resampler_;
 };
 
 #endif
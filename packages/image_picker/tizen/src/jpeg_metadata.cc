@@ -0,0 +1,438 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "jpeg_metadata.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "log.h"
+
+#define TAG_ORIENTATION 0x0112
+#define TAG_EXIF_IFD 0x8769
+#define TAG_GPS_IFD 0x8825
+#define MAX_SEGMENT_SIZE 65533  // bytes, without the length field
+
+static const uint8_t kExifHeader[] = {'E', 'x', 'i', 'f', 0, 0};
+
+// Fields of IFD0 that are kept on a resized copy.
+static const uint16_t kKeptImageTags[] = {
+    0x010E,  // ImageDescription
+    0x010F,  // Make
+    0x0110,  // Model
+    0x0131,  // Software
+    0x0132,  // DateTime
+    0x013B,  // Artist
+    0x8298,  // Copyright
+};
+
+// Fields of the Exif IFD that are kept on a resized copy.
+static const uint16_t kKeptExifTags[] = {
+    0x829A,  // ExposureTime
+    0x829D,  // FNumber
+    0x8822,  // ExposureProgram
+    0x8827,  // ISOSpeedRatings
+    0x9000,  // ExifVersion
+    0x9003,  // DateTimeOriginal
+    0x9004,  // DateTimeDigitized
+    0x9010,  // OffsetTime
+    0x9011,  // OffsetTimeOriginal
+    0x9012,  // OffsetTimeDigitized
+    0x9201,  // ShutterSpeedValue
+    0x9202,  // ApertureValue
+    0x9204,  // ExposureBiasValue
+    0x9207,  // MeteringMode
+    0x9209,  // Flash
+    0x920A,  // FocalLength
+    0x9290,  // SubSecTime
+    0x9291,  // SubSecTimeOriginal
+    0x9292,  // SubSecTimeDigitized
+    0xA402,  // ExposureMode
+    0xA403,  // WhiteBalance
+    0xA405,  // FocalLengthIn35mmFilm
+    0xA406,  // SceneCaptureType
+    0xA433,  // LensMake
+    0xA434,  // LensModel
+};
+
+namespace {
+
+// A read-only view of a TIFF structure in either byte order.
+class TiffReader {
+ public:
+  explicit TiffReader(const std::vector<uint8_t>& data) : data_(data) {
+    big_endian_ = data.size() >= 2 && data[0] == 'M' && data[1] == 'M';
+  }
+
+  bool IsValid() const {
+    uint16_t magic;
+    return data_.size() >= 8 &&
+           ((data_[0] == 'I' && data_[1] == 'I') || big_endian_) &&
+           ReadU16(2, magic) && magic == 42;
+  }
+  bool IsBigEndian() const { return big_endian_; }
+
+  size_t GetSize() const { return data_.size(); }
+
+  // The offsets are read from the data, so the checks must not overflow.
+  bool ReadU16(size_t offset, uint16_t& value) const {
+    if (offset > data_.size() || data_.size() - offset < 2) {
+      return false;
+    }
+    const uint8_t* p = &data_[offset];
+    value = big_endian_ ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+    return true;
+  }
+
+  bool ReadU32(size_t offset, uint32_t& value) const {
+    if (offset > data_.size() || data_.size() - offset < 4) {
+      return false;
+    }
+    const uint8_t* p = &data_[offset];
+    value = big_endian_ ? ((uint32_t)p[0] << 24) | (p[1] << 16) |
+                              (p[2] << 8) | p[3]
+                        : ((uint32_t)p[3] << 24) | (p[2] << 16) |
+                              (p[1] << 8) | p[0];
+    return true;
+  }
+
+  const uint8_t* GetBytes(size_t offset, size_t size) const {
+    if (offset > data_.size() || size > data_.size() - offset) {
+      return nullptr;
+    }
+    return &data_[offset];
+  }
+
+ private:
+  const std::vector<uint8_t>& data_;
+  bool big_endian_;
+};
+
+struct IfdEntry {
+  uint16_t tag;
+  uint16_t type;
+  uint32_t count;
+  // Where the value is in the TIFF structure read from.
+  uint32_t value_offset;
+  // The raw value, in the byte order of the TIFF structure.
+  std::vector<uint8_t> value;
+};
+
+}  // namespace
+
+static size_t GetTypeSize(uint16_t type) {
+  switch (type) {
+    case 1:  // BYTE
+    case 2:  // ASCII
+    case 6:  // SBYTE
+    case 7:  // UNDEFINED
+      return 1;
+    case 3:  // SHORT
+    case 8:  // SSHORT
+      return 2;
+    case 4:   // LONG
+    case 9:   // SLONG
+    case 11:  // FLOAT
+      return 4;
+    case 5:   // RATIONAL
+    case 10:  // SRATIONAL
+    case 12:  // DOUBLE
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+// Reads the entries of the IFD at |offset|. If |tags| is not null, only the
+// entries with one of its |tag_count| tags are returned.
+static std::vector<IfdEntry> ReadIfd(const TiffReader& tiff, uint32_t offset,
+                                     const uint16_t* tags, size_t tag_count) {
+  std::vector<IfdEntry> entries;
+  uint16_t count;
+  if (!tiff.ReadU16(offset, count)) {
+    return entries;
+  }
+  // Entries past the end of the data are dropped, which also keeps the
+  // entry offsets below from overflowing.
+  size_t available = (tiff.GetSize() - offset - 2) / 12;
+  if (count > available) {
+    count = available;
+  }
+  for (uint16_t i = 0; i < count; i++) {
+    size_t entry = offset + 2 + i * 12;
+    IfdEntry result;
+    if (!tiff.ReadU16(entry, result.tag) ||
+        !tiff.ReadU16(entry + 2, result.type) ||
+        !tiff.ReadU32(entry + 4, result.count)) {
+      break;
+    }
+    if (tags && std::find(tags, tags + tag_count, result.tag) ==
+                    tags + tag_count) {
+      continue;
+    }
+    size_t type_size = GetTypeSize(result.type);
+    if (type_size == 0 || result.count > MAX_SEGMENT_SIZE / type_size) {
+      continue;
+    }
+    size_t size = type_size * result.count;
+    uint32_t value_offset = entry + 8;
+    if (size > 4 && !tiff.ReadU32(entry + 8, value_offset)) {
+      continue;
+    }
+    result.value_offset = value_offset;
+    const uint8_t* value = tiff.GetBytes(value_offset, size);
+    if (!value) {
+      continue;
+    }
+    result.value.assign(value, value + size);
+    entries.push_back(std::move(result));
+  }
+  return entries;
+}
+
+// Finds the offset of the sub-IFD that |pointer_tag| in IFD0 points to.
+static bool FindSubIfd(const TiffReader& tiff, uint32_t ifd0,
+                       uint16_t pointer_tag, uint32_t& offset) {
+  for (const IfdEntry& entry : ReadIfd(tiff, ifd0, &pointer_tag, 1)) {
+    if (entry.value.size() == 4) {
+      return tiff.ReadU32(entry.value_offset, offset);
+    }
+  }
+  return false;
+}
+
+static size_t GetIfdSize(const std::vector<IfdEntry>& entries) {
+  size_t size = 2 + entries.size() * 12 + 4;
+  for (const IfdEntry& entry : entries) {
+    if (entry.value.size() > 4) {
+      size += (entry.value.size() + 1) & ~1;  // Values start at even offsets.
+    }
+  }
+  return size;
+}
+
+static void PutU16(std::vector<uint8_t>& out, uint16_t value,
+                   bool big_endian) {
+  if (big_endian) {
+    out.push_back(value >> 8);
+    out.push_back(value & 0xFF);
+  } else {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+  }
+}
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t value,
+                   bool big_endian) {
+  if (big_endian) {
+    PutU16(out, value >> 16, true);
+    PutU16(out, value & 0xFFFF, true);
+  } else {
+    PutU16(out, value & 0xFFFF, false);
+    PutU16(out, value >> 16, false);
+  }
+}
+
+// Appends an IFD with |entries| to |out|, followed by the values that do not
+// fit in the entries. |base| is where the TIFF structure starts in |out|.
+static void WriteIfd(std::vector<uint8_t>& out, size_t base,
+                     std::vector<IfdEntry> entries, bool big_endian) {
+  std::sort(entries.begin(), entries.end(),
+            [](const IfdEntry& a, const IfdEntry& b) { return a.tag < b.tag; });
+  size_t data_offset = out.size() - base + 2 + entries.size() * 12 + 4;
+  std::vector<uint8_t> data;
+  PutU16(out, entries.size(), big_endian);
+  for (const IfdEntry& entry : entries) {
+    PutU16(out, entry.tag, big_endian);
+    PutU16(out, entry.type, big_endian);
+    PutU32(out, entry.count, big_endian);
+    if (entry.value.size() > 4) {
+      PutU32(out, data_offset + data.size(), big_endian);
+      data.insert(data.end(), entry.value.begin(), entry.value.end());
+      if (data.size() % 2) {
+        data.push_back(0);
+      }
+    } else {
+      out.insert(out.end(), entry.value.begin(), entry.value.end());
+      out.insert(out.end(), 4 - entry.value.size(), 0);
+    }
+  }
+  PutU32(out, 0, big_endian);  // No next IFD.
+  out.insert(out.end(), data.begin(), data.end());
+}
+
+static IfdEntry MakePointerEntry(uint16_t tag, uint32_t offset,
+                                 bool big_endian) {
+  IfdEntry entry = {tag, 4, 1, 0, {}};
+  PutU32(entry.value, offset, big_endian);
+  return entry;
+}
+
+bool ReadJpegMetadata(const std::string& file, JpegMetadata& metadata) {
+  FILE* fp = fopen(file.c_str(), "rb");
+  if (!fp) {
+    return false;
+  }
+  bool found = false;
+  if (fgetc(fp) == 0xFF && fgetc(fp) == 0xD8) {
+    while (true) {
+      int c = fgetc(fp);
+      if (c != 0xFF) {
+        break;
+      }
+      int marker;
+      do {
+        marker = fgetc(fp);
+      } while (marker == 0xFF);
+      if (marker == EOF || marker == 0xD9 || marker == 0xDA) {
+        break;  // End of image or start of scan.
+      }
+      if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+        continue;  // No payload.
+      }
+      uint8_t header[7];
+      if (fread(header, 1, 2, fp) != 2) {
+        break;
+      }
+      long length = ((header[0] << 8) | header[1]) - 2;
+      if (length < 0) {
+        break;
+      }
+      // SOF0 to SOF15, except for DHT, JPG and DAC.
+      if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+          marker != 0xC8 && marker != 0xCC) {
+        if (fread(header + 2, 1, 5, fp) == 5) {
+          metadata.height = (header[3] << 8) | header[4];
+          metadata.width = (header[5] << 8) | header[6];
+          found = metadata.width > 0 && metadata.height > 0;
+        }
+        break;
+      }
+      if (marker == 0xE1 && metadata.exif.empty() &&
+          length > (long)sizeof(kExifHeader)) {
+        std::vector<uint8_t> segment(length);
+        if (fread(segment.data(), 1, length, fp) != (size_t)length) {
+          break;
+        }
+        if (memcmp(segment.data(), kExifHeader, sizeof(kExifHeader)) == 0) {
+          metadata.exif.assign(segment.begin() + sizeof(kExifHeader),
+                               segment.end());
+        }
+        continue;
+      }
+      if (fseek(fp, length, SEEK_CUR) != 0) {
+        break;
+      }
+    }
+  }
+  fclose(fp);
+
+  TiffReader tiff(metadata.exif);
+  uint32_t ifd0;
+  if (found && tiff.IsValid() && tiff.ReadU32(4, ifd0)) {
+    uint16_t tag = TAG_ORIENTATION;
+    for (const IfdEntry& entry : ReadIfd(tiff, ifd0, &tag, 1)) {
+      uint16_t orientation;
+      if (entry.type == 3 && tiff.ReadU16(entry.value_offset, orientation) &&
+          orientation >= 1 && orientation <= 8) {
+        metadata.orientation = orientation;
+      }
+    }
+  }
+  return found;
+}
+
+std::vector<uint8_t> BuildExifSegment(const std::vector<uint8_t>& exif) {
+  std::vector<uint8_t> segment;
+  TiffReader tiff(exif);
+  uint32_t ifd0;
+  if (!tiff.IsValid() || !tiff.ReadU32(4, ifd0)) {
+    return segment;
+  }
+  bool big_endian = tiff.IsBigEndian();
+
+  std::vector<IfdEntry> image_entries =
+      ReadIfd(tiff, ifd0, kKeptImageTags,
+              sizeof(kKeptImageTags) / sizeof(kKeptImageTags[0]));
+  std::vector<IfdEntry> exif_entries;
+  std::vector<IfdEntry> gps_entries;
+  uint32_t offset;
+  if (FindSubIfd(tiff, ifd0, TAG_EXIF_IFD, offset)) {
+    exif_entries = ReadIfd(tiff, offset, kKeptExifTags,
+                           sizeof(kKeptExifTags) / sizeof(kKeptExifTags[0]));
+  }
+  if (FindSubIfd(tiff, ifd0, TAG_GPS_IFD, offset)) {
+    gps_entries = ReadIfd(tiff, offset, nullptr, 0);
+  }
+  if (image_entries.empty() && exif_entries.empty() && gps_entries.empty()) {
+    return segment;
+  }
+
+  // The sub-IFDs follow IFD0, which gets an entry pointing at each.
+  size_t image_ifd_size = GetIfdSize(image_entries) +
+                          (!exif_entries.empty() + !gps_entries.empty()) * 12;
+  uint32_t exif_offset = 8 + image_ifd_size;
+  uint32_t gps_offset = exif_offset;
+  if (!exif_entries.empty()) {
+    image_entries.push_back(
+        MakePointerEntry(TAG_EXIF_IFD, exif_offset, big_endian));
+    gps_offset += GetIfdSize(exif_entries);
+  }
+  if (!gps_entries.empty()) {
+    image_entries.push_back(
+        MakePointerEntry(TAG_GPS_IFD, gps_offset, big_endian));
+  }
+
+  segment.assign(kExifHeader, kExifHeader + sizeof(kExifHeader));
+  size_t base = segment.size();
+  segment.push_back(big_endian ? 'M' : 'I');
+  segment.push_back(big_endian ? 'M' : 'I');
+  PutU16(segment, 42, big_endian);
+  PutU32(segment, 8, big_endian);
+  WriteIfd(segment, base, image_entries, big_endian);
+  if (!exif_entries.empty()) {
+    WriteIfd(segment, base, exif_entries, big_endian);
+  }
+  if (!gps_entries.empty()) {
+    WriteIfd(segment, base, gps_entries, big_endian);
+  }
+  if (segment.size() > MAX_SEGMENT_SIZE) {
+    LOG_WARN("EXIF data is too large to copy");
+    segment.clear();
+  }
+  return segment;
+}
+
+bool WriteJpegWithExif(const std::string& file, const uint8_t* jpeg,
+                       size_t size, const std::vector<uint8_t>& exif_segment) {
+  if (size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) {
+    return false;
+  }
+  // Keep a JFIF segment, which must come first, in front.
+  size_t insert_at = 2;
+  if (jpeg[2] == 0xFF && jpeg[3] == 0xE0 && size >= 6) {
+    insert_at = std::min(size, 4 + (size_t)((jpeg[4] << 8) | jpeg[5]));
+  }
+
+  FILE* fp = fopen(file.c_str(), "wb");
+  if (!fp) {
+    LOG_ERROR("failed to open %s", file.c_str());
+    return false;
+  }
+  size_t length = exif_segment.size() + 2;
+  uint8_t marker[] = {0xFF, 0xE1, (uint8_t)(length >> 8),
+                      (uint8_t)(length & 0xFF)};
+  bool written =
+      fwrite(jpeg, 1, insert_at, fp) == insert_at &&
+      fwrite(marker, 1, sizeof(marker), fp) == sizeof(marker) &&
+      fwrite(exif_segment.data(), 1, exif_segment.size(), fp) ==
+          exif_segment.size() &&
+      fwrite(jpeg + insert_at, 1, size - insert_at, fp) == size - insert_at;
+  if (fclose(fp) != 0 || !written) {
+    LOG_ERROR("failed to write %s", file.c_str());
+    return false;
+  }
+  return true;
+}
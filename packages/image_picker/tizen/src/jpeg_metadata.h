@@ -0,0 +1,32 @@
+#ifndef FLUTTER_PLUGIN_JPEG_METADATA_H_
+#define FLUTTER_PLUGIN_JPEG_METADATA_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct JpegMetadata {
+  unsigned int width = 0;
+  unsigned int height = 0;
+  // EXIF orientation, from 1 (as stored) to 8.
+  int orientation = 1;
+  // The TIFF structure of the EXIF segment, if any.
+  std::vector<uint8_t> exif;
+};
+
+// Reads the size and the EXIF data from the headers of a JPEG file without
+// decoding it. Returns false if |file| is not a JPEG file.
+bool ReadJpegMetadata(const std::string& file, JpegMetadata& metadata);
+
+// Returns the payload of an APP1 segment with the fields of |exif| that
+// still describe a resized and oriented copy of the image: camera, capture
+// time and settings, and location. Orientation, dimensions, thumbnails and
+// maker notes are left out. Returns an empty vector if nothing is kept.
+std::vector<uint8_t> BuildExifSegment(const std::vector<uint8_t>& exif);
+
+// Writes the JPEG data in |jpeg| to |file| with |exif_segment| inserted as
+// an APP1 segment.
+bool WriteJpegWithExif(const std::string& file, const uint8_t* jpeg,
+                       size_t size, const std::vector<uint8_t>& exif_segment);
+
+#endif
@@ -0,0 +1,193 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "resize_cache.h"
+
+#include <app_common.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "log.h"
+
+#define DEFAULT_CACHE_CAPACITY (32 * 1024 * 1024)  // bytes
+#define INDEX_FILE "index"
+#define INDEX_TEMP_FILE "index.tmp"
+
+static std::string GetExtension(const std::string& file) {
+  size_t slash = file.rfind('/');
+  size_t dot = file.rfind('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return "";
+  }
+  std::string extension = file.substr(dot);
+  bool valid = extension.size() > 1 && extension.size() <= 6 &&
+               std::all_of(extension.begin() + 1, extension.end(),
+                           [](char c) { return isalnum((unsigned char)c); });
+  return valid ? extension : "";
+}
+
+ResizeCache::ResizeCache() : capacity_(DEFAULT_CACHE_CAPACITY) {
+  char* path = app_get_cache_path();
+  if (path) {
+    directory_ = std::string(path) + "image_picker/";
+    free(path);
+    if (mkdir(directory_.c_str(), 0700) != 0 && errno != EEXIST) {
+      LOG_ERROR("failed to create %s : %s", directory_.c_str(),
+                strerror(errno));
+      directory_.clear();
+    }
+  } else {
+    LOG_ERROR("app_get_cache_path failed");
+  }
+}
+
+std::string ResizeCache::GetName(const std::string& file,
+                                 const std::string& options) {
+  struct stat st;
+  if (directory_.empty() || stat(file.c_str(), &st) != 0 ||
+      !S_ISREG(st.st_mode)) {
+    return "";
+  }
+  LoadIndex();
+
+  std::string key = file + '\n' + std::to_string(st.st_mtim.tv_sec) + '.' +
+                    std::to_string(st.st_mtim.tv_nsec) + '\n' +
+                    std::to_string(st.st_size) + '\n' + options;
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : key) {
+    hash = (hash ^ (uint8_t)c) * 1099511628211ULL;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016" PRIx64, hash);
+  // The extension selects the encoder.
+  return name + GetExtension(file);
+}
+
+std::string ResizeCache::GetPath(const std::string& name) const {
+  return directory_ + name;
+}
+
+bool ResizeCache::Lookup(const std::string& name) {
+  LoadIndex();
+  auto iter = index_.find(name);
+  if (iter == index_.end()) {
+    return false;
+  }
+  struct stat st;
+  if (stat(GetPath(name).c_str(), &st) != 0) {
+    // Removed behind our back.
+    size_ -= iter->second->second;
+    entries_.erase(iter->second);
+    index_.erase(iter);
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, iter->second);
+  return true;
+}
+
+void ResizeCache::Add(const std::string& name) {
+  LoadIndex();
+  struct stat st;
+  if (stat(GetPath(name).c_str(), &st) != 0) {
+    LOG_ERROR("failed to stat %s : %s", name.c_str(), strerror(errno));
+    return;
+  }
+  auto iter = index_.find(name);
+  if (iter != index_.end()) {
+    size_ -= iter->second->second;
+    entries_.erase(iter->second);
+  }
+  entries_.emplace_front(name, st.st_size);
+  index_[name] = entries_.begin();
+  size_ += st.st_size;
+}
+
+void ResizeCache::SetCapacity(int64_t capacity) {
+  capacity_ = capacity > 0 ? capacity : 0;
+  Commit(0);
+}
+
+void ResizeCache::Commit(size_t keep) {
+  if (directory_.empty()) {
+    return;
+  }
+  LoadIndex();
+  while (size_ > capacity_ && entries_.size() > keep) {
+    const auto& entry = entries_.back();
+    LOG_DEBUG("evict %s from cache", entry.first.c_str());
+    unlink(GetPath(entry.first).c_str());
+    size_ -= entry.second;
+    index_.erase(entry.first);
+    entries_.pop_back();
+  }
+  SaveIndex();
+}
+
+void ResizeCache::LoadIndex() {
+  if (index_loaded_ || directory_.empty()) {
+    return;
+  }
+  index_loaded_ = true;
+
+  std::ifstream file(GetPath(INDEX_FILE));
+  std::string name;
+  int64_t size;
+  while (file >> name >> size) {
+    struct stat st;
+    if (index_.count(name) || stat(GetPath(name).c_str(), &st) != 0 ||
+        st.st_size != size) {
+      continue;
+    }
+    entries_.emplace_back(name, size);
+    index_[name] = std::prev(entries_.end());
+    size_ += size;
+  }
+
+  // Files missing from the index were not completely written, or were
+  // evicted before the index was saved.
+  DIR* dir = opendir(directory_.c_str());
+  if (!dir) {
+    LOG_ERROR("failed to open %s : %s", directory_.c_str(), strerror(errno));
+    return;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name == "." || name == ".." || name == INDEX_FILE ||
+        index_.count(name)) {
+      continue;
+    }
+    LOG_DEBUG("remove %s from cache", name.c_str());
+    unlink(GetPath(name).c_str());
+  }
+  closedir(dir);
+}
+
+void ResizeCache::SaveIndex() {
+  // Written to a temporary file first, so that a crash leaves the previous
+  // index intact.
+  std::string temp_path = GetPath(INDEX_TEMP_FILE);
+  FILE* file = fopen(temp_path.c_str(), "w");
+  if (!file) {
+    LOG_ERROR("failed to open %s : %s", temp_path.c_str(), strerror(errno));
+    return;
+  }
+  for (const auto& entry : entries_) {
+    fprintf(file, "%s %" PRId64 "\n", entry.first.c_str(), entry.second);
+  }
+  if (fclose(file) != 0 ||
+      rename(temp_path.c_str(), GetPath(INDEX_FILE).c_str()) != 0) {
+    LOG_ERROR("failed to write the cache index : %s", strerror(errno));
+    unlink(temp_path.c_str());
+  }
+}
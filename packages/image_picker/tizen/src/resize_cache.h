@@ -0,0 +1,55 @@
+#ifndef FLUTTER_PLUGIN_RESIZE_CACHE_H_
+#define FLUTTER_PLUGIN_RESIZE_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Keeps resized images in the app's cache directory, named after the source
+// file and the resize options, so that picking the same image with the same
+// options again returns the earlier copy. Files are evicted in least
+// recently used order once the cache grows beyond its capacity. The order is
+// kept in an index file, which also tells complete files from files left
+// over by an interrupted resize.
+//
+// Must only be used on the main thread.
+class ResizeCache {
+ public:
+  ResizeCache();
+
+  ResizeCache(const ResizeCache&) = delete;
+  ResizeCache& operator=(const ResizeCache&) = delete;
+
+  // Returns the name of the copy of |file| resized with |options|, or an
+  // empty string if |file| cannot be cached. The name changes whenever the
+  // file is modified.
+  std::string GetName(const std::string& file, const std::string& options);
+  std::string GetPath(const std::string& name) const;
+  // Returns whether the file called |name| is cached, and marks it as the
+  // most recently used if so.
+  bool Lookup(const std::string& name);
+  // Adds the file called |name|, which has been written to GetPath(|name|).
+  void Add(const std::string& name);
+  void SetCapacity(int64_t capacity);  // bytes
+  // Evicts files beyond the capacity, except for the |keep| most recently
+  // used, and writes the index.
+  void Commit(size_t keep);
+
+ private:
+  void LoadIndex();
+  void SaveIndex();
+
+  std::string directory_;
+  bool index_loaded_ = false;
+  int64_t capacity_;
+  // File names and sizes, the most recently used first.
+  std::list<std::pair<std::string, int64_t>> entries_;
+  std::unordered_map<std::string,
+                     std::list<std::pair<std::string, int64_t>>::iterator>
+      index_;
+  int64_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "frame_extractor.h"
+
+#include <image_util.h>
+#include <metadata_extractor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "log.h"
+
+// The maximum total size of downsampled frames kept in the cache.
+#define FRAME_CACHE_CAPACITY (8 * 1024 * 1024)
+#define JPEG_QUALITY 85
+
+struct FrameExtractor::Job {
+  FrameExtractor *extractor;  // null once the extractor is destroyed
+  Ecore_Thread *thread = nullptr;
+  std::shared_ptr<FrameCache> cache;
+
+  // Input.
+  std::string uri;
+  std::string path;
+  std::vector<int64_t> timestamps;
+  int width;
+  int height;
+  ThumbnailFormat format;
+  ExtractCompletedCb on_completed;
+  ExtractFailedCb on_failed;
+
+  // Output.
+  Thumbnails thumbnails;
+  bool failed = false;
+  VideoPlayerError error{"", ""};
+};
+
+std::shared_ptr<const std::vector<uint8_t>> FrameCache::get(
+    const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = index_.find(key);
+  if (iter == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, iter->second);
+  return iter->second->second;
+}
+
+void FrameCache::put(const std::string &key,
+                     std::shared_ptr<const std::vector<uint8_t>> frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (frame->size() > capacity_ || index_.count(key)) {
+    return;
+  }
+  size_ += frame->size();
+  entries_.emplace_front(key, std::move(frame));
+  index_[key] = entries_.begin();
+  while (size_ > capacity_) {
+    size_ -= entries_.back().second->size();
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+// static
+std::string FrameCache::makeKey(const std::string &uri, int64_t timestamp,
+                                int width, int height) {
+  return uri + "#" + std::to_string(timestamp) + "@" + std::to_string(width) +
+         "x" + std::to_string(height);
+}
+
+static int GetIntMetadata(metadata_extractor_h extractor,
+                          metadata_extractor_attr_e attribute) {
+  char *value = nullptr;
+  int ret = metadata_extractor_get_metadata(extractor, attribute, &value);
+  if (ret != METADATA_EXTRACTOR_ERROR_NONE || !value) {
+    return 0;
+  }
+  int result = atoi(value);
+  free(value);
+  return result;
+}
+
+// Scales an RGB888 image to RGBA8888 by averaging the source pixels covered
+// by each destination pixel.
+static void DownsampleRgbToRgba(const uint8_t *src, int src_width,
+                                int src_height, uint8_t *dst, int dst_width,
+                                int dst_height) {
+  for (int y = 0; y < dst_height; y++) {
+    int y0 = (int64_t)y * src_height / dst_height;
+    int y1 =
+        std::max(y0 + 1, (int)((int64_t)(y + 1) * src_height / dst_height));
+    for (int x = 0; x < dst_width; x++) {
+      int x0 = (int64_t)x * src_width / dst_width;
+      int x1 =
+          std::max(x0 + 1, (int)((int64_t)(x + 1) * src_width / dst_width));
+      uint32_t r = 0, g = 0, b = 0;
+      for (int sy = y0; sy < y1; sy++) {
+        const uint8_t *row = src + ((size_t)sy * src_width + x0) * 3;
+        for (int sx = x0; sx < x1; sx++) {
+          r += row[0];
+          g += row[1];
+          b += row[2];
+          row += 3;
+        }
+      }
+      uint32_t count = (uint32_t)(y1 - y0) * (x1 - x0);
+      uint8_t *pixel = dst + ((size_t)y * dst_width + x) * 4;
+      pixel[0] = r / count;
+      pixel[1] = g / count;
+      pixel[2] = b / count;
+      pixel[3] = 0xff;
+    }
+  }
+}
+
+static bool EncodeRgba(const std::vector<uint8_t> &pixels, int width,
+                       int height, ThumbnailFormat format,
+                       std::vector<uint8_t> &encoded) {
+  image_util_encode_h encoder = nullptr;
+  int ret = image_util_encode_create(
+      format == ThumbnailFormat::kPng ? IMAGE_UTIL_PNG : IMAGE_UTIL_JPEG,
+      &encoder);
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("[FrameExtractor] image_util_encode_create failed: %s",
+              get_error_message(ret));
+    return false;
+  }
+
+  unsigned char *buffer = nullptr;
+  unsigned long long size = 0;
+  ret = image_util_encode_set_resolution(encoder, width, height);
+  if (ret == IMAGE_UTIL_ERROR_NONE) {
+    ret = image_util_encode_set_colorspace(encoder,
+                                           IMAGE_UTIL_COLORSPACE_RGBA8888);
+  }
+  if (ret == IMAGE_UTIL_ERROR_NONE && format == ThumbnailFormat::kJpeg) {
+    ret = image_util_encode_set_quality(encoder, JPEG_QUALITY);
+  }
+  if (ret == IMAGE_UTIL_ERROR_NONE) {
+    ret = image_util_encode_set_input_buffer(encoder, pixels.data());
+  }
+  if (ret == IMAGE_UTIL_ERROR_NONE) {
+    ret = image_util_encode_set_output_buffer(encoder, &buffer);
+  }
+  if (ret == IMAGE_UTIL_ERROR_NONE) {
+    ret = image_util_encode_run(encoder, &size);
+  }
+  image_util_encode_destroy(encoder);
+
+  if (ret != IMAGE_UTIL_ERROR_NONE) {
+    LOG_ERROR("[FrameExtractor] failed to encode frame: %s",
+              get_error_message(ret));
+    free(buffer);
+    return false;
+  }
+  encoded.assign(buffer, buffer + size);
+  free(buffer);
+  return true;
+}
+
+FrameExtractor::FrameExtractor()
+    : cache_(std::make_shared<FrameCache>(FRAME_CACHE_CAPACITY)) {}
+
+FrameExtractor::~FrameExtractor() {
+  // Cancelling a job that has not started yet deletes it right away.
+  std::set<Job *> jobs = std::move(jobs_);
+  for (Job *job : jobs) {
+    job->extractor = nullptr;
+    ecore_thread_cancel(job->thread);
+  }
+}
+
+void FrameExtractor::extract(const std::string &uri,
+                             const std::vector<int64_t> &timestamps,
+                             int width, int height, ThumbnailFormat format,
+                             const ExtractCompletedCb &on_completed,
+                             const ExtractFailedCb &on_failed) {
+  std::string path;
+  if (uri.compare(0, 7, "file://") == 0) {
+    path = uri.substr(7);
+  } else if (uri.find("://") == std::string::npos) {
+    path = uri;
+  } else {
+    LOG_ERROR("[FrameExtractor.extract] unsupported uri: %s", uri.c_str());
+    throw VideoPlayerError("Unsupported source",
+                           "Frames can only be extracted from local files.");
+  }
+  if (timestamps.empty() || (width <= 0 && height <= 0)) {
+    throw VideoPlayerError("Invalid argument",
+                           "Timestamps and a width or height are required.");
+  }
+
+  Job *job = new Job();
+  job->extractor = this;
+  job->cache = cache_;
+  job->uri = uri;
+  job->path = path;
+  job->timestamps = timestamps;
+  job->width = width;
+  job->height = height;
+  job->format = format;
+  job->on_completed = on_completed;
+  job->on_failed = on_failed;
+
+  jobs_.insert(job);
+  job->thread = ecore_thread_run(runJob, onJobEnd, onJobCancel, job);
+  if (!job->thread) {
+    // The cancel callback has already deleted the job.
+    throw VideoPlayerError("Internal error", "Failed to start a thread.");
+  }
+}
+
+// Runs on a worker thread.
+void FrameExtractor::runJob(void *data, Ecore_Thread *thread) {
+  Job *job = (Job *)data;
+  metadata_extractor_h extractor = nullptr;
+  int ret = metadata_extractor_create(&extractor);
+  if (ret != METADATA_EXTRACTOR_ERROR_NONE) {
+    job->failed = true;
+    job->error = VideoPlayerError("metadata_extractor_create failed",
+                                  get_error_message(ret));
+    return;
+  }
+  ret = metadata_extractor_set_path(extractor, job->path.c_str());
+  if (ret != METADATA_EXTRACTOR_ERROR_NONE) {
+    metadata_extractor_destroy(extractor);
+    job->failed = true;
+    job->error = VideoPlayerError("metadata_extractor_set_path failed",
+                                  get_error_message(ret));
+    return;
+  }
+
+  int video_width = GetIntMetadata(extractor, METADATA_VIDEO_WIDTH);
+  int video_height = GetIntMetadata(extractor, METADATA_VIDEO_HEIGHT);
+  if (video_width <= 0 || video_height <= 0) {
+    metadata_extractor_destroy(extractor);
+    job->failed = true;
+    job->error = VideoPlayerError("Invalid source", "No video track found.");
+    return;
+  }
+  int width = job->width;
+  int height = job->height;
+  if (width <= 0) {
+    width = std::max(1, (int)((int64_t)height * video_width / video_height));
+  } else if (height <= 0) {
+    height = std::max(1, (int)((int64_t)width * video_height / video_width));
+  }
+
+  std::vector<std::shared_ptr<const std::vector<uint8_t>>> frames;
+  for (int64_t timestamp : job->timestamps) {
+    if (ecore_thread_check(thread)) {
+      metadata_extractor_destroy(extractor);
+      return;
+    }
+    std::string key = FrameCache::makeKey(job->uri, timestamp, width, height);
+    auto frame = job->cache->get(key);
+    if (!frame) {
+      void *buffer = nullptr;
+      int size = 0;
+      ret = metadata_extractor_get_frame_at_time(extractor, timestamp, false,
+                                                 &buffer, &size);
+      if (ret == METADATA_EXTRACTOR_ERROR_NONE && buffer &&
+          size >= video_width * video_height * 3) {
+        auto pixels = std::make_shared<std::vector<uint8_t>>(
+            (size_t)width * height * 4);
+        DownsampleRgbToRgba((const uint8_t *)buffer, video_width,
+                            video_height, pixels->data(), width, height);
+        frame = pixels;
+        job->cache->put(key, frame);
+      } else {
+        LOG_ERROR("[FrameExtractor.runJob] no frame at %lld: %s",
+                  (long long)timestamp, get_error_message(ret));
+      }
+      free(buffer);
+    }
+    frames.push_back(frame);
+  }
+  metadata_extractor_destroy(extractor);
+
+  Thumbnails &thumbnails = job->thumbnails;
+  thumbnails.width = width;
+  thumbnails.height = height;
+  if (job->format == ThumbnailFormat::kSprite) {
+    int count = frames.size();
+    int columns = std::ceil(std::sqrt(count));
+    int rows = (count + columns - 1) / columns;
+    size_t stride = (size_t)columns * width * 4;
+    thumbnails.columns = columns;
+    // Missing frames are left transparent.
+    thumbnails.sprite.assign(stride * rows * height, 0);
+    for (int i = 0; i < count; i++) {
+      if (!frames[i]) {
+        continue;
+      }
+      uint8_t *origin = thumbnails.sprite.data() +
+                        (size_t)(i / columns) * height * stride +
+                        (size_t)(i % columns) * width * 4;
+      for (int y = 0; y < height; y++) {
+        memcpy(origin + y * stride, frames[i]->data() + (size_t)y * width * 4,
+               (size_t)width * 4);
+      }
+    }
+  } else {
+    // Missing frames are reported as empty images.
+    thumbnails.images.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+      if (ecore_thread_check(thread)) {
+        return;
+      }
+      if (frames[i]) {
+        EncodeRgba(*frames[i], width, height, job->format,
+                   thumbnails.images[i]);
+      }
+    }
+  }
+}
+
+// Runs on the main thread.
+void FrameExtractor::onJobEnd(void *data, Ecore_Thread *thread) {
+  Job *job = (Job *)data;
+  if (job->extractor) {
+    job->extractor->jobs_.erase(job);
+    if (job->failed) {
+      LOG_ERROR("[FrameExtractor.onJobEnd] %s: %s",
+                job->error.getCode().c_str(), job->error.getMessage().c_str());
+      job->on_failed(job->error);
+    } else {
+      job->on_completed(job->thumbnails);
+    }
+  }
+  delete job;
+}
+
+// Runs on the main thread.
+void FrameExtractor::onJobCancel(void *data, Ecore_Thread *thread) {
+  Job *job = (Job *)data;
+  if (job->extractor) {
+    job->extractor->jobs_.erase(job);
+  }
+  delete job;
+}
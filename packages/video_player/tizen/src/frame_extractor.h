@@ -0,0 +1,89 @@
+#ifndef VIDEO_PLAYER_FRAME_EXTRACTOR_H_
+#define VIDEO_PLAYER_FRAME_EXTRACTOR_H_
+
+#include <Ecore.h>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "video_player_error.h"
+
+enum class ThumbnailFormat { kSprite, kJpeg, kPng };
+
+// The frames extracted by a single FrameExtractor::extract call.
+struct Thumbnails {
+  int width = 0;   // width of each frame
+  int height = 0;  // height of each frame
+  // The RGBA sprite sheet for ThumbnailFormat::kSprite. Frames are laid out
+  // row by row, |columns| frames per row, in the order of the timestamps.
+  int columns = 0;
+  std::vector<uint8_t> sprite;
+  // One encoded image per timestamp for the other formats.
+  std::vector<std::vector<uint8_t>> images;
+};
+
+// A thread-safe LRU cache of downsampled RGBA frames keyed by URI,
+// timestamp and size.
+class FrameCache {
+ public:
+  explicit FrameCache(size_t capacity) : capacity_(capacity) {}
+
+  std::shared_ptr<const std::vector<uint8_t>> get(const std::string &key);
+  void put(const std::string &key,
+           std::shared_ptr<const std::vector<uint8_t>> frame);
+
+  static std::string makeKey(const std::string &uri, int64_t timestamp,
+                             int width, int height);
+
+ private:
+  using Entry =
+      std::pair<std::string, std::shared_ptr<const std::vector<uint8_t>>>;
+
+  std::mutex mutex_;
+  size_t capacity_;  // bytes
+  size_t size_ = 0;  // bytes
+  // The most recently used entry first.
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+// Decodes frames of local media files without creating a player. Decoding,
+// downsampling and encoding run on Ecore worker threads, and the callbacks
+// are called on the main thread.
+class FrameExtractor {
+ public:
+  using ExtractCompletedCb = std::function<void(const Thumbnails &)>;
+  using ExtractFailedCb = std::function<void(const VideoPlayerError &)>;
+
+  FrameExtractor();
+  ~FrameExtractor();
+
+  // Extracts frames of |uri| at |timestamps| (milliseconds) and scales them
+  // to |width| x |height|. If one of the dimensions is not positive, it is
+  // derived from the other one and the aspect ratio of the video.
+  void extract(const std::string &uri, const std::vector<int64_t> &timestamps,
+               int width, int height, ThumbnailFormat format,
+               const ExtractCompletedCb &on_completed,
+               const ExtractFailedCb &on_failed);
+
+ private:
+  struct Job;
+
+  static void runJob(void *data, Ecore_Thread *thread);
+  static void onJobEnd(void *data, Ecore_Thread *thread);
+  static void onJobCancel(void *data, Ecore_Thread *thread);
+
+  // Shared with the jobs, which may outlive the extractor until their
+  // worker threads notice the cancellation.
+  std::shared_ptr<FrameCache> cache_;
+  std::set<Job *> jobs_;
+};
+
+#endif  // VIDEO_PLAYER_FRAME_EXTRACTOR_H_
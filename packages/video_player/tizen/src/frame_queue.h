@@ -0,0 +1,205 @@
+#ifndef VIDEO_PLAYER_FRAME_QUEUE_H_
+#define VIDEO_PLAYER_FRAME_QUEUE_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Hands decoded frames over from the decoder thread to the raster thread,
+// and picks the frame to present at each refresh by its presentation time.
+// |Frame| has an int64_t |pts| in milliseconds and a uint32_t |serial|.
+//
+// push() and dropPushed() may run concurrently with anything. The other
+// methods must not run concurrently with each other.
+template <typename Frame>
+class FrameQueue {
+ public:
+  static constexpr size_t kMaxQueuedFrames = 4;
+  // A frame is presented if its timestamp is within this window of the
+  // clock.
+  static constexpr int64_t kPresentToleranceMs = 8;
+  // Timestamp gaps larger than this are treated as discontinuities (e.g.
+  // looping).
+  static constexpr int64_t kDiscontinuityMs = 1000;
+
+  // Pushed frames are owned by the queue, and freed with |deleter|.
+  explicit FrameQueue(std::function<void(Frame *)> deleter)
+      : deleter_(std::move(deleter)) {}
+  ~FrameQueue() { clear(); }
+
+  FrameQueue(const FrameQueue &) = delete;
+  FrameQueue &operator=(const FrameQueue &) = delete;
+
+  // Never waits for the raster thread. If the slot still holds a frame,
+  // the raster thread has fallen behind and that frame is dropped. Returns
+  // whether a frame was dropped.
+  bool push(Frame *frame) {
+    size_t index = next_slot_++ % kMaxQueuedFrames;
+    Frame *unconsumed = slots_[index].exchange(frame);
+    if (unconsumed) {
+      deleter_(unconsumed);
+      dropped_frames_++;
+      return true;
+    }
+    return false;
+  }
+
+  // Collects the frames pushed since the last call, dropping those whose
+  // serial is not |serial|, and returns the frame to present at |clock|,
+  // or in decoding order if |clock| is negative. The returned frame stays
+  // valid until the next call or clear(). |selected| tells whether it was
+  // newly selected by the clock.
+  Frame *update(uint32_t serial, int64_t clock, bool *selected) {
+    collect(serial);
+    Frame *frame = select(clock);
+    *selected = frame != nullptr;
+    if (frame) {
+      // The engine is done with the previous frame once it asks for a new
+      // one.
+      if (current_) {
+        deleter_(current_);
+      }
+      current_ = frame;
+    } else if (current_ && !queue_.empty()) {
+      duplicated_frames_++;
+    }
+    if (!current_ && !queue_.empty()) {
+      // Nothing is on screen yet, so show the earliest frame even if it is
+      // early rather than leaving the texture empty.
+      current_ = queue_.front();
+      queue_.pop_front();
+    }
+    return current_;
+  }
+
+  // Whether collected frames are waiting to be presented.
+  bool hasPendingFrames() const { return !queue_.empty(); }
+
+  // Drops the frames pushed but not collected yet.
+  void dropPushed() {
+    for (std::atomic<Frame *> &slot : slots_) {
+      Frame *frame = slot.exchange(nullptr);
+      if (frame) {
+        deleter_(frame);
+      }
+    }
+  }
+
+  void clear() {
+    dropPushed();
+    for (Frame *frame : queue_) {
+      deleter_(frame);
+    }
+    queue_.clear();
+    if (current_) {
+      deleter_(current_);
+      current_ = nullptr;
+    }
+  }
+
+  uint64_t getDroppedFrames() const { return dropped_frames_; }
+  uint64_t getDuplicatedFrames() const { return duplicated_frames_; }
+
+ private:
+  void collect(uint32_t serial) {
+    // Frames queued before the last seek would otherwise be presented as a
+    // discontinuity after seeking backwards.
+    for (auto iter = queue_.begin(); iter != queue_.end();) {
+      if ((*iter)->serial != serial) {
+        deleter_(*iter);
+        iter = queue_.erase(iter);
+      } else {
+        iter++;
+      }
+    }
+    for (std::atomic<Frame *> &slot : slots_) {
+      Frame *frame = slot.exchange(nullptr);
+      if (!frame) {
+        continue;
+      }
+      if (frame->serial != serial) {
+        // Decoded before the last seek.
+        deleter_(frame);
+        continue;
+      }
+      if (current_ && current_->serial == serial &&
+          frame->pts < current_->pts &&
+          frame->pts + kDiscontinuityMs >= current_->pts) {
+        // Collected after a later frame has already been presented.
+        deleter_(frame);
+        dropped_frames_++;
+        continue;
+      }
+      if (!queue_.empty() &&
+          frame->pts + kDiscontinuityMs < queue_.back()->pts) {
+        // The timeline restarted (e.g. looping), so keep decoding order.
+        queue_.push_back(frame);
+      } else {
+        auto position = std::upper_bound(
+            queue_.begin(), queue_.end(), frame,
+            [](const Frame *a, const Frame *b) { return a->pts < b->pts; });
+        queue_.insert(position, frame);
+      }
+    }
+    while (queue_.size() > kMaxQueuedFrames) {
+      deleter_(queue_.front());
+      queue_.pop_front();
+      dropped_frames_++;
+    }
+  }
+
+  // Pops the queued frame that should be on screen at |clock|. Returns
+  // nullptr if no queued frame is due yet.
+  Frame *select(int64_t clock) {
+    if (queue_.empty()) {
+      return nullptr;
+    }
+    if (clock < 0) {
+      // Without a clock, fall back to presenting frames in decoding order.
+      Frame *frame = queue_.front();
+      queue_.pop_front();
+      return frame;
+    }
+
+    // Take the latest frame that is due. Older due frames were never shown
+    // in time and are dropped.
+    Frame *selected = nullptr;
+    while (!queue_.empty()) {
+      Frame *frame = queue_.front();
+      bool is_due = frame->pts <= clock + kPresentToleranceMs;
+      bool is_discontinuous = frame->pts > clock + kDiscontinuityMs;
+      if (!is_due && !is_discontinuous) {
+        break;
+      }
+      if (selected) {
+        deleter_(selected);
+        dropped_frames_++;
+      }
+      selected = frame;
+      queue_.pop_front();
+      if (is_discontinuous) {
+        break;
+      }
+    }
+    return selected;
+  }
+
+  std::function<void(Frame *)> deleter_;
+  // Written by the decoder thread and drained by the raster thread, each
+  // slot being handed over with an atomic exchange.
+  std::array<std::atomic<Frame *>, kMaxQueuedFrames> slots_{};
+  std::atomic<size_t> next_slot_{0};
+  // Collected frames waiting to be presented, ordered by presentation time.
+  std::deque<Frame *> queue_;
+  // The frame last presented. It is kept until a newer frame replaces it so
+  // that it can be presented again if no new frame is due.
+  Frame *current_ = nullptr;
+  std::atomic<uint64_t> dropped_frames_{0};
+  std::atomic<uint64_t> duplicated_frames_{0};
+};
+
+#endif  // VIDEO_PLAYER_FRAME_QUEUE_H_
@@ -0,0 +1,72 @@
+#include "media_buffer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include "log.h"
+#include "video_player_error.h"
+
+// static
+std::shared_ptr<MediaBuffer> MediaBuffer::mapFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR("[MediaBuffer.mapFile] open failed: %s", strerror(errno));
+    throw VideoPlayerError("Failed to open file", strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > INT_MAX) {
+    close(fd);
+    LOG_ERROR("[MediaBuffer.mapFile] invalid file: %s", path.c_str());
+    throw VideoPlayerError("Invalid file",
+                           "The file is empty or larger than 2 GB.");
+  }
+
+  void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    LOG_ERROR("[MediaBuffer.mapFile] mmap failed: %s", strerror(errno));
+    throw VideoPlayerError("Failed to map file", strerror(errno));
+  }
+  // The demuxer reads the file mostly front to back.
+  madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+
+  std::shared_ptr<MediaBuffer> buffer(new MediaBuffer());
+  buffer->path_ = path;
+  buffer->mapped_ = mapped;
+  buffer->size_ = st.st_size;
+  LOG_DEBUG("[MediaBuffer.mapFile] mapped %s (%zu bytes)", path.c_str(),
+            buffer->size_);
+  return buffer;
+}
+
+// static
+std::shared_ptr<MediaBuffer> MediaBuffer::fromBytes(
+    std::shared_ptr<const std::vector<uint8_t>> bytes) {
+  if (!bytes || bytes->empty() || bytes->size() > INT_MAX) {
+    throw VideoPlayerError("Invalid argument",
+                           "The buffer is empty or larger than 2 GB.");
+  }
+  std::shared_ptr<MediaBuffer> buffer(new MediaBuffer());
+  buffer->size_ = bytes->size();
+  buffer->bytes_ = std::move(bytes);
+  return buffer;
+}
+
+MediaBuffer::~MediaBuffer() {
+  if (mapped_) {
+    LOG_DEBUG("[MediaBuffer] unmap %s", path_.c_str());
+    munmap(mapped_, size_);
+  }
+}
+
+const void *MediaBuffer::getData() const {
+  return mapped_ ? mapped_ : bytes_->data();
+}
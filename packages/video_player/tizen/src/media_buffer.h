@@ -0,0 +1,38 @@
+#ifndef VIDEO_PLAYER_MEDIA_BUFFER_H_
+#define VIDEO_PLAYER_MEDIA_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// An immutable in-memory media source passed to player_set_memory_buffer.
+// The player must keep a reference until it is unprepared.
+class MediaBuffer {
+ public:
+  // Maps |path| read-only into memory. Throws VideoPlayerError on failure.
+  static std::shared_ptr<MediaBuffer> mapFile(const std::string &path);
+  // Wraps |bytes| without copying them.
+  static std::shared_ptr<MediaBuffer> fromBytes(
+      std::shared_ptr<const std::vector<uint8_t>> bytes);
+
+  ~MediaBuffer();
+  MediaBuffer(const MediaBuffer &) = delete;
+  MediaBuffer &operator=(const MediaBuffer &) = delete;
+
+  const void *getData() const;
+  size_t getSize() const { return size_; }
+  // The mapped path, or empty for buffers created from bytes.
+  const std::string &getPath() const { return path_; }
+
+ private:
+  MediaBuffer() = default;
+
+  std::string path_;
+  void *mapped_ = nullptr;
+  size_t size_ = 0;
+  std::shared_ptr<const std::vector<uint8_t>> bytes_;
+};
+
+#endif  // VIDEO_PLAYER_MEDIA_BUFFER_H_
@@ -0,0 +1,20 @@
+#include "media_clock.h"
+
+void MediaClock::update(int position, bool running, double rate,
+                        TimePoint time) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  position_ = position;
+  running_ = running;
+  rate_ = rate;
+  time_ = time;
+}
+
+int MediaClock::get(TimePoint time) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (position_ < 0 || !running_ || time <= time_) {
+    return position_;
+  }
+  auto elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(time - time_);
+  return position_ + (int)(elapsed.count() * rate_);
+}
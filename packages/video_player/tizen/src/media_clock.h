@@ -0,0 +1,30 @@
+#ifndef VIDEO_PLAYER_MEDIA_CLOCK_H_
+#define VIDEO_PLAYER_MEDIA_CLOCK_H_
+
+#include <chrono>
+#include <mutex>
+
+// The playback position last sampled from a player, extrapolated to the
+// current time. Positions are sampled on threads that may call the player,
+// and read by the raster thread, which must not.
+class MediaClock {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  // Records that the player was at |position| at |time|, advancing at |rate|
+  // if |running|.
+  void update(int position, bool running, double rate,
+              TimePoint time);  // milliseconds
+  // Returns the position at |time|, or -1 if none has been recorded.
+  int get(TimePoint time) const;  // milliseconds
+
+ private:
+  // Only held to copy the fields below, never while calling the player.
+  mutable std::mutex mutex_;
+  int position_ = -1;
+  bool running_ = false;
+  double rate_ = 1.0;
+  TimePoint time_;
+};
+
+#endif  // VIDEO_PLAYER_MEDIA_CLOCK_H_
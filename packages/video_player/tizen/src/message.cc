@@ -5,6 +5,40 @@
 
 #include "log.h"
 
+static const flutter::EncodableValue kAssetKey("asset");
+static const flutter::EncodableValue kBytesKey("bytes");
+static const flutter::EncodableValue kBudgetKey("budget");
+static const flutter::EncodableValue kFormatHintKey("formatHint");
+static const flutter::EncodableValue kFormatKey("format");
+static const flutter::EncodableValue kHeightKey("height");
+static const flutter::EncodableValue kIntervalKey("interval");
+static const flutter::EncodableValue kIsLoopingKey("isLooping");
+static const flutter::EncodableValue kIsScrubbingKey("isScrubbing");
+static const flutter::EncodableValue kIsVisibleKey("isVisible");
+static const flutter::EncodableValue kItemsKey("items");
+static const flutter::EncodableValue kMaxBitrateKey("maxBitrate");
+static const flutter::EncodableValue kMaxHeightKey("maxHeight");
+static const flutter::EncodableValue kMaxWidthKey("maxWidth");
+static const flutter::EncodableValue kMemoryMappedKey("memoryMapped");
+static const flutter::EncodableValue kMixWithOthersKey("mixWithOthers");
+static const flutter::EncodableValue kPackageNameKey("packageName");
+static const flutter::EncodableValue kPositionKey("position");
+static const flutter::EncodableValue kSoftwareRenderingKey(
+    "softwareRendering");
+static const flutter::EncodableValue kSpeedKey("speed");
+static const flutter::EncodableValue kTextureIdKey("textureId");
+static const flutter::EncodableValue kTimestampsKey("timestamps");
+static const flutter::EncodableValue kUriKey("uri");
+static const flutter::EncodableValue kVolumeKey("volume");
+static const flutter::EncodableValue kWidthKey("width");
+
+// Looks up |key| without copying |map| or inserting missing keys.
+static const flutter::EncodableValue *FindValue(
+    const flutter::EncodableMap &map, const flutter::EncodableValue &key) {
+  auto iter = map.find(key);
+  return iter != map.end() ? &iter->second : nullptr;
+}
+
 long TextureMessage::getTextureId() const { return textureId_; }
 
 void TextureMessage::setTextureId(long textureId) { textureId_ = textureId; }
@@ -20,12 +54,11 @@ flutter::EncodableValue TextureMessage::toMap() {
 TextureMessage TextureMessage::fromMap(const flutter::EncodableValue &value) {
   TextureMessage fromMapResult;
   if (std::holds_alternative<flutter::EncodableMap>(value)) {
-    flutter::EncodableMap emap = std::get<flutter::EncodableMap>(value);
-    flutter::EncodableValue &textureId =
-        emap[flutter::EncodableValue("textureId")];
-    if (std::holds_alternative<int32_t>(textureId) ||
-        std::holds_alternative<int64_t>(textureId)) {
-      fromMapResult.setTextureId(textureId.LongValue());
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
       LOG_DEBUG("[TextureMessage.fromMap] textureId: %ld",
                 fromMapResult.getTextureId());
     }
@@ -53,6 +86,29 @@ void CreateMessage::setFormatHint(const std::string &formatHint) {
   formatHint_ = formatHint;
 }
 
+std::shared_ptr<const std::vector<uint8_t>> CreateMessage::getBytes() const {
+  return bytes_;
+}
+
+void CreateMessage::setBytes(
+    std::shared_ptr<const std::vector<uint8_t>> bytes) {
+  bytes_ = std::move(bytes);
+}
+
+bool CreateMessage::getMemoryMapped() const { return memoryMapped_; }
+
+void CreateMessage::setMemoryMapped(bool memoryMapped) {
+  memoryMapped_ = memoryMapped;
+}
+
+bool CreateMessage::getSoftwareRendering() const {
+  return softwareRendering_;
+}
+
+void CreateMessage::setSoftwareRendering(bool softwareRendering) {
+  softwareRendering_ = softwareRendering;
+}
+
 flutter::EncodableValue CreateMessage::toMap() {
   LOG_DEBUG("[CreateMessage.toMap] asset: %s", asset_.c_str());
   LOG_DEBUG("[CreateMessage.toMap] uri: %s", uri_.c_str());
@@ -65,7 +121,15 @@ flutter::EncodableValue CreateMessage::toMap() {
       {flutter::EncodableValue("packageName"),
        flutter::EncodableValue(packageName_)},
       {flutter::EncodableValue("formatHint"),
-       flutter::EncodableValue(formatHint_)}};
+       flutter::EncodableValue(formatHint_)},
+      {flutter::EncodableValue("memoryMapped"),
+       flutter::EncodableValue(memoryMapped_)},
+      {flutter::EncodableValue("softwareRendering"),
+       flutter::EncodableValue(softwareRendering_)}};
+  if (bytes_) {
+    toMapResult[flutter::EncodableValue("bytes")] =
+        flutter::EncodableValue(*bytes_);
+  }
 
   return flutter::EncodableValue(toMapResult);
 }
@@ -73,36 +137,216 @@ flutter::EncodableValue CreateMessage::toMap() {
 CreateMessage CreateMessage::fromMap(const flutter::EncodableValue &value) {
   CreateMessage fromMapResult;
   if (std::holds_alternative<flutter::EncodableMap>(value)) {
-    flutter::EncodableMap emap = std::get<flutter::EncodableMap>(value);
-    flutter::EncodableValue &asset = emap[flutter::EncodableValue("asset")];
-    if (std::holds_alternative<std::string>(asset)) {
-      fromMapResult.setAsset(std::get<std::string>(asset));
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *asset = FindValue(emap, kAssetKey);
+    if (asset && std::holds_alternative<std::string>(*asset)) {
+      fromMapResult.setAsset(std::get<std::string>(*asset));
       LOG_DEBUG("[CreateMessage.fromMap] asset: %s",
                 fromMapResult.getAsset().c_str());
     }
 
-    flutter::EncodableValue &uri = emap[flutter::EncodableValue("uri")];
-    if (std::holds_alternative<std::string>(uri)) {
-      fromMapResult.setUri(std::get<std::string>(uri));
+    const flutter::EncodableValue *uri = FindValue(emap, kUriKey);
+    if (uri && std::holds_alternative<std::string>(*uri)) {
+      fromMapResult.setUri(std::get<std::string>(*uri));
       LOG_DEBUG("[CreateMessage.fromMap] uri: %s",
                 fromMapResult.getUri().c_str());
     }
 
-    flutter::EncodableValue &packageName =
-        emap[flutter::EncodableValue("packageName")];
-    if (std::holds_alternative<std::string>(packageName)) {
-      fromMapResult.setPackageName(std::get<std::string>(uri));
+    const flutter::EncodableValue *packageName =
+        FindValue(emap, kPackageNameKey);
+    if (packageName && std::holds_alternative<std::string>(*packageName)) {
+      fromMapResult.setPackageName(std::get<std::string>(*packageName));
       LOG_DEBUG("[CreateMessage.fromMap] packageName: %s",
                 fromMapResult.getPackageName().c_str());
     }
 
-    flutter::EncodableValue &formatHint =
-        emap[flutter::EncodableValue("formatHint")];
-    if (std::holds_alternative<std::string>(formatHint)) {
-      fromMapResult.setFormatHint(std::get<std::string>(formatHint));
+    const flutter::EncodableValue *formatHint = FindValue(emap, kFormatHintKey);
+    if (formatHint && std::holds_alternative<std::string>(*formatHint)) {
+      fromMapResult.setFormatHint(std::get<std::string>(*formatHint));
       LOG_DEBUG("[CreateMessage.fromMap] formatHint: %s",
                 fromMapResult.getFormatHint().c_str());
     }
+
+    const flutter::EncodableValue *bytes = FindValue(emap, kBytesKey);
+    if (bytes && std::holds_alternative<std::vector<uint8_t>>(*bytes)) {
+      fromMapResult.setBytes(std::make_shared<const std::vector<uint8_t>>(
+          std::get<std::vector<uint8_t>>(*bytes)));
+      LOG_DEBUG("[CreateMessage.fromMap] bytes: %zu",
+                fromMapResult.getBytes()->size());
+    }
+
+    const flutter::EncodableValue *memoryMapped =
+        FindValue(emap, kMemoryMappedKey);
+    if (memoryMapped && std::holds_alternative<bool>(*memoryMapped)) {
+      fromMapResult.setMemoryMapped(std::get<bool>(*memoryMapped));
+      LOG_DEBUG("[CreateMessage.fromMap] memoryMapped: %d",
+                fromMapResult.getMemoryMapped());
+    }
+
+    const flutter::EncodableValue *softwareRendering =
+        FindValue(emap, kSoftwareRenderingKey);
+    if (softwareRendering &&
+        std::holds_alternative<bool>(*softwareRendering)) {
+      fromMapResult.setSoftwareRendering(std::get<bool>(*softwareRendering));
+      LOG_DEBUG("[CreateMessage.fromMap] softwareRendering: %d",
+                fromMapResult.getSoftwareRendering());
+    }
+  }
+
+  return fromMapResult;
+}
+
+CreateMessage CreateMessage::fromMap(flutter::EncodableValue &&value) {
+  std::shared_ptr<const std::vector<uint8_t>> bytes;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    auto &emap = std::get<flutter::EncodableMap>(value);
+    auto iter = emap.find(kBytesKey);
+    if (iter != emap.end() &&
+        std::holds_alternative<std::vector<uint8_t>>(iter->second)) {
+      bytes = std::make_shared<const std::vector<uint8_t>>(
+          std::move(std::get<std::vector<uint8_t>>(iter->second)));
+      emap.erase(iter);
+      LOG_DEBUG("[CreateMessage.fromMap] bytes: %zu", bytes->size());
+    }
+  }
+  CreateMessage fromMapResult = fromMap(value);
+  if (bytes) {
+    fromMapResult.setBytes(std::move(bytes));
+  }
+  return fromMapResult;
+}
+
+std::string ExtractFramesMessage::getAsset() const { return asset_; }
+
+void ExtractFramesMessage::setAsset(const std::string &asset) {
+  asset_ = asset;
+}
+
+std::string ExtractFramesMessage::getUri() const { return uri_; }
+
+void ExtractFramesMessage::setUri(const std::string &uri) { uri_ = uri; }
+
+std::string ExtractFramesMessage::getPackageName() const {
+  return packageName_;
+}
+
+void ExtractFramesMessage::setPackageName(const std::string &packageName) {
+  packageName_ = packageName;
+}
+
+const std::vector<int64_t> &ExtractFramesMessage::getTimestamps() const {
+  return timestamps_;
+}
+
+void ExtractFramesMessage::setTimestamps(
+    const std::vector<int64_t> &timestamps) {
+  timestamps_ = timestamps;
+}
+
+long ExtractFramesMessage::getWidth() const { return width_; }
+
+void ExtractFramesMessage::setWidth(long width) { width_ = width; }
+
+long ExtractFramesMessage::getHeight() const { return height_; }
+
+void ExtractFramesMessage::setHeight(long height) { height_ = height; }
+
+std::string ExtractFramesMessage::getFormat() const { return format_; }
+
+void ExtractFramesMessage::setFormat(const std::string &format) {
+  format_ = format;
+}
+
+flutter::EncodableValue ExtractFramesMessage::toMap() {
+  LOG_DEBUG("[ExtractFramesMessage.toMap] uri: %s", uri_.c_str());
+  LOG_DEBUG("[ExtractFramesMessage.toMap] format: %s", format_.c_str());
+
+  flutter::EncodableList timestamps;
+  for (int64_t timestamp : timestamps_) {
+    timestamps.push_back(flutter::EncodableValue(timestamp));
+  }
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("asset"), flutter::EncodableValue(asset_)},
+      {flutter::EncodableValue("uri"), flutter::EncodableValue(uri_)},
+      {flutter::EncodableValue("packageName"),
+       flutter::EncodableValue(packageName_)},
+      {flutter::EncodableValue("timestamps"),
+       flutter::EncodableValue(timestamps)},
+      {flutter::EncodableValue("width"),
+       flutter::EncodableValue((int64_t)width_)},
+      {flutter::EncodableValue("height"),
+       flutter::EncodableValue((int64_t)height_)},
+      {flutter::EncodableValue("format"), flutter::EncodableValue(format_)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
+ExtractFramesMessage ExtractFramesMessage::fromMap(
+    const flutter::EncodableValue &value) {
+  ExtractFramesMessage fromMapResult;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *asset = FindValue(emap, kAssetKey);
+    if (asset && std::holds_alternative<std::string>(*asset)) {
+      fromMapResult.setAsset(std::get<std::string>(*asset));
+      LOG_DEBUG("[ExtractFramesMessage.fromMap] asset: %s",
+                fromMapResult.getAsset().c_str());
+    }
+
+    const flutter::EncodableValue *uri = FindValue(emap, kUriKey);
+    if (uri && std::holds_alternative<std::string>(*uri)) {
+      fromMapResult.setUri(std::get<std::string>(*uri));
+      LOG_DEBUG("[ExtractFramesMessage.fromMap] uri: %s",
+                fromMapResult.getUri().c_str());
+    }
+
+    const flutter::EncodableValue *packageName =
+        FindValue(emap, kPackageNameKey);
+    if (packageName && std::holds_alternative<std::string>(*packageName)) {
+      fromMapResult.setPackageName(std::get<std::string>(*packageName));
+      LOG_DEBUG("[ExtractFramesMessage.fromMap] packageName: %s",
+                fromMapResult.getPackageName().c_str());
+    }
+
+    const flutter::EncodableValue *timestamps =
+        FindValue(emap, kTimestampsKey);
+    if (timestamps &&
+        std::holds_alternative<flutter::EncodableList>(*timestamps)) {
+      std::vector<int64_t> result;
+      for (const auto &timestamp :
+           std::get<flutter::EncodableList>(*timestamps)) {
+        if (std::holds_alternative<int32_t>(timestamp) ||
+            std::holds_alternative<int64_t>(timestamp)) {
+          result.push_back(timestamp.LongValue());
+        }
+      }
+      fromMapResult.setTimestamps(result);
+      LOG_DEBUG("[ExtractFramesMessage.fromMap] timestamps: %zu",
+                result.size());
+    }
+
+    const flutter::EncodableValue *width = FindValue(emap, kWidthKey);
+    if (width && (std::holds_alternative<int32_t>(*width) ||
+                  std::holds_alternative<int64_t>(*width))) {
+      fromMapResult.setWidth(width->LongValue());
+      LOG_DEBUG("[ExtractFramesMessage.fromMap] width: %ld",
+                fromMapResult.getWidth());
+    }
+
+    const flutter::EncodableValue *height = FindValue(emap, kHeightKey);
+    if (height && (std::holds_alternative<int32_t>(*height) ||
+                   std::holds_alternative<int64_t>(*height))) {
+      fromMapResult.setHeight(height->LongValue());
+      LOG_DEBUG("[ExtractFramesMessage.fromMap] height: %ld",
+                fromMapResult.getHeight());
+    }
+
+    const flutter::EncodableValue *format = FindValue(emap, kFormatKey);
+    if (format && std::holds_alternative<std::string>(*format)) {
+      fromMapResult.setFormat(std::get<std::string>(*format));
+      LOG_DEBUG("[ExtractFramesMessage.fromMap] format: %s",
+                fromMapResult.getFormat().c_str());
+    }
   }
 
   return fromMapResult;
@@ -132,20 +376,18 @@ flutter::EncodableValue LoopingMessage::toMap() {
 LoopingMessage LoopingMessage::fromMap(const flutter::EncodableValue &value) {
   LoopingMessage fromMapResult;
   if (std::holds_alternative<flutter::EncodableMap>(value)) {
-    flutter::EncodableMap emap = std::get<flutter::EncodableMap>(value);
-    flutter::EncodableValue &textureId =
-        emap[flutter::EncodableValue("textureId")];
-    if (std::holds_alternative<int32_t>(textureId) ||
-        std::holds_alternative<int64_t>(textureId)) {
-      fromMapResult.setTextureId(textureId.LongValue());
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
       LOG_DEBUG("[LoopingMessage.fromMap] textureId: %ld",
                 fromMapResult.getTextureId());
     }
 
-    flutter::EncodableValue &isLooping =
-        emap[flutter::EncodableValue("isLooping")];
-    if (std::holds_alternative<bool>(isLooping)) {
-      fromMapResult.setIsLooping(std::get<bool>(isLooping));
+    const flutter::EncodableValue *isLooping = FindValue(emap, kIsLoopingKey);
+    if (isLooping && std::holds_alternative<bool>(*isLooping)) {
+      fromMapResult.setIsLooping(std::get<bool>(*isLooping));
       LOG_DEBUG("[LoopingMessage.fromMap] isLooping: %d",
                 fromMapResult.getIsLooping());
     }
@@ -154,6 +396,254 @@ LoopingMessage LoopingMessage::fromMap(const flutter::EncodableValue &value) {
   return fromMapResult;
 }
 
+long ScrubbingMessage::getTextureId() const { return textureId_; }
+
+void ScrubbingMessage::setTextureId(long textureId) { textureId_ = textureId; }
+
+bool ScrubbingMessage::getIsScrubbing() const { return isScrubbing_; }
+
+void ScrubbingMessage::setIsScrubbing(bool isScrubbing) {
+  isScrubbing_ = isScrubbing;
+}
+
+flutter::EncodableValue ScrubbingMessage::toMap() {
+  LOG_DEBUG("[ScrubbingMessage.toMap] textureId: %ld", textureId_);
+  LOG_DEBUG("[ScrubbingMessage.toMap] isScrubbing: %d", isScrubbing_);
+
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("textureId"),
+       flutter::EncodableValue((int64_t)textureId_)},
+      {flutter::EncodableValue("isScrubbing"),
+       flutter::EncodableValue(isScrubbing_)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
+ScrubbingMessage ScrubbingMessage::fromMap(
+    const flutter::EncodableValue &value) {
+  ScrubbingMessage fromMapResult;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
+      LOG_DEBUG("[ScrubbingMessage.fromMap] textureId: %ld",
+                fromMapResult.getTextureId());
+    }
+
+    const flutter::EncodableValue *isScrubbing =
+        FindValue(emap, kIsScrubbingKey);
+    if (isScrubbing && std::holds_alternative<bool>(*isScrubbing)) {
+      fromMapResult.setIsScrubbing(std::get<bool>(*isScrubbing));
+      LOG_DEBUG("[ScrubbingMessage.fromMap] isScrubbing: %d",
+                fromMapResult.getIsScrubbing());
+    }
+  }
+
+  return fromMapResult;
+}
+
+long PositionUpdateIntervalMessage::getInterval() const { return interval_; }
+
+void PositionUpdateIntervalMessage::setInterval(long interval) {
+  interval_ = interval;
+}
+
+flutter::EncodableValue PositionUpdateIntervalMessage::toMap() {
+  LOG_DEBUG("[PositionUpdateIntervalMessage.toMap] interval: %ld", interval_);
+
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("interval"),
+       flutter::EncodableValue((int64_t)interval_)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
+PositionUpdateIntervalMessage PositionUpdateIntervalMessage::fromMap(
+    const flutter::EncodableValue &value) {
+  PositionUpdateIntervalMessage fromMapResult;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *interval = FindValue(emap, kIntervalKey);
+    if (interval && (std::holds_alternative<int32_t>(*interval) ||
+                     std::holds_alternative<int64_t>(*interval))) {
+      fromMapResult.setInterval(interval->LongValue());
+      LOG_DEBUG("[PositionUpdateIntervalMessage.fromMap] interval: %ld",
+                fromMapResult.getInterval());
+    }
+  }
+
+  return fromMapResult;
+}
+
+long VisibilityMessage::getTextureId() const { return textureId_; }
+
+void VisibilityMessage::setTextureId(long textureId) { textureId_ = textureId; }
+
+bool VisibilityMessage::getIsVisible() const { return isVisible_; }
+
+void VisibilityMessage::setIsVisible(bool isVisible) { isVisible_ = isVisible; }
+
+flutter::EncodableValue VisibilityMessage::toMap() {
+  LOG_DEBUG("[VisibilityMessage.toMap] textureId: %ld", textureId_);
+  LOG_DEBUG("[VisibilityMessage.toMap] isVisible: %d", isVisible_);
+
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("textureId"),
+       flutter::EncodableValue((int64_t)textureId_)},
+      {flutter::EncodableValue("isVisible"),
+       flutter::EncodableValue(isVisible_)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
+VisibilityMessage VisibilityMessage::fromMap(
+    const flutter::EncodableValue &value) {
+  VisibilityMessage fromMapResult;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
+      LOG_DEBUG("[VisibilityMessage.fromMap] textureId: %ld",
+                fromMapResult.getTextureId());
+    }
+
+    const flutter::EncodableValue *isVisible = FindValue(emap, kIsVisibleKey);
+    if (isVisible && std::holds_alternative<bool>(*isVisible)) {
+      fromMapResult.setIsVisible(std::get<bool>(*isVisible));
+      LOG_DEBUG("[VisibilityMessage.fromMap] isVisible: %d",
+                fromMapResult.getIsVisible());
+    }
+  }
+
+  return fromMapResult;
+}
+
+long PlaylistMessage::getTextureId() const { return textureId_; }
+
+void PlaylistMessage::setTextureId(long textureId) { textureId_ = textureId; }
+
+const std::vector<CreateMessage> &PlaylistMessage::getItems() const {
+  return items_;
+}
+
+void PlaylistMessage::setItems(const std::vector<CreateMessage> &items) {
+  items_ = items;
+}
+
+flutter::EncodableValue PlaylistMessage::toMap() {
+  LOG_DEBUG("[PlaylistMessage.toMap] textureId: %ld", textureId_);
+  LOG_DEBUG("[PlaylistMessage.toMap] items: %zu", items_.size());
+
+  flutter::EncodableList items;
+  for (CreateMessage &item : items_) {
+    items.push_back(item.toMap());
+  }
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("textureId"),
+       flutter::EncodableValue((int64_t)textureId_)},
+      {flutter::EncodableValue("items"), flutter::EncodableValue(items)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
+PlaylistMessage PlaylistMessage::fromMap(const flutter::EncodableValue &value) {
+  PlaylistMessage fromMapResult;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
+      LOG_DEBUG("[PlaylistMessage.fromMap] textureId: %ld",
+                fromMapResult.getTextureId());
+    }
+
+    const flutter::EncodableValue *items = FindValue(emap, kItemsKey);
+    if (items && std::holds_alternative<flutter::EncodableList>(*items)) {
+      std::vector<CreateMessage> result;
+      for (const auto &item : std::get<flutter::EncodableList>(*items)) {
+        result.push_back(CreateMessage::fromMap(item));
+      }
+      fromMapResult.setItems(result);
+      LOG_DEBUG("[PlaylistMessage.fromMap] items: %zu", result.size());
+    }
+  }
+
+  return fromMapResult;
+}
+
+long DecoderBudgetMessage::getBudget() const { return budget_; }
+
+void DecoderBudgetMessage::setBudget(long budget) { budget_ = budget; }
+
+flutter::EncodableValue DecoderBudgetMessage::toMap() {
+  LOG_DEBUG("[DecoderBudgetMessage.toMap] budget: %ld", budget_);
+
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("budget"),
+       flutter::EncodableValue((int64_t)budget_)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
+DecoderBudgetMessage DecoderBudgetMessage::fromMap(
+    const flutter::EncodableValue &value) {
+  DecoderBudgetMessage fromMapResult;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *budget = FindValue(emap, kBudgetKey);
+    if (budget && (std::holds_alternative<int32_t>(*budget) ||
+                   std::holds_alternative<int64_t>(*budget))) {
+      fromMapResult.setBudget(budget->LongValue());
+      LOG_DEBUG("[DecoderBudgetMessage.fromMap] budget: %ld",
+                fromMapResult.getBudget());
+    }
+  }
+
+  return fromMapResult;
+}
+
+long ResourceUsageMessage::getDecoderBudget() const { return decoderBudget_; }
+
+void ResourceUsageMessage::setDecoderBudget(long decoderBudget) {
+  decoderBudget_ = decoderBudget;
+}
+
+long ResourceUsageMessage::getActivePlayers() const { return activePlayers_; }
+
+void ResourceUsageMessage::setActivePlayers(long activePlayers) {
+  activePlayers_ = activePlayers;
+}
+
+long ResourceUsageMessage::getSuspendedPlayers() const {
+  return suspendedPlayers_;
+}
+
+void ResourceUsageMessage::setSuspendedPlayers(long suspendedPlayers) {
+  suspendedPlayers_ = suspendedPlayers;
+}
+
+flutter::EncodableValue ResourceUsageMessage::toMap() {
+  LOG_DEBUG("[ResourceUsageMessage.toMap] decoderBudget: %ld", decoderBudget_);
+  LOG_DEBUG("[ResourceUsageMessage.toMap] activePlayers: %ld", activePlayers_);
+  LOG_DEBUG("[ResourceUsageMessage.toMap] suspendedPlayers: %ld",
+            suspendedPlayers_);
+
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("decoderBudget"),
+       flutter::EncodableValue((int64_t)decoderBudget_)},
+      {flutter::EncodableValue("activePlayers"),
+       flutter::EncodableValue((int64_t)activePlayers_)},
+      {flutter::EncodableValue("suspendedPlayers"),
+       flutter::EncodableValue((int64_t)suspendedPlayers_)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
 long VolumeMessage::getTextureId() const { return textureId_; }
 
 void VolumeMessage::setTextureId(long textureId) { textureId_ = textureId; }
@@ -177,19 +667,18 @@ flutter::EncodableValue VolumeMessage::toMap() {
 VolumeMessage VolumeMessage::fromMap(const flutter::EncodableValue &value) {
   VolumeMessage fromMapResult;
   if (std::holds_alternative<flutter::EncodableMap>(value)) {
-    flutter::EncodableMap emap = std::get<flutter::EncodableMap>(value);
-    flutter::EncodableValue &textureId =
-        emap[flutter::EncodableValue("textureId")];
-    if (std::holds_alternative<int32_t>(textureId) ||
-        std::holds_alternative<int64_t>(textureId)) {
-      fromMapResult.setTextureId(textureId.LongValue());
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
       LOG_DEBUG("[VolumeMessage.fromMap] textureId: %ld",
                 fromMapResult.getTextureId());
     }
 
-    flutter::EncodableValue &volume = emap[flutter::EncodableValue("volume")];
-    if (std::holds_alternative<double>(volume)) {
-      fromMapResult.setVolume(std::get<double>(volume));
+    const flutter::EncodableValue *volume = FindValue(emap, kVolumeKey);
+    if (volume && std::holds_alternative<double>(*volume)) {
+      fromMapResult.setVolume(std::get<double>(*volume));
       LOG_DEBUG("[VolumeMessage.fromMap] volume: %f",
                 fromMapResult.getVolume());
     }
@@ -224,19 +713,18 @@ PlaybackSpeedMessage PlaybackSpeedMessage::fromMap(
     const flutter::EncodableValue &value) {
   PlaybackSpeedMessage fromMapResult;
   if (std::holds_alternative<flutter::EncodableMap>(value)) {
-    flutter::EncodableMap emap = std::get<flutter::EncodableMap>(value);
-    flutter::EncodableValue &textureId =
-        emap[flutter::EncodableValue("textureId")];
-    if (std::holds_alternative<int32_t>(textureId) ||
-        std::holds_alternative<int64_t>(textureId)) {
-      fromMapResult.setTextureId(textureId.LongValue());
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
       LOG_DEBUG("[VolumeMessage.fromMap] textureId: %ld",
                 fromMapResult.getTextureId());
     }
 
-    flutter::EncodableValue &speed = emap[flutter::EncodableValue("speed")];
-    if (std::holds_alternative<double>(speed)) {
-      fromMapResult.setSpeed(std::get<double>(speed));
+    const flutter::EncodableValue *speed = FindValue(emap, kSpeedKey);
+    if (speed && std::holds_alternative<double>(*speed)) {
+      fromMapResult.setSpeed(std::get<double>(*speed));
       LOG_DEBUG("[VolumeMessage.fromMap] speed: %f", fromMapResult.getSpeed());
     }
   }
@@ -244,6 +732,86 @@ PlaybackSpeedMessage PlaybackSpeedMessage::fromMap(
   return fromMapResult;
 }
 
+long AdaptiveVariantLimitMessage::getTextureId() const { return textureId_; }
+
+void AdaptiveVariantLimitMessage::setTextureId(long textureId) {
+  textureId_ = textureId;
+}
+
+int AdaptiveVariantLimitMessage::getMaxBitrate() const { return maxBitrate_; }
+
+void AdaptiveVariantLimitMessage::setMaxBitrate(int maxBitrate) {
+  maxBitrate_ = maxBitrate;
+}
+
+int AdaptiveVariantLimitMessage::getMaxWidth() const { return maxWidth_; }
+
+void AdaptiveVariantLimitMessage::setMaxWidth(int maxWidth) {
+  maxWidth_ = maxWidth;
+}
+
+int AdaptiveVariantLimitMessage::getMaxHeight() const { return maxHeight_; }
+
+void AdaptiveVariantLimitMessage::setMaxHeight(int maxHeight) {
+  maxHeight_ = maxHeight;
+}
+
+flutter::EncodableValue AdaptiveVariantLimitMessage::toMap() {
+  LOG_DEBUG("[AdaptiveVariantLimitMessage.toMap] textureId: %ld", textureId_);
+  LOG_DEBUG("[AdaptiveVariantLimitMessage.toMap] maxBitrate: %d", maxBitrate_);
+  LOG_DEBUG("[AdaptiveVariantLimitMessage.toMap] maxWidth: %d", maxWidth_);
+  LOG_DEBUG("[AdaptiveVariantLimitMessage.toMap] maxHeight: %d", maxHeight_);
+
+  flutter::EncodableMap toMapResult = {
+      {flutter::EncodableValue("textureId"),
+       flutter::EncodableValue((int64_t)textureId_)},
+      {flutter::EncodableValue("maxBitrate"),
+       flutter::EncodableValue(maxBitrate_)},
+      {flutter::EncodableValue("maxWidth"), flutter::EncodableValue(maxWidth_)},
+      {flutter::EncodableValue("maxHeight"),
+       flutter::EncodableValue(maxHeight_)}};
+
+  return flutter::EncodableValue(toMapResult);
+}
+
+AdaptiveVariantLimitMessage AdaptiveVariantLimitMessage::fromMap(
+    const flutter::EncodableValue &value) {
+  AdaptiveVariantLimitMessage fromMapResult;
+  if (std::holds_alternative<flutter::EncodableMap>(value)) {
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
+      LOG_DEBUG("[AdaptiveVariantLimitMessage.fromMap] textureId: %ld",
+                fromMapResult.getTextureId());
+    }
+
+    const flutter::EncodableValue *maxBitrate = FindValue(emap, kMaxBitrateKey);
+    if (maxBitrate && std::holds_alternative<int32_t>(*maxBitrate)) {
+      fromMapResult.setMaxBitrate(std::get<int32_t>(*maxBitrate));
+      LOG_DEBUG("[AdaptiveVariantLimitMessage.fromMap] maxBitrate: %d",
+                fromMapResult.getMaxBitrate());
+    }
+
+    const flutter::EncodableValue *maxWidth = FindValue(emap, kMaxWidthKey);
+    if (maxWidth && std::holds_alternative<int32_t>(*maxWidth)) {
+      fromMapResult.setMaxWidth(std::get<int32_t>(*maxWidth));
+      LOG_DEBUG("[AdaptiveVariantLimitMessage.fromMap] maxWidth: %d",
+                fromMapResult.getMaxWidth());
+    }
+
+    const flutter::EncodableValue *maxHeight = FindValue(emap, kMaxHeightKey);
+    if (maxHeight && std::holds_alternative<int32_t>(*maxHeight)) {
+      fromMapResult.setMaxHeight(std::get<int32_t>(*maxHeight));
+      LOG_DEBUG("[AdaptiveVariantLimitMessage.fromMap] maxHeight: %d",
+                fromMapResult.getMaxHeight());
+    }
+  }
+
+  return fromMapResult;
+}
+
 long PositionMessage::getTextureId() const { return textureId_; }
 
 void PositionMessage::setTextureId(long textureId) { textureId_ = textureId; }
@@ -268,21 +836,19 @@ flutter::EncodableValue PositionMessage::toMap() {
 PositionMessage PositionMessage::fromMap(const flutter::EncodableValue &value) {
   PositionMessage fromMapResult;
   if (std::holds_alternative<flutter::EncodableMap>(value)) {
-    flutter::EncodableMap emap = std::get<flutter::EncodableMap>(value);
-    flutter::EncodableValue &textureId =
-        emap[flutter::EncodableValue("textureId")];
-    if (std::holds_alternative<int32_t>(textureId) ||
-        std::holds_alternative<int64_t>(textureId)) {
-      fromMapResult.setTextureId(textureId.LongValue());
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *textureId = FindValue(emap, kTextureIdKey);
+    if (textureId && (std::holds_alternative<int32_t>(*textureId) ||
+                      std::holds_alternative<int64_t>(*textureId))) {
+      fromMapResult.setTextureId(textureId->LongValue());
       LOG_DEBUG("[PositionMessage.fromMap] textureId: %ld",
                 fromMapResult.getTextureId());
     }
 
-    flutter::EncodableValue &position =
-        emap[flutter::EncodableValue("position")];
-    if (std::holds_alternative<int32_t>(position) ||
-        std::holds_alternative<int64_t>(position)) {
-      fromMapResult.setPosition(position.LongValue());
+    const flutter::EncodableValue *position = FindValue(emap, kPositionKey);
+    if (position && (std::holds_alternative<int32_t>(*position) ||
+                     std::holds_alternative<int64_t>(*position))) {
+      fromMapResult.setPosition(position->LongValue());
       LOG_DEBUG("[PositionMessage.fromMap] position: %ld",
                 fromMapResult.getPosition());
     }
@@ -311,11 +877,11 @@ MixWithOthersMessage MixWithOthersMessage::fromMap(
     const flutter::EncodableValue &value) {
   MixWithOthersMessage fromMapResult;
   if (std::holds_alternative<flutter::EncodableMap>(value)) {
-    flutter::EncodableMap emap = std::get<flutter::EncodableMap>(value);
-    flutter::EncodableValue &mixWithOthers =
-        emap[flutter::EncodableValue("mixWithOthers")];
-    if (std::holds_alternative<bool>(mixWithOthers)) {
-      fromMapResult.setMixWithOthers(std::get<bool>(mixWithOthers));
+    const auto &emap = std::get<flutter::EncodableMap>(value);
+    const flutter::EncodableValue *mixWithOthers =
+        FindValue(emap, kMixWithOthersKey);
+    if (mixWithOthers && std::holds_alternative<bool>(*mixWithOthers)) {
+      fromMapResult.setMixWithOthers(std::get<bool>(*mixWithOthers));
       LOG_DEBUG("[MixWithOthersMessage.fromMap] mixWithOthers: %d",
                 fromMapResult.getMixWithOthers());
     }
@@ -349,19 +915,53 @@ void VideoPlayerApi::setup(flutter::BinaryMessenger *binaryMessenger,
   }
 
   LOG_DEBUG("[VideoPlayerApi.setup] setup create channel");
-  auto createChannel =
+  if (api != nullptr) {
+    // Decoded here rather than by a BasicMessageChannel, which only passes
+    // the message as const, so that the bytes of in-memory media can be
+    // moved out of it instead of copied.
+    binaryMessenger->SetMessageHandler(
+        "dev.flutter.pigeon.VideoPlayerApi.create",
+        [api](const uint8_t *message, size_t message_size,
+              flutter::BinaryReply reply) {
+          const flutter::StandardMessageCodec &codec =
+              flutter::StandardMessageCodec::GetInstance();
+          std::unique_ptr<flutter::EncodableValue> value =
+              codec.DecodeMessage(message, message_size);
+          if (!value) {
+            LOG_ERROR("[VideoPlayerApi.create] failed to decode the message");
+            reply(nullptr, 0);
+            return;
+          }
+          CreateMessage input = CreateMessage::fromMap(std::move(*value));
+          flutter::EncodableMap wrapped;
+          try {
+            TextureMessage output = api->create(input);
+            wrapped.emplace(flutter::EncodableValue("result"), output.toMap());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          std::unique_ptr<std::vector<uint8_t>> encoded =
+              codec.EncodeMessage(flutter::EncodableValue(wrapped));
+          reply(encoded->data(), encoded->size());
+        });
+  }
+
+  LOG_DEBUG("[VideoPlayerApi.setup] setup preload channel");
+  auto preloadChannel =
       std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
-          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.create",
+          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.preload",
           &flutter::StandardMessageCodec::GetInstance());
   if (api != nullptr) {
-    createChannel->SetMessageHandler(
+    preloadChannel->SetMessageHandler(
         [api](const flutter::EncodableValue &message,
               flutter::MessageReply<flutter::EncodableValue> reply) {
           CreateMessage input = CreateMessage::fromMap(message);
           flutter::EncodableMap wrapped;
           try {
-            TextureMessage output = api->create(input);
-            wrapped.emplace(flutter::EncodableValue("result"), output.toMap());
+            api->preload(input);
+            wrapped.emplace(flutter::EncodableValue("result"),
+                            flutter::EncodableValue());
           } catch (const VideoPlayerError &e) {
             wrapped.emplace(flutter::EncodableValue("error"),
                             VideoPlayerApi::wrapError(e));
@@ -462,6 +1062,31 @@ void VideoPlayerApi::setup(flutter::BinaryMessenger *binaryMessenger,
         });
   }
 
+  LOG_DEBUG("[VideoPlayerApi.setup] setup setAdaptiveVariantLimit channel");
+  auto variantLimitChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger,
+          "dev.flutter.pigeon.VideoPlayerApi.setAdaptiveVariantLimit",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    variantLimitChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          AdaptiveVariantLimitMessage input =
+              AdaptiveVariantLimitMessage::fromMap(message);
+          flutter::EncodableMap wrapped;
+          try {
+            api->setAdaptiveVariantLimit(input);
+            wrapped.emplace(flutter::EncodableValue("result"),
+                            flutter::EncodableValue());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          reply(flutter::EncodableValue(wrapped));
+        });
+  }
+
   LOG_DEBUG("[VideoPlayerApi.setup] setup play channel");
   auto playChannel =
       std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
@@ -532,6 +1157,174 @@ void VideoPlayerApi::setup(flutter::BinaryMessenger *binaryMessenger,
         });
   }
 
+  LOG_DEBUG("[VideoPlayerApi.setup] setup setScrubbing channel");
+  auto scrubbingChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.setScrubbing",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    scrubbingChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          ScrubbingMessage input = ScrubbingMessage::fromMap(message);
+          flutter::EncodableMap wrapped;
+          try {
+            api->setScrubbing(input);
+            wrapped.emplace(flutter::EncodableValue("result"),
+                            flutter::EncodableValue());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          reply(flutter::EncodableValue(wrapped));
+        });
+  }
+
+  LOG_DEBUG("[VideoPlayerApi.setup] setup setPositionUpdateInterval channel");
+  auto positionUpdateIntervalChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger,
+          "dev.flutter.pigeon.VideoPlayerApi.setPositionUpdateInterval",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    positionUpdateIntervalChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          PositionUpdateIntervalMessage input =
+              PositionUpdateIntervalMessage::fromMap(message);
+          flutter::EncodableMap wrapped;
+          try {
+            api->setPositionUpdateInterval(input);
+            wrapped.emplace(flutter::EncodableValue("result"),
+                            flutter::EncodableValue());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          reply(flutter::EncodableValue(wrapped));
+        });
+  }
+
+  LOG_DEBUG("[VideoPlayerApi.setup] setup setVisibility channel");
+  auto setVisibilityChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.setVisibility",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    setVisibilityChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          VisibilityMessage input = VisibilityMessage::fromMap(message);
+          flutter::EncodableMap wrapped;
+          try {
+            api->setVisibility(input);
+            wrapped.emplace(flutter::EncodableValue("result"),
+                            flutter::EncodableValue());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          reply(flutter::EncodableValue(wrapped));
+        });
+  }
+
+  LOG_DEBUG("[VideoPlayerApi.setup] setup setPlaylist channel");
+  auto setPlaylistChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.setPlaylist",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    setPlaylistChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          PlaylistMessage input = PlaylistMessage::fromMap(message);
+          flutter::EncodableMap wrapped;
+          try {
+            api->setPlaylist(input);
+            wrapped.emplace(flutter::EncodableValue("result"),
+                            flutter::EncodableValue());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          reply(flutter::EncodableValue(wrapped));
+        });
+  }
+
+  LOG_DEBUG("[VideoPlayerApi.setup] setup setDecoderBudget channel");
+  auto setDecoderBudgetChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.setDecoderBudget",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    setDecoderBudgetChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          DecoderBudgetMessage input = DecoderBudgetMessage::fromMap(message);
+          flutter::EncodableMap wrapped;
+          try {
+            api->setDecoderBudget(input);
+            wrapped.emplace(flutter::EncodableValue("result"),
+                            flutter::EncodableValue());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          reply(flutter::EncodableValue(wrapped));
+        });
+  }
+
+  LOG_DEBUG("[VideoPlayerApi.setup] setup resourceUsage channel");
+  auto resourceUsageChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.resourceUsage",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    resourceUsageChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          flutter::EncodableMap wrapped;
+          try {
+            ResourceUsageMessage output = api->resourceUsage();
+            wrapped.emplace(flutter::EncodableValue("result"), output.toMap());
+          } catch (const VideoPlayerError &e) {
+            wrapped.emplace(flutter::EncodableValue("error"),
+                            VideoPlayerApi::wrapError(e));
+          }
+          reply(flutter::EncodableValue(wrapped));
+        });
+  }
+
+  LOG_DEBUG("[VideoPlayerApi.setup] setup extractFrames channel");
+  auto extractFramesChannel =
+      std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+          binaryMessenger, "dev.flutter.pigeon.VideoPlayerApi.extractFrames",
+          &flutter::StandardMessageCodec::GetInstance());
+  if (api != nullptr) {
+    extractFramesChannel->SetMessageHandler(
+        [api](const flutter::EncodableValue &message,
+              flutter::MessageReply<flutter::EncodableValue> reply) {
+          ExtractFramesMessage input = ExtractFramesMessage::fromMap(message);
+          auto onFailed = [reply](const VideoPlayerError &e) {
+            flutter::EncodableMap error = {{flutter::EncodableValue("error"),
+                                            VideoPlayerApi::wrapError(e)}};
+            reply(flutter::EncodableValue(error));
+          };
+          try {
+            api->extractFrames(
+                input,
+                [reply](const flutter::EncodableValue &thumbnails) {
+                  flutter::EncodableMap wrapped = {
+                      {flutter::EncodableValue("result"), thumbnails}};
+                  reply(flutter::EncodableValue(wrapped));
+                },
+                onFailed);
+          } catch (const VideoPlayerError &e) {
+            onFailed(e);
+          }
+        });
+  }
+
   LOG_DEBUG("[VideoPlayerApi.setup] setup pause channel");
   auto pauseChannel =
       std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
@@ -4,8 +4,11 @@
 #include <flutter/binary_messenger.h>
 #include <flutter/encodable_value.h>
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "video_player_error.h"
 
@@ -40,14 +43,60 @@ class CreateMessage {
   void setPackageName(const std::string &packageName);
   std::string getFormatHint() const;
   void setFormatHint(const std::string &formatHint);
+  // The media content passed from Dart, or null if not given.
+  std::shared_ptr<const std::vector<uint8_t>> getBytes() const;
+  void setBytes(std::shared_ptr<const std::vector<uint8_t>> bytes);
+  bool getMemoryMapped() const;
+  void setMemoryMapped(bool memoryMapped);
+  bool getSoftwareRendering() const;
+  void setSoftwareRendering(bool softwareRendering);
   flutter::EncodableValue toMap();
   static CreateMessage fromMap(const flutter::EncodableValue &value);
+  // Same as above, but moves the bytes out of |value| instead of copying.
+  static CreateMessage fromMap(flutter::EncodableValue &&value);
 
  private:
   std::string asset_;
   std::string uri_;
   std::string packageName_;
   std::string formatHint_;
+  std::shared_ptr<const std::vector<uint8_t>> bytes_;
+  bool memoryMapped_ = false;
+  bool softwareRendering_ = false;
+};
+
+class ExtractFramesMessage {
+ public:
+  ExtractFramesMessage() : width_(0), height_(0) {}
+  ~ExtractFramesMessage() = default;
+  ExtractFramesMessage(ExtractFramesMessage const &) = default;
+  ExtractFramesMessage &operator=(ExtractFramesMessage const &) = default;
+
+  std::string getAsset() const;
+  void setAsset(const std::string &asset);
+  std::string getUri() const;
+  void setUri(const std::string &uri);
+  std::string getPackageName() const;
+  void setPackageName(const std::string &packageName);
+  const std::vector<int64_t> &getTimestamps() const;
+  void setTimestamps(const std::vector<int64_t> &timestamps);
+  long getWidth() const;
+  void setWidth(long width);
+  long getHeight() const;
+  void setHeight(long height);
+  std::string getFormat() const;
+  void setFormat(const std::string &format);
+  flutter::EncodableValue toMap();
+  static ExtractFramesMessage fromMap(const flutter::EncodableValue &value);
+
+ private:
+  std::string asset_;
+  std::string uri_;
+  std::string packageName_;
+  std::vector<int64_t> timestamps_;
+  long width_;
+  long height_;
+  std::string format_;
 };
 
 class LoopingMessage {
@@ -69,6 +118,121 @@ class LoopingMessage {
   bool isLooping_;
 };
 
+class ScrubbingMessage {
+ public:
+  ScrubbingMessage() : textureId_(0), isScrubbing_(false) {}
+  ~ScrubbingMessage() = default;
+  ScrubbingMessage(ScrubbingMessage const &) = default;
+  ScrubbingMessage &operator=(ScrubbingMessage const &) = default;
+
+  long getTextureId() const;
+  void setTextureId(long textureId);
+  bool getIsScrubbing() const;
+  void setIsScrubbing(bool isScrubbing);
+  flutter::EncodableValue toMap();
+  static ScrubbingMessage fromMap(const flutter::EncodableValue &value);
+
+ private:
+  long textureId_;
+  bool isScrubbing_;
+};
+
+class PositionUpdateIntervalMessage {
+ public:
+  PositionUpdateIntervalMessage() : interval_(0) {}
+  ~PositionUpdateIntervalMessage() = default;
+  PositionUpdateIntervalMessage(PositionUpdateIntervalMessage const &) =
+      default;
+  PositionUpdateIntervalMessage &operator=(
+      PositionUpdateIntervalMessage const &) = default;
+
+  long getInterval() const;
+  void setInterval(long interval);
+  flutter::EncodableValue toMap();
+  static PositionUpdateIntervalMessage fromMap(
+      const flutter::EncodableValue &value);
+
+ private:
+  long interval_;
+};
+
+class VisibilityMessage {
+ public:
+  VisibilityMessage() : textureId_(0), isVisible_(false) {}
+  ~VisibilityMessage() = default;
+  VisibilityMessage(VisibilityMessage const &) = default;
+  VisibilityMessage &operator=(VisibilityMessage const &) = default;
+
+  long getTextureId() const;
+  void setTextureId(long textureId);
+  bool getIsVisible() const;
+  void setIsVisible(bool isVisible);
+  flutter::EncodableValue toMap();
+  static VisibilityMessage fromMap(const flutter::EncodableValue &value);
+
+ private:
+  long textureId_;
+  bool isVisible_;
+};
+
+class PlaylistMessage {
+ public:
+  PlaylistMessage() : textureId_(0) {}
+  ~PlaylistMessage() = default;
+  PlaylistMessage(PlaylistMessage const &) = default;
+  PlaylistMessage &operator=(PlaylistMessage const &) = default;
+
+  long getTextureId() const;
+  void setTextureId(long textureId);
+  // The media to play after the current one, in order.
+  const std::vector<CreateMessage> &getItems() const;
+  void setItems(const std::vector<CreateMessage> &items);
+  flutter::EncodableValue toMap();
+  static PlaylistMessage fromMap(const flutter::EncodableValue &value);
+
+ private:
+  long textureId_;
+  std::vector<CreateMessage> items_;
+};
+
+class DecoderBudgetMessage {
+ public:
+  DecoderBudgetMessage() : budget_(0) {}
+  ~DecoderBudgetMessage() = default;
+  DecoderBudgetMessage(DecoderBudgetMessage const &) = default;
+  DecoderBudgetMessage &operator=(DecoderBudgetMessage const &) = default;
+
+  long getBudget() const;
+  void setBudget(long budget);
+  flutter::EncodableValue toMap();
+  static DecoderBudgetMessage fromMap(const flutter::EncodableValue &value);
+
+ private:
+  long budget_;
+};
+
+class ResourceUsageMessage {
+ public:
+  ResourceUsageMessage()
+      : decoderBudget_(0), activePlayers_(0), suspendedPlayers_(0) {}
+  ~ResourceUsageMessage() = default;
+  ResourceUsageMessage(ResourceUsageMessage const &) = default;
+  ResourceUsageMessage &operator=(ResourceUsageMessage const &) = default;
+
+  long getDecoderBudget() const;
+  void setDecoderBudget(long decoderBudget);
+  long getActivePlayers() const;
+  void setActivePlayers(long activePlayers);
+  long getSuspendedPlayers() const;
+  void setSuspendedPlayers(long suspendedPlayers);
+  flutter::EncodableValue toMap();
+
+ private:
+  long decoderBudget_;
+  long activePlayers_;
+  long suspendedPlayers_;
+};
+
 class VolumeMessage {
  public:
   VolumeMessage() : textureId_(0), volume_(0.0) {}
@@ -107,6 +271,34 @@ class PlaybackSpeedMessage {
   double speed_;
 };
 
+class AdaptiveVariantLimitMessage {
+ public:
+  AdaptiveVariantLimitMessage()
+      : textureId_(0), maxBitrate_(-1), maxWidth_(-1), maxHeight_(-1) {}
+  ~AdaptiveVariantLimitMessage() = default;
+  AdaptiveVariantLimitMessage(AdaptiveVariantLimitMessage const &) = default;
+  AdaptiveVariantLimitMessage &operator=(AdaptiveVariantLimitMessage const &) =
+      default;
+
+  long getTextureId() const;
+  void setTextureId(long textureId);
+  int getMaxBitrate() const;
+  void setMaxBitrate(int maxBitrate);
+  int getMaxWidth() const;
+  void setMaxWidth(int maxWidth);
+  int getMaxHeight() const;
+  void setMaxHeight(int maxHeight);
+  flutter::EncodableValue toMap();
+  static AdaptiveVariantLimitMessage fromMap(
+      const flutter::EncodableValue &value);
+
+ private:
+  long textureId_;
+  int maxBitrate_;
+  int maxWidth_;
+  int maxHeight_;
+};
+
 class PositionMessage {
  public:
   PositionMessage() : textureId_(0), position_(0) {}
@@ -143,20 +335,36 @@ class MixWithOthersMessage {
 };
 
 using SeekCompletedCb = std::function<void()>;
+using ExtractFramesCompletedCb =
+    std::function<void(const flutter::EncodableValue &thumbnails)>;
+using ExtractFramesFailedCb = std::function<void(const VideoPlayerError &)>;
 
 class VideoPlayerApi {
  public:
   virtual void initialize() = 0;
   virtual TextureMessage create(const CreateMessage &createMsg) = 0;
+  virtual void preload(const CreateMessage &createMsg) = 0;
   virtual void dispose(const TextureMessage &textureMsg) = 0;
   virtual void setLooping(const LoopingMessage &loopingMsg) = 0;
   virtual void setVolume(const VolumeMessage &volumeMsg) = 0;
   virtual void setPlaybackSpeed(const PlaybackSpeedMessage &speedMsg) = 0;
+  virtual void setAdaptiveVariantLimit(
+      const AdaptiveVariantLimitMessage &limitMsg) = 0;
   virtual void play(const TextureMessage &textureMsg) = 0;
   virtual void pause(const TextureMessage &textureMsg) = 0;
   virtual PositionMessage position(const TextureMessage &textureMsg) = 0;
   virtual void seekTo(const PositionMessage &positionMsg,
                       const SeekCompletedCb &onSeekCompleted) = 0;
+  virtual void setScrubbing(const ScrubbingMessage &scrubbingMsg) = 0;
+  virtual void setPositionUpdateInterval(
+      const PositionUpdateIntervalMessage &intervalMsg) = 0;
+  virtual void setVisibility(const VisibilityMessage &visibilityMsg) = 0;
+  virtual void setPlaylist(const PlaylistMessage &playlistMsg) = 0;
+  virtual void setDecoderBudget(const DecoderBudgetMessage &budgetMsg) = 0;
+  virtual ResourceUsageMessage resourceUsage() = 0;
+  virtual void extractFrames(const ExtractFramesMessage &extractMsg,
+                             const ExtractFramesCompletedCb &onCompleted,
+                             const ExtractFramesFailedCb &onFailed) = 0;
   virtual void setMixWithOthers(
       const MixWithOthersMessage &mixWithOthersMsg) = 0;
 
@@ -0,0 +1,103 @@
+#include "resource_governor.h"
+
+#include "log.h"
+#include "video_player.h"
+
+void ResourceGovernor::setDecoderBudget(int budget) {
+  LOG_DEBUG("[ResourceGovernor.setDecoderBudget] budget: %d", budget);
+  decoder_budget_ = budget;
+  enforceBudget(nullptr);
+}
+
+void ResourceGovernor::addPlayer(VideoPlayer *player) {
+  // A new player is usually about to be shown.
+  entries_.push_front({player, true});
+  enforceBudget(player);
+}
+
+void ResourceGovernor::removePlayer(VideoPlayer *player) {
+  auto iter = find(player);
+  if (iter != entries_.end()) {
+    entries_.erase(iter);
+  }
+}
+
+void ResourceGovernor::setVisible(VideoPlayer *player, bool is_visible) {
+  auto iter = find(player);
+  if (iter == entries_.end()) {
+    return;
+  }
+  iter->is_visible = is_visible;
+  if (is_visible) {
+    moveToFront(iter);
+  }
+}
+
+void ResourceGovernor::acquire(VideoPlayer *player) {
+  auto iter = find(player);
+  if (iter == entries_.end()) {
+    return;
+  }
+  moveToFront(iter);
+  enforceBudget(player);
+}
+
+int ResourceGovernor::getActivePlayerCount() const {
+  int count = 0;
+  for (const Entry &entry : entries_) {
+    if (!entry.player->isSuspended()) {
+      count++;
+    }
+  }
+  return count;
+}
+
+int ResourceGovernor::getSuspendedPlayerCount() const {
+  return entries_.size() - getActivePlayerCount();
+}
+
+std::list<ResourceGovernor::Entry>::iterator ResourceGovernor::find(
+    VideoPlayer *player) {
+  for (auto iter = entries_.begin(); iter != entries_.end(); iter++) {
+    if (iter->player == player) {
+      return iter;
+    }
+  }
+  return entries_.end();
+}
+
+void ResourceGovernor::moveToFront(std::list<Entry>::iterator iter) {
+  entries_.splice(entries_.begin(), entries_, iter);
+}
+
+// |keep| is about to use its decoder. It is counted as active even if it
+// is still suspended, and is never suspended here.
+void ResourceGovernor::enforceBudget(VideoPlayer *keep) {
+  if (decoder_budget_ <= 0) {
+    return;
+  }
+  int active = getActivePlayerCount();
+  if (keep && keep->isSuspended()) {
+    active++;
+  }
+
+  // Offscreen players go first, then visible ones, which keep showing
+  // their last frame while suspended.
+  for (bool include_visible : {false, true}) {
+    for (auto iter = entries_.rbegin();
+         iter != entries_.rend() && active > decoder_budget_; iter++) {
+      VideoPlayer *player = iter->player;
+      if (player == keep || player->isSuspended() || player->isPlaying() ||
+          (iter->is_visible && !include_visible)) {
+        continue;
+      }
+      if (player->suspend()) {
+        active--;
+      }
+    }
+  }
+  if (active > decoder_budget_) {
+    LOG_INFO("[ResourceGovernor.enforceBudget] %d players over budget %d",
+             active, decoder_budget_);
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef VIDEO_PLAYER_RESOURCE_GOVERNOR_H_
+#define VIDEO_PLAYER_RESOURCE_GOVERNOR_H_
+
+#include <list>
+
+class VideoPlayer;
+
+// Keeps the number of players holding a decoder within a budget. When the
+// budget is exceeded, paused players are suspended in the order they were
+// last visible, offscreen players first. Playing players are never
+// suspended, so the budget may be exceeded temporarily.
+//
+// Players prepared by preload() are not counted until create() takes them
+// over. They also hold a decoder, but there are at most a few of them, and
+// the oldest is disposed when another one is preloaded, so the budget
+// leaves them out rather than suspending players in use to make room.
+class ResourceGovernor {
+ public:
+  ResourceGovernor() = default;
+  ~ResourceGovernor() = default;
+
+  // A budget of 0 or less means no limit.
+  void setDecoderBudget(int budget);
+  int getDecoderBudget() const { return decoder_budget_; }
+
+  void addPlayer(VideoPlayer *player);
+  void removePlayer(VideoPlayer *player);
+  void setVisible(VideoPlayer *player, bool is_visible);
+  // Marks |player| as about to be played so that it keeps or regains its
+  // decoder, suspending other players if needed.
+  void acquire(VideoPlayer *player);
+
+  int getActivePlayerCount() const;
+  int getSuspendedPlayerCount() const;
+
+ private:
+  struct Entry {
+    VideoPlayer *player;
+    bool is_visible;
+  };
+
+  std::list<Entry>::iterator find(VideoPlayer *player);
+  void moveToFront(std::list<Entry>::iterator iter);
+  void enforceBudget(VideoPlayer *keep);
+
+  int decoder_budget_ = 0;
+  // The most recently visible or used player first.
+  std::list<Entry> entries_;
+};
+
+#endif  // VIDEO_PLAYER_RESOURCE_GOVERNOR_H_
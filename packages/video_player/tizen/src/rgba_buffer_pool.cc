@@ -0,0 +1,35 @@
+#include "rgba_buffer_pool.h"
+
+RgbaBufferPool::~RgbaBufferPool() {
+  for (std::vector<uint8_t> *buffer : idle_buffers_) {
+    delete buffer;
+  }
+}
+
+std::vector<uint8_t> *RgbaBufferPool::acquire(size_t size) {
+  std::vector<uint8_t> *buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_buffers_.empty()) {
+      buffer = idle_buffers_.back();
+      idle_buffers_.pop_back();
+    }
+  }
+  if (!buffer) {
+    buffer = new std::vector<uint8_t>();
+  }
+  // A no-op unless the video size has changed.
+  buffer->resize(size);
+  return buffer;
+}
+
+void RgbaBufferPool::release(std::vector<uint8_t> *buffer) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_buffers_.size() < max_idle_buffers_) {
+      idle_buffers_.push_back(buffer);
+      return;
+    }
+  }
+  delete buffer;
+}
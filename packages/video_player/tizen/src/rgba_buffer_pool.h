@@ -0,0 +1,27 @@
+#ifndef VIDEO_PLAYER_RGBA_BUFFER_POOL_H_
+#define VIDEO_PLAYER_RGBA_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Recycles frame-sized pixel buffers between the decoder thread, which
+// fills them, and the raster thread, which releases them.
+class RgbaBufferPool {
+ public:
+  explicit RgbaBufferPool(size_t max_idle_buffers)
+      : max_idle_buffers_(max_idle_buffers) {}
+  ~RgbaBufferPool();
+
+  // Returns a buffer of exactly |size| bytes with unspecified content.
+  std::vector<uint8_t> *acquire(size_t size);
+  void release(std::vector<uint8_t> *buffer);
+
+ private:
+  std::mutex mutex_;
+  size_t max_idle_buffers_;
+  std::vector<std::vector<uint8_t> *> idle_buffers_;
+};
+
+#endif  // VIDEO_PLAYER_RGBA_BUFFER_POOL_H_
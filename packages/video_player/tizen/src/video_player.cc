@@ -3,10 +3,19 @@
 #include <flutter/event_stream_handler_functions.h>
 #include <flutter/standard_method_codec.h>
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
 
 #include "log.h"
 #include "video_player_error.h"
+#include "yuv_converter.h"
+
+// Interval in seconds between frame and network statistics events.
+#define STATS_INTERVAL 1.0
+// Interval in seconds between position samples while playing. The clock is
+// extrapolated in between.
+#define CLOCK_SAMPLE_INTERVAL 0.1
 
 static std::string RotationToString(player_display_rotation_e rotation) {
   std::string ret;
@@ -49,90 +58,199 @@ static std::string StateToString(player_state_e state) {
   return ret;
 }
 
-bool VideoPlayer::IsValidMediaPacket(media_packet_h media_packet) {
-  tbm_surface_h surface;
-  int ret = media_packet_get_tbm_surface(media_packet, &surface);
+bool VideoPlayer::ConvertFrame(media_packet_h packet, VideoFrame *frame) {
+  media_format_h format = nullptr;
+  int ret = media_packet_get_format(packet, &format);
   if (ret != MEDIA_PACKET_ERROR_NONE) {
-    LOG_ERROR("get tbm surface failed, error: %d", ret);
+    LOG_ERROR("[VideoPlayer.ConvertFrame] media_packet_get_format failed: %d",
+              ret);
+    return false;
+  }
+  media_format_mimetype_e mimetype;
+  int width = 0, height = 0, avg_bps = 0, max_bps = 0;
+  ret = media_format_get_video_info(format, &mimetype, &width, &height,
+                                    &avg_bps, &max_bps);
+  media_format_unref(format);
+  if (ret != MEDIA_FORMAT_ERROR_NONE || width <= 0 || height <= 0) {
+    LOG_ERROR("[VideoPlayer.ConvertFrame] media_format_get_video_info failed");
     return false;
   }
+
+  YuvImage image = {};
+  image.width = width;
+  image.height = height;
+  uint32_t plane_count = 0;
+  media_packet_get_number_of_video_planes(packet, &plane_count);
+  if (mimetype == MEDIA_FORMAT_NV12 && plane_count >= 2) {
+    image.format = YuvFormat::kNV12;
+  } else if ((mimetype == MEDIA_FORMAT_I420 || mimetype == MEDIA_FORMAT_YV12) &&
+             plane_count >= 3) {
+    image.format = YuvFormat::kI420;
+  } else {
+    LOG_ERROR("[VideoPlayer.ConvertFrame] unsupported format: %d", mimetype);
+    return false;
+  }
+  int image_planes = image.format == YuvFormat::kNV12 ? 2 : 3;
+  for (int i = 0; i < image_planes; i++) {
+    void *data = nullptr;
+    if (media_packet_get_video_plane_data_ptr(packet, i, &data) !=
+            MEDIA_PACKET_ERROR_NONE ||
+        media_packet_get_video_stride_width(packet, i, &image.strides[i]) !=
+            MEDIA_PACKET_ERROR_NONE) {
+      LOG_ERROR("[VideoPlayer.ConvertFrame] failed to get plane %d", i);
+      return false;
+    }
+    image.planes[i] = (const uint8_t *)data;
+  }
+  if (mimetype == MEDIA_FORMAT_YV12) {
+    std::swap(image.planes[1], image.planes[2]);
+    std::swap(image.strides[1], image.strides[2]);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  frame->pixels = rgba_buffer_pool_.acquire((size_t)width * height * 4);
+  frame->width = width;
+  frame->height = height;
+  ConvertYuvToRgba(image, frame->pixels->data(), width * 4);
+  conversion_time_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  converted_frames_++;
   return true;
 }
 
-FlutterDesktopGpuBuffer *VideoPlayer::ObtainGpuBuffer(size_t width,
-                                                      size_t height) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (prepared_media_packet_ && !IsValidMediaPacket(prepared_media_packet_)) {
-    media_packet_destroy(prepared_media_packet_);
-    prepared_media_packet_ = nullptr;
+void VideoPlayer::DestroyFrame(VideoFrame *frame) {
+  if (frame->packet) {
+    media_packet_destroy(frame->packet);
+  }
+  if (frame->pixels) {
+    rgba_buffer_pool_.release(frame->pixels);
+  }
+  delete frame;
+}
+
+void VideoPlayer::ClearFrames() {
+  frame_queue_.clear();
+  VideoFrame *preroll = preroll_frame_.exchange(nullptr);
+  if (preroll) {
+    DestroyFrame(preroll);
   }
-  if (current_media_packet_ && !IsValidMediaPacket(current_media_packet_)) {
-    media_packet_destroy(current_media_packet_);
-    current_media_packet_ = nullptr;
+}
+
+// Runs on the raster thread. The frame queue never blocks on the decoder
+// thread, and the clock is sampled elsewhere so that this never waits for
+// the player.
+VideoPlayer::VideoFrame *VideoPlayer::UpdateCurrentFrame() {
+  bool selected = false;
+  VideoFrame *frame = frame_queue_.update(
+      seek_serial_, clock_.get(std::chrono::steady_clock::now()), &selected);
+  if (selected) {
+    int64_t gap_start_us = gap_start_us_;
+    if (gap_start_us != 0 && frame->serial == gap_serial_) {
+      // The first frame of the next playlist item is presented.
+      int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+      last_gap_ms_ = (now_us - gap_start_us) / 1000;
+      gap_start_us_ = 0;
+    }
   }
-  if (!prepared_media_packet_ && !current_media_packet_) {
+  if (!frame) {
     LOG_ERROR("No vaild media packet");
     return nullptr;
   }
-  if (prepared_media_packet_ && !current_media_packet_) {
-    current_media_packet_ = prepared_media_packet_;
-    prepared_media_packet_ = nullptr;
+
+  // Ask for the next vsync while frames are pending so that each of them is
+  // selected at the refresh closest to its presentation time.
+  if (frame_queue_.hasPendingFrames() && is_playing_) {
+    texture_registrar_->MarkTextureFrameAvailable(texture_id_);
+  }
+  return frame;
+}
+
+FlutterDesktopGpuBuffer *VideoPlayer::ObtainGpuBuffer(size_t width,
+                                                      size_t height) {
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  if (is_disposed_) {
+    return nullptr;
+  }
+  VideoFrame *frame = UpdateCurrentFrame();
+  if (!frame) {
+    return nullptr;
   }
-  tbm_surface_h surface;
-  media_packet_get_tbm_surface(current_media_packet_, &surface);
-  flutter_desktop_gpu_buffer_->buffer = surface;
+  flutter_desktop_gpu_buffer_->buffer = frame->surface;
   flutter_desktop_gpu_buffer_->width = width;
   flutter_desktop_gpu_buffer_->height = height;
   return flutter_desktop_gpu_buffer_.get();
 }
 
-void VideoPlayer::Destruct(void *buffer) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (current_media_packet_) {
-    media_packet_destroy(current_media_packet_);
-    current_media_packet_ = nullptr;
+// The returned pixels stay valid until the next call, which is when the
+// engine has finished copying them.
+const FlutterDesktopPixelBuffer *VideoPlayer::ObtainPixelBuffer(
+    size_t width, size_t height) {
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  if (is_disposed_) {
+    return nullptr;
   }
+  VideoFrame *frame = UpdateCurrentFrame();
+  if (!frame) {
+    return nullptr;
+  }
+  flutter_desktop_pixel_buffer_->buffer = frame->pixels->data();
+  flutter_desktop_pixel_buffer_->width = frame->width;
+  flutter_desktop_pixel_buffer_->height = frame->height;
+  return flutter_desktop_pixel_buffer_.get();
+}
+
+void VideoPlayer::Destruct(void *buffer) {
+  // The current frame is kept so that it can be presented again, and is
+  // destroyed when a newer frame replaces it.
 }
 
 VideoPlayer::VideoPlayer(flutter::PluginRegistrar *plugin_registrar,
                          flutter::TextureRegistrar *texture_registrar,
-                         const std::string &uri, VideoPlayerOptions &options) {
+                         VideoPlayerOptions &options) {
   is_initialized_ = false;
   texture_registrar_ = texture_registrar;
+  use_software_rendering_ = options.getSoftwareRendering();
 
-  texture_variant_ =
-      std::make_unique<flutter::TextureVariant>(flutter::GpuBufferTexture(
-          [this](size_t width,
-                 size_t height) -> const FlutterDesktopGpuBuffer * {
-            return this->ObtainGpuBuffer(width, height);
-          },
-          [this](void *buffer) -> void { this->Destruct(buffer); }));
-  flutter_desktop_gpu_buffer_ = std::make_unique<FlutterDesktopGpuBuffer>();
+  if (use_software_rendering_) {
+    texture_variant_ =
+        std::make_unique<flutter::TextureVariant>(flutter::PixelBufferTexture(
+            [this](size_t width,
+                   size_t height) -> const FlutterDesktopPixelBuffer * {
+              return this->ObtainPixelBuffer(width, height);
+            }));
+    flutter_desktop_pixel_buffer_ =
+        std::make_unique<FlutterDesktopPixelBuffer>();
+  } else {
+    texture_variant_ =
+        std::make_unique<flutter::TextureVariant>(flutter::GpuBufferTexture(
+            [this](size_t width,
+                   size_t height) -> const FlutterDesktopGpuBuffer * {
+              return this->ObtainGpuBuffer(width, height);
+            },
+            [this](void *buffer) -> void { this->Destruct(buffer); }));
+    flutter_desktop_gpu_buffer_ = std::make_unique<FlutterDesktopGpuBuffer>();
+  }
 
   LOG_INFO("[VideoPlayer] register texture");
   texture_id_ = texture_registrar->RegisterTexture(texture_variant_.get());
 
   LOG_DEBUG("[VideoPlayer] call player_create to create player");
-  int ret = player_create(&player_);
+  player_h player = nullptr;
+  int ret = player_create(&player);
   if (ret != PLAYER_ERROR_NONE) {
     LOG_ERROR("[VideoPlayer] player_create failed: %s", get_error_message(ret));
     throw VideoPlayerError("player_create failed", get_error_message(ret));
   }
-
-  LOG_DEBUG("[VideoPlayer] call player_set_uri to set video path (%s)",
-            uri.c_str());
-  ret = player_set_uri(player_, uri.c_str());
-  if (ret != PLAYER_ERROR_NONE) {
-    player_destroy(player_);
-    LOG_ERROR("[VideoPlayer] player_set_uri failed: %s",
-              get_error_message(ret));
-    throw VideoPlayerError("player_set_uri failed", get_error_message(ret));
-  }
+  player_ = player;
+  decoder_contexts_[0] = {this, player};
 
   LOG_DEBUG(
       "[VideoPlayer] call player_set_media_packet_video_frame_decoded_cb");
   ret = player_set_media_packet_video_frame_decoded_cb(
-      player_, onVideoFrameDecoded, (void *)this);
+      player_, onVideoFrameDecoded, &decoder_contexts_[0]);
   if (ret != PLAYER_ERROR_NONE) {
     player_destroy(player_);
     LOG_ERROR(
@@ -184,16 +302,7 @@ VideoPlayer::VideoPlayer(flutter::PluginRegistrar *plugin_registrar,
                            get_error_message(ret));
   }
 
-  LOG_DEBUG("[VideoPlayer] call player_prepare_async");
-  ret = player_prepare_async(player_, onPrepared, (void *)this);
-  if (ret != PLAYER_ERROR_NONE) {
-    player_destroy(player_);
-    LOG_ERROR("[VideoPlayer] player_prepare_async failed: %s",
-              get_error_message(ret));
-    throw VideoPlayerError("player_prepare_async failed",
-                           get_error_message(ret));
-  }
-
+  self_ = std::make_shared<VideoPlayer *>(this);
   setupEventChannel(plugin_registrar->messenger());
 }
 
@@ -204,8 +313,105 @@ VideoPlayer::~VideoPlayer() {
 
 long VideoPlayer::getTextureId() { return texture_id_; }
 
+std::string VideoPlayer::getUri() const { return uri_; }
+
+void VideoPlayer::prepare(const std::string &uri,
+                          const StreamingOptions &streaming_options) {
+  LOG_DEBUG("[VideoPlayer.prepare] call player_set_uri to set video path (%s)",
+            uri.c_str());
+  int ret = player_set_uri(player_, uri.c_str());
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.prepare] player_set_uri failed: %s",
+              get_error_message(ret));
+    throw VideoPlayerError("player_set_uri failed", get_error_message(ret));
+  }
+
+  bool is_streaming = uri.find("://") != std::string::npos &&
+                      uri.compare(0, 7, "file://") != 0;
+  if (is_streaming && streaming_options.hasBufferingTime()) {
+    LOG_DEBUG("[VideoPlayer.prepare] buffering time: %d, rebuffering time: %d",
+              streaming_options.getBufferingTime(),
+              streaming_options.getRebufferingTime());
+    ret = player_set_streaming_buffering_time(
+        player_, streaming_options.getBufferingTime(),
+        streaming_options.getRebufferingTime());
+    if (ret != PLAYER_ERROR_NONE) {
+      LOG_ERROR(
+          "[VideoPlayer.prepare] player_set_streaming_buffering_time "
+          "failed: %s",
+          get_error_message(ret));
+    }
+  }
+  if (is_streaming && streaming_options.hasVariantLimit()) {
+    ret = player_set_max_adaptive_variant_limit(
+        player_, streaming_options.getMaxBitrate(),
+        streaming_options.getMaxWidth(), streaming_options.getMaxHeight());
+    if (ret != PLAYER_ERROR_NONE) {
+      LOG_ERROR(
+          "[VideoPlayer.prepare] player_set_max_adaptive_variant_limit "
+          "failed: %s",
+          get_error_message(ret));
+    }
+  }
+
+  prepareAsync();
+  uri_ = uri;
+  is_streaming_ = is_streaming;
+}
+
+void VideoPlayer::prepare(std::shared_ptr<MediaBuffer> buffer) {
+  LOG_DEBUG("[VideoPlayer.prepare] call player_set_memory_buffer (%zu bytes)",
+            buffer->getSize());
+  int ret = player_set_memory_buffer(player_, buffer->getData(),
+                                     (int)buffer->getSize());
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.prepare] player_set_memory_buffer failed: %s",
+              get_error_message(ret));
+    throw VideoPlayerError("player_set_memory_buffer failed",
+                           get_error_message(ret));
+  }
+
+  prepareAsync();
+  uri_ = buffer->getPath();
+  media_buffer_ = std::move(buffer);
+}
+
+void VideoPlayer::prepareAsync() {
+  LOG_DEBUG("[VideoPlayer.prepareAsync] call player_prepare_async");
+  int ret = player_prepare_async(player_, onPrepared, (void *)this);
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.prepareAsync] player_prepare_async failed: %s",
+              get_error_message(ret));
+    throw VideoPlayerError("player_prepare_async failed",
+                           get_error_message(ret));
+  }
+}
+
+void VideoPlayer::setAdaptiveVariantLimit(int max_bitrate, int max_width,
+                                          int max_height) {
+  LOG_DEBUG(
+      "[VideoPlayer.setAdaptiveVariantLimit] bitrate: %d, width: %d, "
+      "height: %d",
+      max_bitrate, max_width, max_height);
+  int ret = player_set_max_adaptive_variant_limit(player_, max_bitrate,
+                                                  max_width, max_height);
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR(
+        "[VideoPlayer.setAdaptiveVariantLimit] "
+        "player_set_max_adaptive_variant_limit failed: %s",
+        get_error_message(ret));
+    throw VideoPlayerError("player_set_max_adaptive_variant_limit failed",
+                           get_error_message(ret));
+  }
+}
+
 void VideoPlayer::play() {
   LOG_DEBUG("[VideoPlayer.play] start player");
+  if (isSuspended()) {
+    play_on_resume_ = true;
+    resume();
+    return;
+  }
   player_state_e state;
   int ret = player_get_state(player_, &state);
   if (ret == PLAYER_ERROR_NONE) {
@@ -222,10 +428,17 @@ void VideoPlayer::play() {
               get_error_message(ret));
     throw VideoPlayerError("player_start failed", get_error_message(ret));
   }
+  is_playing_ = true;
+  sampleClock();
+  startClockTimer();
 }
 
 void VideoPlayer::pause() {
   LOG_DEBUG("[VideoPlayer.pause] pause player");
+  if (isSuspended()) {
+    play_on_resume_ = false;
+    return;
+  }
   player_state_e state;
   int ret = player_get_state(player_, &state);
   if (ret == PLAYER_ERROR_NONE) {
@@ -242,20 +455,32 @@ void VideoPlayer::pause() {
               get_error_message(ret));
     throw VideoPlayerError("player_pause failed", get_error_message(ret));
   }
+  is_playing_ = false;
+  sampleClock();
 }
 
 void VideoPlayer::setLooping(bool is_looping) {
   LOG_DEBUG("[VideoPlayer.setLooping] isLooping: %d", is_looping);
-  int ret = player_set_looping(player_, is_looping);
+  is_looping_ = is_looping;
+  // A playlist loops by advancing to its first item instead.
+  int ret = player_set_looping(player_, is_looping && playlist_.size() <= 1);
   if (ret != PLAYER_ERROR_NONE) {
     LOG_ERROR("[VideoPlayer.setLooping] player_set_looping failed: %s",
               get_error_message(ret));
     throw VideoPlayerError("player_set_looping failed", get_error_message(ret));
   }
+  if (playlist_.size() > 1 && playlist_index_ + 1 == playlist_.size()) {
+    // Whether the first item follows the last one has changed.
+    prepareNextItem();
+  }
 }
 
 void VideoPlayer::setVolume(double volume) {
   LOG_DEBUG("[VideoPlayer.setVolume] volume: %f", volume);
+  volume_ = volume;
+  if (next_player_) {
+    player_set_volume(next_player_, volume, volume);
+  }
   int ret = player_set_volume(player_, volume, volume);
   if (ret != PLAYER_ERROR_NONE) {
     LOG_ERROR("[VideoPlayer.setVolume] player_set_volume failed: %s",
@@ -266,6 +491,11 @@ void VideoPlayer::setVolume(double volume) {
 
 void VideoPlayer::setPlaybackSpeed(double speed) {
   LOG_DEBUG("[VideoPlayer.setPlaybackSpeed] speed: %f", speed);
+  playback_speed_ = speed;
+  if (isSuspended()) {
+    // Applied when the player is restored.
+    return;
+  }
   int ret = player_set_playback_rate(player_, speed);
   if (ret != PLAYER_ERROR_NONE) {
     LOG_ERROR(
@@ -274,25 +504,83 @@ void VideoPlayer::setPlaybackSpeed(double speed) {
     throw VideoPlayerError("player_set_playback_rate failed",
                            get_error_message(ret));
   }
+  sampleClock();
 }
 
 void VideoPlayer::seekTo(int position,
                          const SeekCompletedCb &seek_completed_cb) {
   LOG_DEBUG("[VideoPlayer.seekTo] position: %d", position);
-  int ret =
-      player_set_play_position(player_, position, true, onSeekCompleted, this);
+  // The callback of a seek that is deferred or skipped, called once
+  // seek_mutex_ is released.
+  SeekCompletedCb finished_cb;
+  {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    if (isSuspended()) {
+      // Sought once restored. Held under seek_mutex_ so that a restore seek
+      // completing meanwhile sees the new position.
+      suspended_position_ = position;
+      finished_cb = seek_completed_cb;
+    } else if (!is_seeking_) {
+      startSeek(position, !is_scrubbing_, seek_completed_cb);
+      return;
+    } else {
+      // Only the latest target matters while a seek is in progress.
+      LOG_DEBUG("[VideoPlayer.seekTo] seeking, queue the position");
+      finished_cb = std::move(pending_seek_completed_cb_);
+      pending_seek_position_ = position;
+      pending_seek_completed_cb_ = seek_completed_cb;
+    }
+  }
+  if (finished_cb) {
+    finished_cb();
+  }
+}
+
+void VideoPlayer::setScrubbing(bool is_scrubbing) {
+  LOG_DEBUG("[VideoPlayer.setScrubbing] isScrubbing: %d", is_scrubbing);
+  std::lock_guard<std::mutex> lock(seek_mutex_);
+  is_scrubbing_ = is_scrubbing;
+  if (is_scrubbing || last_seek_position_ < 0 || last_seek_accurate_) {
+    return;
+  }
+  // Scrubbing ended on a key frame, so land precisely on the last target.
+  if (is_seeking_) {
+    if (pending_seek_position_ < 0) {
+      pending_seek_position_ = last_seek_position_;
+    }
+  } else {
+    startSeek(last_seek_position_, true, nullptr);
+  }
+}
+
+void VideoPlayer::startSeek(int position, bool accurate,
+                            const SeekCompletedCb &seek_completed_cb) {
+  LOG_DEBUG("[VideoPlayer.startSeek] position: %d, accurate: %d", position,
+            accurate);
+  // Frames decoded before the seek are discarded by the raster thread.
+  seek_serial_++;
+  int ret = player_set_play_position(player_, position, accurate,
+                                     onSeekCompleted, this);
   if (ret != PLAYER_ERROR_NONE) {
-    LOG_ERROR("[VideoPlayer.seekTo] player_set_play_position failed: %s",
+    LOG_ERROR("[VideoPlayer.startSeek] player_set_play_position failed: %s",
               get_error_message(ret));
     throw VideoPlayerError("player_set_play_position failed",
                            get_error_message(ret));
-  } else {
-    on_seek_completed_ = seek_completed_cb;
   }
+  // Frames decoded after the seek are due at the target until it completes.
+  clock_.update(position, false, playback_speed_,
+                std::chrono::steady_clock::now());
+  is_seeking_ = true;
+  on_seek_completed_ = seek_completed_cb;
+  last_seek_position_ = position;
+  last_seek_accurate_ = accurate;
 }
 
 int VideoPlayer::getPosition() {
   LOG_DEBUG("[VideoPlayer.getPosition] get video player position");
+  if (isSuspended()) {
+    return suspended_position_;
+  }
   int position;
   int ret = player_get_play_position(player_, &position);
   if (ret != PLAYER_ERROR_NONE) {
@@ -306,12 +594,261 @@ int VideoPlayer::getPosition() {
   return position;
 }
 
+bool VideoPlayer::suspend() {
+  if (isSuspended() || !is_initialized_ || playlist_.size() > 1) {
+    // The next playlist item is already holding a second decoder.
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    if (is_seeking_) {
+      // Seek callbacks would be lost while unprepared.
+      return false;
+    }
+  }
+
+  int position = 0;
+  player_get_play_position(player_, &position);
+  LOG_INFO("[VideoPlayer.suspend] suspend player at %d ms", position);
+  int ret = player_unprepare(player_);
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.suspend] player_unprepare failed: %s",
+              get_error_message(ret));
+    return false;
+  }
+  play_on_resume_ = is_playing_.load();
+  is_playing_ = false;
+  suspended_position_ = position;
+  is_suspended_ = true;
+  clock_.update(position, false, playback_speed_,
+                std::chrono::steady_clock::now());
+  // Drop frames still in flight. The frame on screen is kept so that the
+  // texture keeps showing the last picture.
+  seek_serial_++;
+  frame_queue_.dropPushed();
+  return true;
+}
+
+void VideoPlayer::resume() {
+  if (!is_suspended_) {
+    return;
+  }
+  LOG_INFO("[VideoPlayer.resume] resume player at %d ms",
+           suspended_position_.load());
+  is_suspended_ = false;
+  is_restoring_ = true;
+  try {
+    prepareAsync();
+  } catch (const VideoPlayerError &e) {
+    is_restoring_ = false;
+    is_suspended_ = true;
+    throw;
+  }
+}
+
+void VideoPlayer::setPlaylist(const std::vector<std::string> &uris) {
+  LOG_DEBUG("[VideoPlayer.setPlaylist] %zu items", uris.size());
+  if (!uris.empty() && media_buffer_ && media_buffer_->getPath().empty()) {
+    // The current media could not be prepared again when the playlist loops.
+    throw VideoPlayerError("Invalid argument",
+                           "Playlists cannot start with in-memory media.");
+  }
+  playlist_.clear();
+  playlist_.push_back(uri_);
+  playlist_.insert(playlist_.end(), uris.begin(), uris.end());
+  playlist_index_ = 0;
+  player_set_looping(player_, is_looping_ && playlist_.size() <= 1);
+  prepareNextItem();
+}
+
+player_h VideoPlayer::createNextPlayer() {
+  player_h player = nullptr;
+  int ret = player_create(&player);
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.createNextPlayer] player_create failed: %s",
+              get_error_message(ret));
+    throw VideoPlayerError("player_create failed", get_error_message(ret));
+  }
+  decoder_contexts_[1] = {this, player};
+  // Once swapped in, this player reports to the same callbacks as the first.
+  ret = player_set_media_packet_video_frame_decoded_cb(
+      player, onVideoFrameDecoded, &decoder_contexts_[1]);
+  if (ret == PLAYER_ERROR_NONE) {
+    ret = player_set_buffering_cb(player, onBuffering, (void *)this);
+  }
+  if (ret == PLAYER_ERROR_NONE) {
+    ret = player_set_completed_cb(player, onPlayCompleted, (void *)this);
+  }
+  if (ret == PLAYER_ERROR_NONE) {
+    ret = player_set_interrupted_cb(player, onInterrupted, (void *)this);
+  }
+  if (ret == PLAYER_ERROR_NONE) {
+    ret = player_set_error_cb(player, onErrorOccurred, (void *)this);
+  }
+  if (ret != PLAYER_ERROR_NONE) {
+    player_destroy(player);
+    LOG_ERROR("[VideoPlayer.createNextPlayer] failed to set callbacks: %s",
+              get_error_message(ret));
+    throw VideoPlayerError("Failed to set player callbacks",
+                           get_error_message(ret));
+  }
+  return player;
+}
+
+size_t VideoPlayer::getNextItemIndex() const {
+  if (playlist_.size() <= 1) {
+    return playlist_.size();
+  }
+  if (playlist_index_ + 1 < playlist_.size()) {
+    return playlist_index_ + 1;
+  }
+  return is_looping_ ? 0 : playlist_.size();
+}
+
+void VideoPlayer::prepareNextItem() {
+  has_next_item_ = false;
+  is_next_prepared_ = false;
+  is_advance_pending_ = false;
+  if (next_player_) {
+    player_unprepare(next_player_);
+  }
+  // Unprepared first so that no stale frame can arrive afterwards.
+  VideoFrame *preroll = preroll_frame_.exchange(nullptr);
+  if (preroll) {
+    DestroyFrame(preroll);
+  }
+
+  size_t index = getNextItemIndex();
+  if (index >= playlist_.size()) {
+    return;
+  }
+  if (!next_player_) {
+    next_player_ = createNextPlayer();
+  }
+  const std::string &uri = playlist_[index];
+  LOG_DEBUG("[VideoPlayer.prepareNextItem] prepare item %zu (%s)", index,
+            uri.c_str());
+  int ret = player_set_uri(next_player_, uri.c_str());
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.prepareNextItem] player_set_uri failed: %s",
+              get_error_message(ret));
+    throw VideoPlayerError("player_set_uri failed", get_error_message(ret));
+  }
+  player_set_volume(next_player_, volume_, volume_);
+  ret = player_prepare_async(next_player_, onNextPrepared, (void *)this);
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.prepareNextItem] player_prepare_async failed: %s",
+              get_error_message(ret));
+    throw VideoPlayerError("player_prepare_async failed",
+                           get_error_message(ret));
+  }
+  has_next_item_ = true;
+}
+
+void VideoPlayer::advancePlaylist() {
+  if (!is_next_prepared_) {
+    // onNextPrepared() calls this again.
+    is_advance_pending_ = true;
+    return;
+  }
+  LOG_DEBUG("[VideoPlayer.advancePlaylist] swap to the next item");
+  player_h finished = player_;
+  player_h next = next_player_;
+  int ret = player_start(next);
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR("[VideoPlayer.advancePlaylist] player_start failed: %s",
+              get_error_message(ret));
+    if (event_sink_) {
+      event_sink_->Error("player_start failed", get_error_message(ret));
+    }
+    return;
+  }
+  if (playback_speed_ != 1.0) {
+    player_set_playback_rate(next, playback_speed_);
+  }
+
+  // Frames still in flight from the finished item are discarded, and the
+  // preroll frame of the new item goes on screen first.
+  uint32_t serial = ++seek_serial_;
+  gap_serial_ = serial;
+  player_ = next;
+  next_player_ = finished;
+  sampleClock();
+  startClockTimer();
+  VideoFrame *preroll = preroll_frame_.exchange(nullptr);
+  if (preroll) {
+    preroll->serial = serial;
+    PushFrame(preroll);
+  }
+  is_playing_ = true;
+
+  playlist_index_ = getNextItemIndex();
+  uri_ = playlist_[playlist_index_];
+  player_get_duration(next, &duration_);
+  if (event_sink_) {
+    flutter::EncodableMap encodables = {
+        {flutter::EncodableValue("event"),
+         flutter::EncodableValue("playlistItemChanged")},
+        {flutter::EncodableValue("index"),
+         flutter::EncodableValue((int)playlist_index_)},
+        {flutter::EncodableValue("duration"),
+         flutter::EncodableValue(duration_)}};
+    flutter::EncodableValue eventValue(encodables);
+    LOG_INFO("[VideoPlayer.advancePlaylist] send playlistItemChanged event");
+    event_sink_->Success(eventValue);
+  }
+
+  try {
+    prepareNextItem();
+  } catch (const VideoPlayerError &e) {
+    // The current item keeps playing and completes normally.
+    if (event_sink_) {
+      event_sink_->Error(e.getCode(), e.getMessage());
+    }
+  }
+}
+
 void VideoPlayer::dispose() {
   LOG_DEBUG("[VideoPlayer.dispose] dispose video player");
   is_initialized_ = false;
+  is_playing_ = false;
   event_sink_ = nullptr;
   event_channel_->SetStreamHandler(nullptr);
 
+  if (stats_timer_) {
+    ecore_timer_del(stats_timer_);
+    stats_timer_ = nullptr;
+  }
+  if (clock_timer_) {
+    ecore_timer_del(clock_timer_);
+    clock_timer_ = nullptr;
+  }
+  if (self_) {
+    // Pending onAdvancePlaylist and onPlaybackRestored calls become no-ops.
+    *self_ = nullptr;
+  }
+
+  // The raster thread may be in a texture callback, which must be done with
+  // the frames before they are freed and the players destroyed.
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    is_disposed_ = true;
+    ClearFrames();
+  }
+  if (texture_registrar_) {
+    texture_registrar_->UnregisterTexture(texture_id_);
+  }
+
+  if (next_player_) {
+    player_unprepare(next_player_);
+    player_unset_media_packet_video_frame_decoded_cb(next_player_);
+    player_unset_buffering_cb(next_player_);
+    player_unset_completed_cb(next_player_);
+    player_unset_interrupted_cb(next_player_);
+    player_unset_error_cb(next_player_);
+    player_destroy(next_player_);
+    next_player_ = nullptr;
+  }
   if (player_) {
     player_unprepare(player_);
     player_unset_media_packet_video_frame_decoded_cb(player_);
@@ -322,21 +859,15 @@ void VideoPlayer::dispose() {
     player_destroy(player_);
     player_ = 0;
   }
+  // The player no longer reads from the buffer once it is destroyed.
+  media_buffer_ = nullptr;
 
-  if (current_media_packet_) {
-    media_packet_destroy(current_media_packet_);
-    current_media_packet_ = nullptr;
-  }
-
-  if (prepared_media_packet_) {
-    media_packet_destroy(prepared_media_packet_);
-    prepared_media_packet_ = nullptr;
-  }
-
-  if (texture_registrar_) {
-    texture_registrar_->UnregisterTexture(texture_id_);
-    texture_registrar_ = nullptr;
+  // Frames decoded until the players were destroyed.
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    ClearFrames();
   }
+  texture_registrar_ = nullptr;
 }
 
 void VideoPlayer::setupEventChannel(flutter::BinaryMessenger *messenger) {
@@ -358,6 +889,9 @@ void VideoPlayer::setupEventChannel(flutter::BinaryMessenger *messenger) {
             "[VideoPlayer.setupEventChannel] call listen of StreamHandler");
         event_sink_ = std::move(events);
         initialize();
+        if (!stats_timer_) {
+          stats_timer_ = ecore_timer_add(STATS_INTERVAL, onStatsTimer, this);
+        }
         return nullptr;
       },
       [&](const flutter::EncodableValue *arguments)
@@ -431,6 +965,7 @@ void VideoPlayer::sendInitialized() {
     }
 
     is_initialized_ = true;
+    duration_ = duration;
     flutter::EncodableMap encodables = {
         {flutter::EncodableValue("event"),
          flutter::EncodableValue("initialized")},
@@ -455,10 +990,10 @@ void VideoPlayer::sendBufferingStart() {
   }
 }
 
-void VideoPlayer::sendBufferingUpdate(int position) {
+void VideoPlayer::sendBufferingUpdate(int start, int end) {
   if (event_sink_) {
-    flutter::EncodableList range = {flutter::EncodableValue(0),
-                                    flutter::EncodableValue(position)};
+    flutter::EncodableList range = {flutter::EncodableValue(start),
+                                    flutter::EncodableValue(end)};
     flutter::EncodableList rangeList = {flutter::EncodableValue(range)};
     flutter::EncodableMap encodables = {
         {flutter::EncodableValue("event"),
@@ -482,27 +1017,313 @@ void VideoPlayer::sendBufferingEnd() {
   }
 }
 
+void VideoPlayer::sendFrameStats() {
+  uint64_t dropped_frames = frame_queue_.getDroppedFrames();
+  uint64_t duplicated_frames = frame_queue_.getDuplicatedFrames();
+  uint64_t converted_frames = converted_frames_;
+  uint64_t conversion_time_us = conversion_time_us_;
+  int64_t gap_ms = last_gap_ms_;
+  if (dropped_frames == reported_dropped_frames_ &&
+      duplicated_frames == reported_duplicated_frames_ &&
+      converted_frames == reported_converted_frames_ &&
+      gap_ms == reported_gap_ms_) {
+    return;
+  }
+  uint64_t new_conversions = converted_frames - reported_converted_frames_;
+  uint64_t new_conversion_time_us =
+      conversion_time_us - reported_conversion_time_us_;
+  reported_dropped_frames_ = dropped_frames;
+  reported_duplicated_frames_ = duplicated_frames;
+  reported_converted_frames_ = converted_frames;
+  reported_conversion_time_us_ = conversion_time_us;
+  bool has_new_gap = gap_ms != reported_gap_ms_;
+  reported_gap_ms_ = gap_ms;
+
+  if (event_sink_) {
+    flutter::EncodableMap encodables = {
+        {flutter::EncodableValue("event"),
+         flutter::EncodableValue("frameStats")},
+        {flutter::EncodableValue("droppedFrames"),
+         flutter::EncodableValue((int64_t)dropped_frames)},
+        {flutter::EncodableValue("duplicatedFrames"),
+         flutter::EncodableValue((int64_t)duplicated_frames)}};
+    if (new_conversions > 0) {
+      // The average YUV to RGBA conversion time since the last report.
+      encodables[flutter::EncodableValue("conversionTimeUs")] =
+          flutter::EncodableValue(
+              (int64_t)(new_conversion_time_us / new_conversions));
+    }
+    if (has_new_gap) {
+      // The time from the end of one playlist item until the first frame of
+      // the next one was presented.
+      encodables[flutter::EncodableValue("playlistGapMs")] =
+          flutter::EncodableValue(gap_ms);
+    }
+    flutter::EncodableValue eventValue(encodables);
+    LOG_DEBUG("[VideoPlayer.sendFrameStats] dropped: %llu, duplicated: %llu",
+              (unsigned long long)dropped_frames,
+              (unsigned long long)duplicated_frames);
+    event_sink_->Success(eventValue);
+  }
+}
+
+void VideoPlayer::updateNetworkStats() {
+  if (!is_initialized_ || !is_streaming_) {
+    return;
+  }
+
+  int start_percent, end_percent;
+  int ret = player_get_streaming_download_progress(player_, &start_percent,
+                                                   &end_percent);
+  if (ret != PLAYER_ERROR_NONE) {
+    LOG_ERROR(
+        "[VideoPlayer.updateNetworkStats] "
+        "player_get_streaming_download_progress failed: %s",
+        get_error_message(ret));
+    return;
+  }
+  int buffered_start = (int64_t)duration_ * start_percent / 100;
+  int buffered_end = (int64_t)duration_ * end_percent / 100;
+  if (buffered_start != buffered_start_ || buffered_end != buffered_end_) {
+    sendBufferingUpdate(buffered_start, buffered_end);
+  }
+
+  // The native player does not report the bytes it received, so the
+  // throughput is estimated from how much media time was buffered since the
+  // last sample, weighted by the bitrate of the stream. The first sample
+  // only sets the baseline.
+  auto now = std::chrono::steady_clock::now();
+  int64_t estimated_throughput = -1;
+  if (last_network_sample_ != std::chrono::steady_clock::time_point()) {
+    int64_t elapsed_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - last_network_sample_)
+            .count();
+    if (bitrate_ > 0 && elapsed_ms > 0 && buffered_start == buffered_start_ &&
+        buffered_end >= buffered_end_) {
+      estimated_throughput =
+          (int64_t)bitrate_ * (buffered_end - buffered_end_) / elapsed_ms;
+    }
+  }
+  last_network_sample_ = now;
+  buffered_start_ = buffered_start;
+  buffered_end_ = buffered_end;
+
+  int position;
+  if (estimated_throughput < 0 ||
+      player_get_play_position(player_, &position) != PLAYER_ERROR_NONE) {
+    return;
+  }
+  if (event_sink_) {
+    flutter::EncodableMap encodables = {
+        {flutter::EncodableValue("event"),
+         flutter::EncodableValue("networkStats")},
+        {flutter::EncodableValue("bitrate"), flutter::EncodableValue(bitrate_)},
+        {flutter::EncodableValue("estimatedThroughput"),
+         flutter::EncodableValue(estimated_throughput)},
+        {flutter::EncodableValue("bufferedAhead"),
+         flutter::EncodableValue(std::max(buffered_end - position, 0))}};
+    flutter::EncodableValue eventValue(encodables);
+    LOG_DEBUG(
+        "[VideoPlayer.updateNetworkStats] bitrate: %d, estimated "
+        "throughput: %lld bps",
+        bitrate_, (long long)estimated_throughput);
+    event_sink_->Success(eventValue);
+  }
+}
+
+Eina_Bool VideoPlayer::onStatsTimer(void *data) {
+  VideoPlayer *player = (VideoPlayer *)data;
+  player->sendFrameStats();
+  player->updateNetworkStats();
+  return ECORE_CALLBACK_RENEW;
+}
+
+void VideoPlayer::sampleClock() {
+  int position;
+  if (player_get_play_position(player_, &position) == PLAYER_ERROR_NONE) {
+    clock_.update(position, is_playing_, playback_speed_,
+                  std::chrono::steady_clock::now());
+  }
+}
+
+void VideoPlayer::startClockTimer() {
+  if (!clock_timer_) {
+    clock_timer_ = ecore_timer_add(CLOCK_SAMPLE_INTERVAL, onClockTimer, this);
+  }
+}
+
+Eina_Bool VideoPlayer::onClockTimer(void *data) {
+  VideoPlayer *player = (VideoPlayer *)data;
+  // One last sample once stopped, e.g. by completion or an interruption.
+  player->sampleClock();
+  if (!player->is_playing_) {
+    player->clock_timer_ = nullptr;
+    return ECORE_CALLBACK_CANCEL;
+  }
+  return ECORE_CALLBACK_RENEW;
+}
+
 void VideoPlayer::onPrepared(void *data) {
   VideoPlayer *player = (VideoPlayer *)data;
   LOG_DEBUG("[VideoPlayer.onPrepared] video player is prepared");
 
+  int fps, video_bitrate = 0;
+  player_get_video_stream_info(player->player_, &fps, &video_bitrate);
+  int sample_rate, channels, audio_bitrate = 0;
+  player_get_audio_stream_info(player->player_, &sample_rate, &channels,
+                               &audio_bitrate);
+  player->bitrate_ = video_bitrate + audio_bitrate;
+  LOG_DEBUG("[VideoPlayer.onPrepared] bitrate: %d", player->bitrate_);
+  player->sampleClock();
+
+  if (player->is_restoring_) {
+    if (player->playback_speed_ != 1.0) {
+      player_set_playback_rate(player->player_, player->playback_speed_);
+    }
+    int position;
+    {
+      std::lock_guard<std::mutex> lock(player->seek_mutex_);
+      position = player->suspended_position_;
+      player->restore_seek_position_ = position;
+    }
+    int ret = player_set_play_position(player->player_, position, true,
+                                       onRestoreSeekCompleted, player);
+    if (ret != PLAYER_ERROR_NONE) {
+      LOG_ERROR("[VideoPlayer.onPrepared] player_set_play_position failed: %s",
+                get_error_message(ret));
+      onRestoreSeekCompleted(player);
+    }
+    return;
+  }
+
   if (!player->is_initialized_) {
     player->sendInitialized();
   }
 }
 
+void VideoPlayer::onNextPrepared(void *data) {
+  VideoPlayer *player = (VideoPlayer *)data;
+  LOG_DEBUG("[VideoPlayer.onNextPrepared] next playlist item is prepared");
+  player->is_next_prepared_ = true;
+  if (player->is_advance_pending_.exchange(false)) {
+    ecore_main_loop_thread_safe_call_async(
+        onAdvancePlaylist, new std::shared_ptr<VideoPlayer *>(player->self_));
+  }
+}
+
+void VideoPlayer::onAdvancePlaylist(void *data) {
+  auto *self = (std::shared_ptr<VideoPlayer *> *)data;
+  VideoPlayer *player = **self;
+  delete self;
+  if (player) {
+    player->advancePlaylist();
+  }
+}
+
 void VideoPlayer::onBuffering(int percent, void *data) {
   // percent isn't used for video size, it's the used storage of buffer
+  VideoPlayer *player = (VideoPlayer *)data;
   LOG_DEBUG("[VideoPlayer.onBuffering] percent: %d", percent);
+
+  if (percent < 100 && !player->is_buffering_) {
+    player->is_buffering_ = true;
+    player->sendBufferingStart();
+  } else if (percent >= 100 && player->is_buffering_) {
+    player->is_buffering_ = false;
+    player->sendBufferingEnd();
+  }
+}
+
+void VideoPlayer::onRestoreSeekCompleted(void *data) {
+  VideoPlayer *player = (VideoPlayer *)data;
+  {
+    std::lock_guard<std::mutex> lock(player->seek_mutex_);
+    int position = player->suspended_position_;
+    if (position != player->restore_seek_position_) {
+      // seekTo() was called after the restore seek had been issued.
+      LOG_DEBUG("[VideoPlayer.onRestoreSeekCompleted] seek again to %d",
+                position);
+      player->restore_seek_position_ = position;
+      // Frames decoded at the previous position are discarded.
+      player->seek_serial_++;
+      player->clock_.update(position, false, player->playback_speed_,
+                            std::chrono::steady_clock::now());
+      int ret = player_set_play_position(player->player_, position, true,
+                                         onRestoreSeekCompleted, player);
+      if (ret == PLAYER_ERROR_NONE) {
+        return;
+      }
+      LOG_ERROR(
+          "[VideoPlayer.onRestoreSeekCompleted] player_set_play_position "
+          "failed: %s",
+          get_error_message(ret));
+    }
+    player->is_restoring_ = false;
+  }
+  LOG_DEBUG("[VideoPlayer.onRestoreSeekCompleted] player is restored");
+  player->sampleClock();
+  if (player->play_on_resume_) {
+    player->play_on_resume_ = false;
+    int ret = player_start(player->player_);
+    if (ret != PLAYER_ERROR_NONE) {
+      LOG_ERROR("[VideoPlayer.onRestoreSeekCompleted] player_start failed: %s",
+                get_error_message(ret));
+      return;
+    }
+    player->is_playing_ = true;
+    player->sampleClock();
+    ecore_main_loop_thread_safe_call_async(
+        onPlaybackRestored, new std::shared_ptr<VideoPlayer *>(player->self_));
+  }
+}
+
+void VideoPlayer::onPlaybackRestored(void *data) {
+  auto *self = (std::shared_ptr<VideoPlayer *> *)data;
+  VideoPlayer *player = **self;
+  delete self;
+  if (!player) {
+    return;
+  }
+  player->startClockTimer();
+  if (player->on_playback_restored_) {
+    player->on_playback_restored_();
+  }
 }
 
 void VideoPlayer::onSeekCompleted(void *data) {
   VideoPlayer *player = (VideoPlayer *)data;
   LOG_DEBUG("[VideoPlayer.onSeekCompleted] completed to seek");
+  player->sampleClock();
 
-  if (player->on_seek_completed_) {
-    player->on_seek_completed_();
+  SeekCompletedCb completed_cb;
+  SeekCompletedCb failed_cb;
+  {
+    std::lock_guard<std::mutex> lock(player->seek_mutex_);
+    completed_cb = std::move(player->on_seek_completed_);
     player->on_seek_completed_ = nullptr;
+    player->is_seeking_ = false;
+
+    if (player->pending_seek_position_ >= 0) {
+      int position = player->pending_seek_position_;
+      SeekCompletedCb pending_cb =
+          std::move(player->pending_seek_completed_cb_);
+      player->pending_seek_position_ = -1;
+      player->pending_seek_completed_cb_ = nullptr;
+      try {
+        player->startSeek(position, !player->is_scrubbing_, pending_cb);
+      } catch (const VideoPlayerError &e) {
+        // Do not leave the caller waiting for a seek that never starts.
+        failed_cb = std::move(pending_cb);
+      }
+    }
+  }
+
+  if (completed_cb) {
+    completed_cb();
+  }
+  if (failed_cb) {
+    failed_cb();
   }
 }
 
@@ -510,6 +1331,23 @@ void VideoPlayer::onPlayCompleted(void *data) {
   VideoPlayer *player = (VideoPlayer *)data;
   LOG_DEBUG("[VideoPlayer.onPlayCompleted] completed to playe video");
 
+  if (player->has_next_item_) {
+    player->gap_start_us_ =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    // Whichever of this and onNextPrepared() comes last advances.
+    player->is_advance_pending_ = true;
+    if (player->is_next_prepared_ &&
+        player->is_advance_pending_.exchange(false)) {
+      ecore_main_loop_thread_safe_call_async(
+          onAdvancePlaylist, new std::shared_ptr<VideoPlayer *>(player->self_));
+    } else {
+      LOG_INFO("[VideoPlayer.onPlayCompleted] next item is not prepared yet");
+    }
+    return;
+  }
+
   if (player->event_sink_) {
     flutter::EncodableMap encodables = {{flutter::EncodableValue("event"),
                                          flutter::EncodableValue("completed")}};
@@ -525,6 +1363,7 @@ void VideoPlayer::onPlayCompleted(void *data) {
 void VideoPlayer::onInterrupted(player_interrupted_code_e code, void *data) {
   VideoPlayer *player = (VideoPlayer *)data;
   LOG_DEBUG("[VideoPlayer.onInterrupted] interrupted code: %d", code);
+  player->is_playing_ = false;
 
   if (player->event_sink_) {
     LOG_INFO("[VideoPlayer.onInterrupted] send error event");
@@ -545,14 +1384,53 @@ void VideoPlayer::onErrorOccurred(int code, void *data) {
 }
 
 void VideoPlayer::onVideoFrameDecoded(media_packet_h packet, void *data) {
-  VideoPlayer *player = (VideoPlayer *)data;
-  std::lock_guard<std::mutex> lock(player->mutex_);
-  if (player->prepared_media_packet_) {
-    LOG_INFO("prepared packet not null, store new");
-    media_packet_destroy(player->prepared_media_packet_);
-    player->prepared_media_packet_ = packet;
+  DecoderContext *context = (DecoderContext *)data;
+  VideoPlayer *player = context->owner;
+  uint64_t pts = 0;
+  media_packet_get_pts(packet, &pts);
+
+  VideoFrame *frame = new VideoFrame();
+  if (player->use_software_rendering_) {
+    bool converted = player->ConvertFrame(packet, frame);
+    // The pixels have been copied, so the decoder can reuse the packet.
+    media_packet_destroy(packet);
+    if (!converted) {
+      delete frame;
+      return;
+    }
+  } else {
+    tbm_surface_h surface;
+    int ret = media_packet_get_tbm_surface(packet, &surface);
+    if (ret != MEDIA_PACKET_ERROR_NONE) {
+      LOG_ERROR(
+          "get tbm surface failed, error: %d. Software rendering may be "
+          "required on this device.",
+          ret);
+      media_packet_destroy(packet);
+      delete frame;
+      return;
+    }
+    frame->packet = packet;
+    frame->surface = surface;
+  }
+  frame->pts = pts / 1000000;  // ns to ms
+  frame->serial = player->seek_serial_;
+
+  if (context->handle != player->player_) {
+    // Decoded by the next playlist item while it is being prepared. Only the
+    // latest such frame is kept until the players swap.
+    VideoFrame *replaced = player->preroll_frame_.exchange(frame);
+    if (replaced) {
+      player->DestroyFrame(replaced);
+    }
     return;
   }
-  player->prepared_media_packet_ = packet;
-  player->texture_registrar_->MarkTextureFrameAvailable(player->texture_id_);
+  player->PushFrame(frame);
+}
+
+void VideoPlayer::PushFrame(VideoFrame *frame) {
+  if (frame_queue_.push(frame)) {
+    LOG_INFO("raster thread is behind, drop an unconsumed frame");
+  }
+  texture_registrar_->MarkTextureFrameAvailable(texture_id_);
 }
@@ -1,59 +1,166 @@
 #ifndef VIDEO_PLAYER_H_
 #define VIDEO_PLAYER_H_
 
+#include <Ecore.h>
 #include <flutter/encodable_value.h>
 #include <flutter/event_channel.h>
 #include <flutter/plugin_registrar.h>
 #include <player.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
+#include "frame_queue.h"
+#include "media_buffer.h"
+#include "media_clock.h"
+#include "rgba_buffer_pool.h"
 #include "video_player_options.h"
 
 using SeekCompletedCb = std::function<void()>;
+using PlaybackRestoredCb = std::function<void()>;
 
 class VideoPlayer {
  public:
   VideoPlayer(flutter::PluginRegistrar *plugin_registrar,
               flutter::TextureRegistrar *texture_registrar,
-              const std::string &uri, VideoPlayerOptions &options);
+              VideoPlayerOptions &options);
   ~VideoPlayer();
 
   long getTextureId();
+  std::string getUri() const;
+  // Sets the media source and starts preparing the player asynchronously.
+  // The player must not have been prepared before.
+  void prepare(const std::string &uri,
+               const StreamingOptions &streaming_options);
+  // Same as above, but plays from memory. |buffer| is kept alive until the
+  // player is disposed.
+  void prepare(std::shared_ptr<MediaBuffer> buffer);
   void play();
   void pause();
   void setLooping(bool is_looping);
   void setVolume(double volume);
   void setPlaybackSpeed(double speed);
+  // Limits the variants an adaptive stream can switch to. Pass -1 for no
+  // limit.
+  void setAdaptiveVariantLimit(int max_bitrate, int max_width,
+                               int max_height);
+  // Seeks issued while another seek is in progress are coalesced, and only
+  // the latest one is performed. The callbacks of skipped seeks are called
+  // right away.
   void seekTo(int position,
               const SeekCompletedCb &seek_completed_cb);  // milliseconds
+  // While scrubbing, seeks go to the nearest key frame. A final accurate
+  // seek to the last position is performed when scrubbing ends.
+  void setScrubbing(bool is_scrubbing);
   int getPosition();                                      // milliseconds
+  bool isPlaying() const { return is_playing_; }
+  // Unprepares the player to release its decoder, remembering the position
+  // and playback speed. Returns false if the player cannot be suspended now.
+  bool suspend();
+  // Prepares a suspended player again and restores its state. Playback
+  // starts once restored if play() has been called meanwhile.
+  void resume();
+  bool isSuspended() const { return is_suspended_ || is_restoring_; }
+  // Called on the main thread when a resumed player starts playing, which
+  // happens after play() returns if play() resumed it.
+  void setPlaybackRestoredCallback(const PlaybackRestoredCb &callback) {
+    on_playback_restored_ = callback;
+  }
+  // Plays |uris| after the current media without a gap. The next item is
+  // prepared on a second native player while the current one plays, and
+  // the players swap on completion. With looping enabled, the playlist
+  // restarts from the current media after the last item.
+  void setPlaylist(const std::vector<std::string> &uris);
   void dispose();
 
  private:
   void initialize();
+  void prepareAsync();
+  // Creates the second native player used to prepare playlist items.
+  player_h createNextPlayer();
+  // Prepares the playlist item after the current one on next_player_.
+  void prepareNextItem();
+  // Starts next_player_ and makes it the current player. Runs on the main
+  // thread.
+  void advancePlaylist();
+  size_t getNextItemIndex() const;
   void setupEventChannel(flutter::BinaryMessenger *messenger);
   void sendInitialized();
+  // Must be called with seek_mutex_ held.
+  void startSeek(int position, bool accurate,
+                 const SeekCompletedCb &seek_completed_cb);
   void sendBufferingStart();
-  void sendBufferingUpdate(int position);  // milliseconds
+  void sendBufferingUpdate(int start, int end);  // milliseconds
   void sendBufferingEnd();
+  void sendFrameStats();
+  // Samples the position of player_ into clock_. Never called on the raster
+  // thread.
+  void sampleClock();
+  // Keeps sampling the position until playback stops.
+  void startClockTimer();
+  // Reports the buffered range and an estimate of the network throughput of
+  // streaming sources.
+  void updateNetworkStats();
   FlutterDesktopGpuBuffer *ObtainGpuBuffer(size_t width, size_t height);
+  const FlutterDesktopPixelBuffer *ObtainPixelBuffer(size_t width,
+                                                     size_t height);
   void Destruct(void *buffer);
-  bool IsValidMediaPacket(media_packet_h media_packet);
+
+  // The user data of the frame decoded callback, identifying the native
+  // player that decoded the frame.
+  struct DecoderContext {
+    VideoPlayer *owner;
+    player_h handle;
+  };
+
+  struct VideoFrame {
+    media_packet_h packet = nullptr;
+    tbm_surface_h surface = nullptr;
+    // RGBA pixels of a software-rendered frame, from rgba_buffer_pool_.
+    std::vector<uint8_t> *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int64_t pts = 0;  // milliseconds
+    uint32_t serial = 0;
+  };
+
+  // Converts the YUV planes of |packet| into pooled RGBA pixels of |frame|.
+  // Runs on the decoder thread.
+  bool ConvertFrame(media_packet_h packet, VideoFrame *frame);
+  // Hands |frame| over to the raster thread.
+  void PushFrame(VideoFrame *frame);
+  void DestroyFrame(VideoFrame *frame);
+  // Returns the frame to present now.
+  VideoFrame *UpdateCurrentFrame();
+  void ClearFrames();
 
   static void onPrepared(void *data);
   static void onBuffering(int percent, void *data);
   static void onSeekCompleted(void *data);
+  static void onNextPrepared(void *data);
+  static void onAdvancePlaylist(void *data);
+  static void onRestoreSeekCompleted(void *data);
+  static void onPlaybackRestored(void *data);
   static void onPlayCompleted(void *data);
   static void onInterrupted(player_interrupted_code_e code, void *data);
   static void onErrorOccurred(int code, void *data);
   static void onVideoFrameDecoded(media_packet_h packet, void *data);
+  static Eina_Bool onStatsTimer(void *data);
+  static Eina_Bool onClockTimer(void *data);
 
   bool is_initialized_;
-  player_h player_;
+  // Swapped on the main thread when the playlist advances, and read by the
+  // decoder thread.
+  std::atomic<player_h> player_{nullptr};
+  std::string uri_;
+  std::shared_ptr<MediaBuffer> media_buffer_;
   std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>>
       event_channel_;
   std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> event_sink_;
@@ -61,10 +168,80 @@ class VideoPlayer {
   flutter::TextureRegistrar *texture_registrar_;
   std::unique_ptr<flutter::TextureVariant> texture_variant_;
   std::unique_ptr<FlutterDesktopGpuBuffer> flutter_desktop_gpu_buffer_;
-  std::mutex mutex_;
+  std::unique_ptr<FlutterDesktopPixelBuffer> flutter_desktop_pixel_buffer_;
+  bool use_software_rendering_ = false;
+  // Enough buffers for the frame slots, the queue and the frame on screen.
+  RgbaBufferPool rgba_buffer_pool_{
+      FrameQueue<VideoFrame>::kMaxQueuedFrames * 2 + 1};
+  std::mutex seek_mutex_;
+  bool is_seeking_ = false;
+  bool is_scrubbing_ = false;
   SeekCompletedCb on_seek_completed_;
-  media_packet_h prepared_media_packet_ = nullptr;
-  media_packet_h current_media_packet_ = nullptr;
+  int pending_seek_position_ = -1;
+  SeekCompletedCb pending_seek_completed_cb_;
+  int last_seek_position_ = -1;
+  bool last_seek_accurate_ = true;
+  std::atomic<uint32_t> seek_serial_{0};
+  // The clock frames are presented by.
+  MediaClock clock_;
+  Ecore_Timer *clock_timer_ = nullptr;
+  // Held by the texture callbacks on the raster thread, and by dispose() to
+  // free the frames below.
+  std::mutex frame_mutex_;
+  bool is_disposed_ = false;
+  // Filled by the decoder thread. Other than push() and dropPushed(), only
+  // used with frame_mutex_ held.
+  FrameQueue<VideoFrame> frame_queue_{
+      [this](VideoFrame *frame) { DestroyFrame(frame); }};
+  std::atomic<bool> is_playing_{false};
+  uint64_t reported_dropped_frames_ = 0;
+  uint64_t reported_duplicated_frames_ = 0;
+  std::atomic<uint64_t> converted_frames_{0};
+  std::atomic<uint64_t> conversion_time_us_{0};
+  uint64_t reported_converted_frames_ = 0;
+  uint64_t reported_conversion_time_us_ = 0;
+  Ecore_Timer *stats_timer_ = nullptr;
+  bool is_suspended_ = false;
+  // Set from resume() until the position has been restored.
+  std::atomic<bool> is_restoring_{false};
+  std::atomic<bool> play_on_resume_{false};
+  std::atomic<int> suspended_position_{0};  // milliseconds
+  // The position the restore seek was issued with. Guarded by seek_mutex_,
+  // like the writes of suspended_position_ while restoring.
+  int restore_seek_position_ = 0;  // milliseconds
+  PlaybackRestoredCb on_playback_restored_;
+  double playback_speed_ = 1.0;
+  double volume_ = 1.0;
+  bool is_looping_ = false;
+  // The current media followed by the items passed to setPlaylist().
+  std::vector<std::string> playlist_;
+  size_t playlist_index_ = 0;
+  player_h next_player_ = nullptr;
+  std::array<DecoderContext, 2> decoder_contexts_{};
+  std::atomic<bool> has_next_item_{false};
+  std::atomic<bool> is_next_prepared_{false};
+  // Set when the current item completed before the next one was prepared.
+  std::atomic<bool> is_advance_pending_{false};
+  // The latest frame decoded by next_player_ before it starts, shown as
+  // soon as the players swap.
+  std::atomic<VideoFrame *> preroll_frame_{nullptr};
+  // When the last item completed, until the first frame of the next item
+  // is presented.
+  std::atomic<int64_t> gap_start_us_{0};
+  std::atomic<uint32_t> gap_serial_{0};
+  std::atomic<int64_t> last_gap_ms_{-1};
+  int64_t reported_gap_ms_ = -1;
+  // Cleared on dispose so that pending main loop calls can tell that the
+  // player is gone.
+  std::shared_ptr<VideoPlayer *> self_;
+  bool is_streaming_ = false;
+  std::atomic<bool> is_buffering_{false};
+  int duration_ = 0;        // milliseconds
+  int bitrate_ = 0;         // bits per second
+  int buffered_start_ = 0;  // milliseconds
+  int buffered_end_ = 0;    // milliseconds
+  // When the buffered range was last sampled, or the epoch if never.
+  std::chrono::steady_clock::time_point last_network_sample_;
 };
 
 #endif  // VIDEO_PLAYER_H_
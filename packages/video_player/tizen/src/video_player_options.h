@@ -1,9 +1,13 @@
 #ifndef VIDEO_PLAYER_OPTIONS_H_
 #define VIDEO_PLAYER_OPTIONS_H_
 
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
 class VideoPlayerOptions {
  public:
-  VideoPlayerOptions() : mixWithOthers_(true) {}
+  VideoPlayerOptions() : mixWithOthers_(true), softwareRendering_(false) {}
   ~VideoPlayerOptions() = default;
 
   VideoPlayerOptions(const VideoPlayerOptions &other) = default;
@@ -11,9 +15,75 @@ class VideoPlayerOptions {
 
   void setMixWithOthers(bool mixWithOthers) { mixWithOthers_ = mixWithOthers; }
   bool getMixWithOthers() const { return mixWithOthers_; }
+  // Converts decoded frames to RGBA on the CPU and renders them through a
+  // pixel buffer texture, for devices without tbm surface support.
+  void setSoftwareRendering(bool softwareRendering) {
+    softwareRendering_ = softwareRendering;
+  }
+  bool getSoftwareRendering() const { return softwareRendering_; }
 
  private:
   bool mixWithOthers_;
+  bool softwareRendering_;
+};
+
+// Options for adaptive streaming sources (HLS/DASH). They are passed in the
+// format hint of a create message as semicolon separated key=value pairs
+// following the format name, e.g. "hls;maxBitrate=800000;maxHeight=720".
+// Bitrates are in bits per second and times in milliseconds. A value of -1
+// means no limit or the platform default.
+class StreamingOptions {
+ public:
+  StreamingOptions() = default;
+  ~StreamingOptions() = default;
+
+  StreamingOptions(const StreamingOptions &other) = default;
+  StreamingOptions &operator=(const StreamingOptions &other) = default;
+
+  static StreamingOptions fromFormatHint(const std::string &formatHint) {
+    StreamingOptions options;
+    std::stringstream stream(formatHint);
+    std::string item;
+    while (std::getline(stream, item, ';')) {
+      size_t pos = item.find('=');
+      if (pos == std::string::npos) {
+        continue;
+      }
+      std::string key = item.substr(0, pos);
+      int value = std::atoi(item.substr(pos + 1).c_str());
+      if (key == "maxBitrate") {
+        options.maxBitrate_ = value;
+      } else if (key == "maxWidth") {
+        options.maxWidth_ = value;
+      } else if (key == "maxHeight") {
+        options.maxHeight_ = value;
+      } else if (key == "bufferingTime") {
+        options.bufferingTime_ = value;
+      } else if (key == "rebufferingTime") {
+        options.rebufferingTime_ = value;
+      }
+    }
+    return options;
+  }
+
+  int getMaxBitrate() const { return maxBitrate_; }
+  int getMaxWidth() const { return maxWidth_; }
+  int getMaxHeight() const { return maxHeight_; }
+  int getBufferingTime() const { return bufferingTime_; }
+  int getRebufferingTime() const { return rebufferingTime_; }
+  bool hasVariantLimit() const {
+    return maxBitrate_ >= 0 || maxWidth_ >= 0 || maxHeight_ >= 0;
+  }
+  bool hasBufferingTime() const {
+    return bufferingTime_ >= 0 || rebufferingTime_ >= 0;
+  }
+
+ private:
+  int maxBitrate_ = -1;
+  int maxWidth_ = -1;
+  int maxHeight_ = -1;
+  int bufferingTime_ = -1;
+  int rebufferingTime_ = -1;
 };
 
 #endif  // VIDEO_PLAYER_OPTIONS_H_
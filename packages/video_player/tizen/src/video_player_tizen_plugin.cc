@@ -1,22 +1,36 @@
 #include "video_player_tizen_plugin.h"
 
+#include <Ecore.h>
 #include <app_common.h>
 #include <flutter/event_channel.h>
 #include <flutter/event_stream_handler_functions.h>
 #include <flutter/plugin_registrar.h>
 #include <flutter/standard_method_codec.h>
 
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "flutter_texture_registrar.h"
+#include "frame_extractor.h"
 #include "log.h"
+#include "media_buffer.h"
 #include "message.h"
+#include "resource_governor.h"
 #include "video_player.h"
 #include "video_player_error.h"
 #include "video_player_options.h"
 
+// The number of created but unprepared players kept ready for create().
+#define IDLE_PLAYER_POOL_SIZE 2
+// The maximum number of players prepared ahead of time by preload().
+#define MAX_PRELOADED_PLAYERS 3
+// The default interval of position updates in milliseconds. It matches the
+// polling interval of the Dart controller.
+#define DEFAULT_POSITION_UPDATE_INTERVAL 500
+
 class VideoPlayerTizenPlugin : public flutter::Plugin, public VideoPlayerApi {
  public:
   static void RegisterWithRegistrar(
@@ -29,25 +43,83 @@ class VideoPlayerTizenPlugin : public flutter::Plugin, public VideoPlayerApi {
 
   virtual void initialize() override;
   virtual TextureMessage create(const CreateMessage &createMsg) override;
+  virtual void preload(const CreateMessage &createMsg) override;
   virtual void dispose(const TextureMessage &textureMsg) override;
   virtual void setLooping(const LoopingMessage &loopingMsg) override;
   virtual void setVolume(const VolumeMessage &volumeMsg) override;
   virtual void setPlaybackSpeed(const PlaybackSpeedMessage &speedMsg) override;
+  virtual void setAdaptiveVariantLimit(
+      const AdaptiveVariantLimitMessage &limitMsg) override;
   virtual void play(const TextureMessage &textureMsg) override;
   virtual void pause(const TextureMessage &textureMsg) override;
   virtual PositionMessage position(const TextureMessage &textureMsg) override;
   virtual void seekTo(const PositionMessage &positionMsg,
                       const SeekCompletedCb &onSeekCompleted) override;
+  virtual void setScrubbing(const ScrubbingMessage &scrubbingMsg) override;
+  virtual void setPositionUpdateInterval(
+      const PositionUpdateIntervalMessage &intervalMsg) override;
+  virtual void setVisibility(const VisibilityMessage &visibilityMsg) override;
+  virtual void setPlaylist(const PlaylistMessage &playlistMsg) override;
+  virtual void setDecoderBudget(const DecoderBudgetMessage &budgetMsg) override;
+  virtual ResourceUsageMessage resourceUsage() override;
+  virtual void extractFrames(const ExtractFramesMessage &extractMsg,
+                             const ExtractFramesCompletedCb &onCompleted,
+                             const ExtractFramesFailedCb &onFailed) override;
   virtual void setMixWithOthers(
       const MixWithOthersMessage &mixWithOthersMsg) override;
 
  private:
+  std::string getUri(const CreateMessage &createMsg);
+  void prepare(VideoPlayer *player, const CreateMessage &createMsg,
+               const std::string &uri);
+  std::shared_ptr<MediaBuffer> mapFile(const std::string &uri);
+  std::unique_ptr<VideoPlayer> obtainPlayer(const CreateMessage &createMsg);
+  std::unique_ptr<VideoPlayer> obtainIdlePlayer();
+  void scheduleIdlePlayerRefill();
+  static void refillIdlePlayers(void *data);
   void disposeAllPlayers();
+  void setupPositionChannel(flutter::BinaryMessenger *messenger);
+  // Starts or stops the position timer depending on whether anyone listens
+  // and any player is playing.
+  void updatePositionTimer();
+  static Eina_Bool onPositionTimer(void *data);
 
   flutter::PluginRegistrar *pluginRegistrar_;
   flutter::TextureRegistrar *textureRegistrar_;
   VideoPlayerOptions options_;
   std::map<long, std::unique_ptr<VideoPlayer>> videoPlayers_;
+  // Players that have been created but not prepared with any media yet.
+  std::vector<std::unique_ptr<VideoPlayer>> idlePlayers_;
+  // A player prepared by preload(), and the source it was prepared with.
+  struct PreloadedPlayer {
+    std::string uri;
+    std::string formatHint;
+    bool memoryMapped;
+    std::unique_ptr<VideoPlayer> player;
+
+    // Whether the player was prepared the way |createMsg| asks for. The
+    // format hint carries the streaming options.
+    bool matches(const CreateMessage &createMsg,
+                 const std::string &createUri) const {
+      return uri == createUri && formatHint == createMsg.getFormatHint() &&
+             memoryMapped == createMsg.getMemoryMapped();
+    }
+  };
+  // Players prepared by preload(), the oldest first. They are outside the
+  // decoder budget of governor_ until create() takes them over.
+  std::list<PreloadedPlayer> preloadedPlayers_;
+  Ecore_Job *refillJob_ = nullptr;
+  // Mappings are shared by all players of the same file and released with
+  // the last of them.
+  std::map<std::string, std::weak_ptr<MediaBuffer>> mappedFiles_;
+  // Positions of all playing players are sent in one event per tick.
+  std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>>
+      positionChannel_;
+  std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> positionSink_;
+  long positionUpdateInterval_ = DEFAULT_POSITION_UPDATE_INTERVAL;
+  Ecore_Timer *positionTimer_ = nullptr;
+  FrameExtractor frameExtractor_;
+  ResourceGovernor governor_;
 };
 
 // static
@@ -64,34 +136,186 @@ VideoPlayerTizenPlugin::VideoPlayerTizenPlugin(
     flutter::TextureRegistrar *textureRegistrar)
     : pluginRegistrar_(pluginRegistrar), textureRegistrar_(textureRegistrar) {
   VideoPlayerApi::setup(pluginRegistrar->messenger(), this);
+  setupPositionChannel(pluginRegistrar->messenger());
 }
 
-VideoPlayerTizenPlugin::~VideoPlayerTizenPlugin() { disposeAllPlayers(); }
+VideoPlayerTizenPlugin::~VideoPlayerTizenPlugin() {
+  if (positionTimer_) {
+    ecore_timer_del(positionTimer_);
+    positionTimer_ = nullptr;
+  }
+  if (refillJob_) {
+    ecore_job_del(refillJob_);
+    refillJob_ = nullptr;
+  }
+  disposeAllPlayers();
+  idlePlayers_.clear();
+}
 
 void VideoPlayerTizenPlugin::disposeAllPlayers() {
   LOG_DEBUG("[VideoPlayerTizenPlugin.disposeAllPlayers] player count: %d",
             videoPlayers_.size());
   auto iter = videoPlayers_.begin();
   while (iter != videoPlayers_.end()) {
+    governor_.removePlayer(iter->second.get());
     iter->second->dispose();
     iter++;
   }
   videoPlayers_.clear();
+
+  for (auto &preloaded : preloadedPlayers_) {
+    preloaded.player->dispose();
+  }
+  preloadedPlayers_.clear();
+}
+
+std::unique_ptr<VideoPlayer> VideoPlayerTizenPlugin::obtainPlayer(
+    const CreateMessage &createMsg) {
+  if (!createMsg.getSoftwareRendering()) {
+    return obtainIdlePlayer();
+  }
+  // The texture type is fixed when a player is created, so software-rendered
+  // players are not pooled.
+  VideoPlayerOptions options = options_;
+  options.setSoftwareRendering(true);
+  return std::make_unique<VideoPlayer>(pluginRegistrar_, textureRegistrar_,
+                                       options);
+}
+
+std::unique_ptr<VideoPlayer> VideoPlayerTizenPlugin::obtainIdlePlayer() {
+  if (idlePlayers_.empty()) {
+    return std::make_unique<VideoPlayer>(pluginRegistrar_, textureRegistrar_,
+                                         options_);
+  }
+  auto player = std::move(idlePlayers_.back());
+  idlePlayers_.pop_back();
+  return player;
+}
+
+void VideoPlayerTizenPlugin::scheduleIdlePlayerRefill() {
+  if (!refillJob_ && idlePlayers_.size() < IDLE_PLAYER_POOL_SIZE) {
+    refillJob_ = ecore_job_add(refillIdlePlayers, this);
+  }
+}
+
+void VideoPlayerTizenPlugin::refillIdlePlayers(void *data) {
+  VideoPlayerTizenPlugin *plugin = (VideoPlayerTizenPlugin *)data;
+  plugin->refillJob_ = nullptr;
+  while (plugin->idlePlayers_.size() < IDLE_PLAYER_POOL_SIZE) {
+    try {
+      plugin->idlePlayers_.push_back(std::make_unique<VideoPlayer>(
+          plugin->pluginRegistrar_, plugin->textureRegistrar_,
+          plugin->options_));
+    } catch (const VideoPlayerError &e) {
+      LOG_ERROR(
+          "[VideoPlayerTizenPlugin.refillIdlePlayers] failed to create "
+          "player: %s",
+          e.getMessage().c_str());
+      break;
+    }
+  }
+  LOG_DEBUG("[VideoPlayerTizenPlugin.refillIdlePlayers] idle players: %d",
+            plugin->idlePlayers_.size());
+}
+
+void VideoPlayerTizenPlugin::setupPositionChannel(
+    flutter::BinaryMessenger *messenger) {
+  positionChannel_ =
+      std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+          messenger, "flutter.io/videoPlayer/positionUpdates",
+          &flutter::StandardMethodCodec::GetInstance());
+  auto handler = std::make_unique<
+      flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+      [this](const flutter::EncodableValue *arguments,
+             std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>
+                 &&events)
+          -> std::unique_ptr<
+              flutter::StreamHandlerError<flutter::EncodableValue>> {
+        LOG_DEBUG("[VideoPlayerTizenPlugin.setupPositionChannel] listen");
+        positionSink_ = std::move(events);
+        updatePositionTimer();
+        return nullptr;
+      },
+      [this](const flutter::EncodableValue *arguments)
+          -> std::unique_ptr<
+              flutter::StreamHandlerError<flutter::EncodableValue>> {
+        LOG_DEBUG("[VideoPlayerTizenPlugin.setupPositionChannel] cancel");
+        positionSink_ = nullptr;
+        updatePositionTimer();
+        return nullptr;
+      });
+  positionChannel_->SetStreamHandler(std::move(handler));
+}
+
+void VideoPlayerTizenPlugin::updatePositionTimer() {
+  bool isAnyPlaying = false;
+  for (const auto &pair : videoPlayers_) {
+    if (pair.second->isPlaying()) {
+      isAnyPlaying = true;
+      break;
+    }
+  }
+
+  bool shouldRun = positionSink_ && positionUpdateInterval_ > 0 && isAnyPlaying;
+  if (shouldRun && !positionTimer_) {
+    positionTimer_ = ecore_timer_add(positionUpdateInterval_ / 1000.0,
+                                     onPositionTimer, this);
+    if (!positionTimer_) {
+      LOG_ERROR(
+          "[VideoPlayerTizenPlugin.updatePositionTimer] failed to add timer");
+    }
+  } else if (!shouldRun && positionTimer_) {
+    ecore_timer_del(positionTimer_);
+    positionTimer_ = nullptr;
+  }
+}
+
+Eina_Bool VideoPlayerTizenPlugin::onPositionTimer(void *data) {
+  VideoPlayerTizenPlugin *plugin = (VideoPlayerTizenPlugin *)data;
+  flutter::EncodableMap positions;
+  for (const auto &pair : plugin->videoPlayers_) {
+    if (!pair.second->isPlaying()) {
+      continue;
+    }
+    try {
+      positions[flutter::EncodableValue((int64_t)pair.first)] =
+          flutter::EncodableValue((int64_t)pair.second->getPosition());
+    } catch (const VideoPlayerError &e) {
+      LOG_ERROR("[VideoPlayerTizenPlugin.onPositionTimer] textureId %ld: %s",
+                pair.first, e.getMessage().c_str());
+    }
+  }
+
+  if (positions.empty()) {
+    // All players have stopped since the last tick. The timer is started
+    // again by the next play().
+    plugin->positionTimer_ = nullptr;
+    return ECORE_CALLBACK_CANCEL;
+  }
+
+  flutter::EncodableMap event = {
+      {flutter::EncodableValue("event"),
+       flutter::EncodableValue("positionUpdates")},
+      {flutter::EncodableValue("positions"),
+       flutter::EncodableValue(positions)}};
+  plugin->positionSink_->Success(flutter::EncodableValue(event));
+  return ECORE_CALLBACK_RENEW;
 }
 
 void VideoPlayerTizenPlugin::initialize() {
   LOG_DEBUG("[VideoPlayerTizenPlugin.initialize] init ");
   disposeAllPlayers();
+  updatePositionTimer();
 }
 
-TextureMessage VideoPlayerTizenPlugin::create(const CreateMessage &createMsg) {
-  LOG_DEBUG("[VideoPlayerTizenPlugin.create] asset: %s",
+std::string VideoPlayerTizenPlugin::getUri(const CreateMessage &createMsg) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.getUri] asset: %s",
             createMsg.getAsset().c_str());
-  LOG_DEBUG("[VideoPlayerTizenPlugin.create] uri: %s",
+  LOG_DEBUG("[VideoPlayerTizenPlugin.getUri] uri: %s",
             createMsg.getUri().c_str());
-  LOG_DEBUG("[VideoPlayerTizenPlugin.create] packageName: %s",
+  LOG_DEBUG("[VideoPlayerTizenPlugin.getUri] packageName: %s",
             createMsg.getPackageName().c_str());
-  LOG_DEBUG("[VideoPlayerTizenPlugin.create] formatHint: %s",
+  LOG_DEBUG("[VideoPlayerTizenPlugin.getUri] formatHint: %s",
             createMsg.getFormatHint().c_str());
 
   std::string uri;
@@ -104,17 +328,88 @@ TextureMessage VideoPlayerTizenPlugin::create(const CreateMessage &createMsg) {
       free(resPath);
     } else {
       LOG_DEBUG(
-          "[VideoPlayerTizenPlugin.create] failed to get resource path "
+          "[VideoPlayerTizenPlugin.getUri] failed to get resource path "
           "of package");
       throw VideoPlayerError("Internal error", "Failed to get resource path.");
     }
   }
-  LOG_DEBUG("[VideoPlayerTizenPlugin.create] uri of video player: %s",
+  LOG_DEBUG("[VideoPlayerTizenPlugin.getUri] uri of video player: %s",
             uri.c_str());
+  return uri;
+}
+
+void VideoPlayerTizenPlugin::prepare(VideoPlayer *player,
+                                     const CreateMessage &createMsg,
+                                     const std::string &uri) {
+  if (createMsg.getMemoryMapped()) {
+    player->prepare(mapFile(uri));
+  } else {
+    player->prepare(
+        uri, StreamingOptions::fromFormatHint(createMsg.getFormatHint()));
+  }
+}
+
+std::shared_ptr<MediaBuffer> VideoPlayerTizenPlugin::mapFile(
+    const std::string &uri) {
+  std::string path = uri;
+  if (path.compare(0, 7, "file://") == 0) {
+    path = path.substr(7);
+  } else if (path.find("://") != std::string::npos) {
+    throw VideoPlayerError("Invalid argument",
+                           "Only local files can be memory-mapped.");
+  }
+
+  auto iter = mappedFiles_.find(path);
+  if (iter != mappedFiles_.end()) {
+    std::shared_ptr<MediaBuffer> buffer = iter->second.lock();
+    if (buffer) {
+      LOG_DEBUG("[VideoPlayerTizenPlugin.mapFile] share mapping of %s",
+                path.c_str());
+      return buffer;
+    }
+  }
+
+  // Drop entries of mappings that have been released.
+  for (auto entry = mappedFiles_.begin(); entry != mappedFiles_.end();) {
+    if (entry->second.expired()) {
+      entry = mappedFiles_.erase(entry);
+    } else {
+      entry++;
+    }
+  }
+  std::shared_ptr<MediaBuffer> buffer = MediaBuffer::mapFile(path);
+  mappedFiles_[path] = buffer;
+  return buffer;
+}
+
+TextureMessage VideoPlayerTizenPlugin::create(const CreateMessage &createMsg) {
+  std::unique_ptr<VideoPlayer> player;
+  if (createMsg.getBytes()) {
+    LOG_DEBUG("[VideoPlayerTizenPlugin.create] play from memory");
+    player = obtainPlayer(createMsg);
+    player->prepare(MediaBuffer::fromBytes(createMsg.getBytes()));
+  } else {
+    std::string uri = getUri(createMsg);
+    for (auto iter = preloadedPlayers_.begin();
+         iter != preloadedPlayers_.end(); iter++) {
+      if (!createMsg.getSoftwareRendering() && iter->matches(createMsg, uri)) {
+        LOG_DEBUG("[VideoPlayerTizenPlugin.create] use preloaded player");
+        player = std::move(iter->player);
+        preloadedPlayers_.erase(iter);
+        break;
+      }
+    }
+    if (!player) {
+      player = obtainPlayer(createMsg);
+      prepare(player.get(), createMsg, uri);
+    }
+  }
+  scheduleIdlePlayerRefill();
 
-  auto player = std::make_unique<VideoPlayer>(pluginRegistrar_,
-                                              textureRegistrar_, uri, options_);
   long textureId = player->getTextureId();
+  // A suspended player starts playing only once it has been restored.
+  player->setPlaybackRestoredCallback([this]() { updatePositionTimer(); });
+  governor_.addPlayer(player.get());
   videoPlayers_[textureId] = std::move(player);
 
   TextureMessage result;
@@ -122,14 +417,37 @@ TextureMessage VideoPlayerTizenPlugin::create(const CreateMessage &createMsg) {
   return result;
 }
 
+void VideoPlayerTizenPlugin::preload(const CreateMessage &createMsg) {
+  std::string uri = getUri(createMsg);
+  for (const auto &preloaded : preloadedPlayers_) {
+    if (preloaded.matches(createMsg, uri)) {
+      LOG_DEBUG("[VideoPlayerTizenPlugin.preload] already preloaded");
+      return;
+    }
+  }
+
+  auto player = obtainIdlePlayer();
+  prepare(player.get(), createMsg, uri);
+  preloadedPlayers_.push_back({uri, createMsg.getFormatHint(),
+                               createMsg.getMemoryMapped(), std::move(player)});
+  if (preloadedPlayers_.size() > MAX_PRELOADED_PLAYERS) {
+    LOG_DEBUG("[VideoPlayerTizenPlugin.preload] evict the oldest player");
+    preloadedPlayers_.front().player->dispose();
+    preloadedPlayers_.pop_front();
+  }
+  scheduleIdlePlayerRefill();
+}
+
 void VideoPlayerTizenPlugin::dispose(const TextureMessage &textureMsg) {
   LOG_DEBUG("[VideoPlayerTizenPlugin.dispose] textureId: %ld",
             textureMsg.getTextureId());
 
   auto iter = videoPlayers_.find(textureMsg.getTextureId());
   if (iter != videoPlayers_.end()) {
+    governor_.removePlayer(iter->second.get());
     iter->second->dispose();
     videoPlayers_.erase(iter);
+    updatePositionTimer();
   }
 }
 
@@ -170,13 +488,28 @@ void VideoPlayerTizenPlugin::setPlaybackSpeed(
   }
 }
 
+void VideoPlayerTizenPlugin::setAdaptiveVariantLimit(
+    const AdaptiveVariantLimitMessage &limitMsg) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setAdaptiveVariantLimit] textureId: %ld",
+            limitMsg.getTextureId());
+
+  auto iter = videoPlayers_.find(limitMsg.getTextureId());
+  if (iter != videoPlayers_.end()) {
+    iter->second->setAdaptiveVariantLimit(limitMsg.getMaxBitrate(),
+                                          limitMsg.getMaxWidth(),
+                                          limitMsg.getMaxHeight());
+  }
+}
+
 void VideoPlayerTizenPlugin::play(const TextureMessage &textureMsg) {
   LOG_DEBUG("[VideoPlayerTizenPlugin.play] textureId: %ld",
             textureMsg.getTextureId());
 
   auto iter = videoPlayers_.find(textureMsg.getTextureId());
   if (iter != videoPlayers_.end()) {
+    governor_.acquire(iter->second.get());
     iter->second->play();
+    updatePositionTimer();
   }
 }
 
@@ -187,6 +520,7 @@ void VideoPlayerTizenPlugin::pause(const TextureMessage &textureMsg) {
   auto iter = videoPlayers_.find(textureMsg.getTextureId());
   if (iter != videoPlayers_.end()) {
     iter->second->pause();
+    updatePositionTimer();
   }
 }
 
@@ -217,6 +551,129 @@ void VideoPlayerTizenPlugin::seekTo(const PositionMessage &positionMsg,
   }
 }
 
+void VideoPlayerTizenPlugin::setScrubbing(
+    const ScrubbingMessage &scrubbingMsg) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setScrubbing] textureId: %ld",
+            scrubbingMsg.getTextureId());
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setScrubbing] isScrubbing: %d",
+            scrubbingMsg.getIsScrubbing());
+
+  auto iter = videoPlayers_.find(scrubbingMsg.getTextureId());
+  if (iter != videoPlayers_.end()) {
+    iter->second->setScrubbing(scrubbingMsg.getIsScrubbing());
+  }
+}
+
+void VideoPlayerTizenPlugin::setPositionUpdateInterval(
+    const PositionUpdateIntervalMessage &intervalMsg) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setPositionUpdateInterval] interval: %ld",
+            intervalMsg.getInterval());
+  if (intervalMsg.getInterval() < 0) {
+    throw VideoPlayerError("Invalid argument",
+                           "The interval must not be negative.");
+  }
+
+  positionUpdateInterval_ = intervalMsg.getInterval();
+  if (positionTimer_) {
+    // Restart the timer with the new interval.
+    ecore_timer_del(positionTimer_);
+    positionTimer_ = nullptr;
+  }
+  updatePositionTimer();
+}
+
+void VideoPlayerTizenPlugin::setVisibility(
+    const VisibilityMessage &visibilityMsg) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setVisibility] textureId: %ld",
+            visibilityMsg.getTextureId());
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setVisibility] isVisible: %d",
+            visibilityMsg.getIsVisible());
+
+  auto iter = videoPlayers_.find(visibilityMsg.getTextureId());
+  if (iter != videoPlayers_.end()) {
+    governor_.setVisible(iter->second.get(), visibilityMsg.getIsVisible());
+  }
+}
+
+void VideoPlayerTizenPlugin::setPlaylist(const PlaylistMessage &playlistMsg) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setPlaylist] textureId: %ld",
+            playlistMsg.getTextureId());
+
+  auto iter = videoPlayers_.find(playlistMsg.getTextureId());
+  if (iter != videoPlayers_.end()) {
+    std::vector<std::string> uris;
+    for (const CreateMessage &item : playlistMsg.getItems()) {
+      uris.push_back(getUri(item));
+    }
+    iter->second->setPlaylist(uris);
+  }
+}
+
+void VideoPlayerTizenPlugin::setDecoderBudget(
+    const DecoderBudgetMessage &budgetMsg) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.setDecoderBudget] budget: %ld",
+            budgetMsg.getBudget());
+  governor_.setDecoderBudget(budgetMsg.getBudget());
+}
+
+ResourceUsageMessage VideoPlayerTizenPlugin::resourceUsage() {
+  ResourceUsageMessage result;
+  result.setDecoderBudget(governor_.getDecoderBudget());
+  result.setActivePlayers(governor_.getActivePlayerCount());
+  result.setSuspendedPlayers(governor_.getSuspendedPlayerCount());
+  return result;
+}
+
+void VideoPlayerTizenPlugin::extractFrames(
+    const ExtractFramesMessage &extractMsg,
+    const ExtractFramesCompletedCb &onCompleted,
+    const ExtractFramesFailedCb &onFailed) {
+  LOG_DEBUG("[VideoPlayerTizenPlugin.extractFrames] format: %s",
+            extractMsg.getFormat().c_str());
+
+  ThumbnailFormat format;
+  if (extractMsg.getFormat().empty() || extractMsg.getFormat() == "sprite") {
+    format = ThumbnailFormat::kSprite;
+  } else if (extractMsg.getFormat() == "jpeg") {
+    format = ThumbnailFormat::kJpeg;
+  } else if (extractMsg.getFormat() == "png") {
+    format = ThumbnailFormat::kPng;
+  } else {
+    throw VideoPlayerError("Invalid argument",
+                           "Unknown format: " + extractMsg.getFormat());
+  }
+
+  CreateMessage source;
+  source.setAsset(extractMsg.getAsset());
+  source.setUri(extractMsg.getUri());
+  source.setPackageName(extractMsg.getPackageName());
+  frameExtractor_.extract(
+      getUri(source), extractMsg.getTimestamps(), extractMsg.getWidth(),
+      extractMsg.getHeight(), format,
+      [onCompleted](const Thumbnails &thumbnails) {
+        flutter::EncodableMap result = {
+            {flutter::EncodableValue("width"),
+             flutter::EncodableValue(thumbnails.width)},
+            {flutter::EncodableValue("height"),
+             flutter::EncodableValue(thumbnails.height)}};
+        if (thumbnails.columns > 0) {
+          result[flutter::EncodableValue("columns")] =
+              flutter::EncodableValue(thumbnails.columns);
+          result[flutter::EncodableValue("sprite")] =
+              flutter::EncodableValue(thumbnails.sprite);
+        } else {
+          flutter::EncodableList images;
+          for (const auto &image : thumbnails.images) {
+            images.push_back(flutter::EncodableValue(image));
+          }
+          result[flutter::EncodableValue("images")] =
+              flutter::EncodableValue(images);
+        }
+        onCompleted(flutter::EncodableValue(result));
+      },
+      onFailed);
+}
+
 void VideoPlayerTizenPlugin::setMixWithOthers(
     const MixWithOthersMessage &mixWithOthersMsg) {
   LOG_DEBUG("[VideoPlayerTizenPlugin.setMixWithOthers] mixWithOthers: %d",
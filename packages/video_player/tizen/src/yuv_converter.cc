@@ -0,0 +1,182 @@
+#include "yuv_converter.h"
+
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2 1
+#endif
+
+// BT.601 limited range coefficients scaled by 64, small enough for 16-bit
+// lanes:
+//   R = (74 * (Y - 16) + 102 * (V - 128) + 32) >> 6
+//   G = (74 * (Y - 16) - 25 * (U - 128) - 52 * (V - 128) + 32) >> 6
+//   B = (74 * (Y - 16) + 129 * (U - 128) + 32) >> 6
+// Intermediate sums can exceed the 16-bit range only where the result
+// saturates to 255 anyway, so the SIMD kernels use saturating adds.
+#define COEF_Y 74
+#define COEF_RV 102
+#define COEF_GU 25
+#define COEF_GV 52
+#define COEF_BU 129
+
+static inline uint8_t Clamp(int value) {
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// Converts pixels [start, width) of a row. |u| and |v| point to the chroma
+// of the row and advance by |uv_step| per chroma sample.
+static void ConvertRowScalar(const uint8_t *y, const uint8_t *u,
+                             const uint8_t *v, int uv_step, uint8_t *dst,
+                             int start, int width) {
+  for (int x = start; x < width; x++) {
+    int c = COEF_Y * (y[x] - 16) + 32;
+    int d = u[(x / 2) * uv_step] - 128;
+    int e = v[(x / 2) * uv_step] - 128;
+    uint8_t *pixel = dst + x * 4;
+    pixel[0] = Clamp((c + COEF_RV * e) >> 6);
+    pixel[1] = Clamp((c - COEF_GU * d - COEF_GV * e) >> 6);
+    pixel[2] = Clamp((c + COEF_BU * d) >> 6);
+    pixel[3] = 0xff;
+  }
+}
+
+#if defined(USE_NEON)
+// Converts 16 pixels per iteration. Returns the number of pixels converted.
+static int ConvertRowSimd(const uint8_t *y, const uint8_t *u,
+                          const uint8_t *v, int uv_step, uint8_t *dst,
+                          int width) {
+  const uint8x8_t bias_y = vdup_n_u8(16);
+  const uint8x8_t bias_uv = vdup_n_u8(128);
+  const uint8x8_t alpha = vdup_n_u8(0xff);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x8_t u8, v8;
+    if (uv_step == 2) {
+      // NV12: |v| is |u| + 1 within the interleaved plane.
+      uint8x8x2_t uv = vld2_u8(u + x);
+      u8 = uv.val[0];
+      v8 = uv.val[1];
+    } else {
+      u8 = vld1_u8(u + x / 2);
+      v8 = vld1_u8(v + x / 2);
+    }
+    int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(u8, bias_uv));
+    int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(v8, bias_uv));
+    int16x8_t rv = vmulq_n_s16(e, COEF_RV);
+    int16x8_t guv = vnegq_s16(
+        vaddq_s16(vmulq_n_s16(d, COEF_GU), vmulq_n_s16(e, COEF_GV)));
+    int16x8_t bu = vmulq_n_s16(d, COEF_BU);
+    // Each chroma sample covers two horizontal pixels.
+    int16x8x2_t rv2 = vzipq_s16(rv, rv);
+    int16x8x2_t guv2 = vzipq_s16(guv, guv);
+    int16x8x2_t bu2 = vzipq_s16(bu, bu);
+
+    uint8x16_t y16 = vld1q_u8(y + x);
+    uint8x8_t halves[2] = {vget_low_u8(y16), vget_high_u8(y16)};
+    for (int i = 0; i < 2; i++) {
+      int16x8_t c = vmulq_n_s16(
+          vreinterpretq_s16_u16(vsubl_u8(halves[i], bias_y)), COEF_Y);
+      uint8x8x4_t rgba;
+      // vqrshrun rounds, saturates to [0, 255] and narrows.
+      rgba.val[0] = vqrshrun_n_s16(vqaddq_s16(c, rv2.val[i]), 6);
+      rgba.val[1] = vqrshrun_n_s16(vqaddq_s16(c, guv2.val[i]), 6);
+      rgba.val[2] = vqrshrun_n_s16(vqaddq_s16(c, bu2.val[i]), 6);
+      rgba.val[3] = alpha;
+      vst4_u8(dst + (x + i * 8) * 4, rgba);
+    }
+  }
+  return x;
+}
+#elif defined(USE_SSE2)
+// Converts 8 pixels per iteration. Returns the number of pixels converted.
+static int ConvertRowSimd(const uint8_t *y, const uint8_t *u,
+                          const uint8_t *v, int uv_step, uint8_t *dst,
+                          int width) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias_y = _mm_set1_epi16(16);
+  const __m128i bias_uv = _mm_set1_epi16(128);
+  const __m128i rounding = _mm_set1_epi16(32);
+  const __m128i coef_y = _mm_set1_epi16(COEF_Y);
+  const __m128i coef_rv = _mm_set1_epi16(COEF_RV);
+  const __m128i coef_gu = _mm_set1_epi16(COEF_GU);
+  const __m128i coef_gv = _mm_set1_epi16(COEF_GV);
+  const __m128i coef_bu = _mm_set1_epi16(COEF_BU);
+  const __m128i alpha = _mm_set1_epi8((char)0xff);
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m128i d, e;
+    if (uv_step == 2) {
+      // NV12: 4 UV pairs widened to u0 v0 u1 v1 ... and split by lane.
+      __m128i uv =
+          _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(u + x)), zero);
+      d = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)),
+                              _MM_SHUFFLE(2, 2, 0, 0));
+      e = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)),
+                              _MM_SHUFFLE(3, 3, 1, 1));
+    } else {
+      int32_t u_bytes, v_bytes;
+      memcpy(&u_bytes, u + x / 2, sizeof(u_bytes));
+      memcpy(&v_bytes, v + x / 2, sizeof(v_bytes));
+      // Widen and duplicate each chroma sample for two pixels.
+      d = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u_bytes), zero);
+      d = _mm_unpacklo_epi16(d, d);
+      e = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v_bytes), zero);
+      e = _mm_unpacklo_epi16(e, e);
+    }
+    d = _mm_sub_epi16(d, bias_uv);
+    e = _mm_sub_epi16(e, bias_uv);
+
+    __m128i c =
+        _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(y + x)), zero);
+    c = _mm_adds_epi16(_mm_mullo_epi16(_mm_sub_epi16(c, bias_y), coef_y),
+                       rounding);
+
+    __m128i r = _mm_adds_epi16(c, _mm_mullo_epi16(e, coef_rv));
+    __m128i g = _mm_subs_epi16(
+        c, _mm_adds_epi16(_mm_mullo_epi16(d, coef_gu),
+                          _mm_mullo_epi16(e, coef_gv)));
+    __m128i b = _mm_adds_epi16(c, _mm_mullo_epi16(d, coef_bu));
+    r = _mm_packus_epi16(_mm_srai_epi16(r, 6), zero);
+    g = _mm_packus_epi16(_mm_srai_epi16(g, 6), zero);
+    b = _mm_packus_epi16(_mm_srai_epi16(b, 6), zero);
+
+    __m128i rg = _mm_unpacklo_epi8(r, g);
+    __m128i ba = _mm_unpacklo_epi8(b, alpha);
+    _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i *)(dst + x * 4 + 16),
+                     _mm_unpackhi_epi16(rg, ba));
+  }
+  return x;
+}
+#else
+static int ConvertRowSimd(const uint8_t *y, const uint8_t *u,
+                          const uint8_t *v, int uv_step, uint8_t *dst,
+                          int width) {
+  return 0;
+}
+#endif
+
+void ConvertYuvToRgba(const YuvImage &src, uint8_t *dst, int dst_stride) {
+  for (int row = 0; row < src.height; row++) {
+    const uint8_t *y = src.planes[0] + row * src.strides[0];
+    const uint8_t *u;
+    const uint8_t *v;
+    int uv_step;
+    if (src.format == YuvFormat::kNV12) {
+      u = src.planes[1] + (row / 2) * src.strides[1];
+      v = u + 1;
+      uv_step = 2;
+    } else {
+      u = src.planes[1] + (row / 2) * src.strides[1];
+      v = src.planes[2] + (row / 2) * src.strides[2];
+      uv_step = 1;
+    }
+    uint8_t *dst_row = dst + row * dst_stride;
+    int converted = ConvertRowSimd(y, u, v, uv_step, dst_row, src.width);
+    ConvertRowScalar(y, u, v, uv_step, dst_row, converted, src.width);
+  }
+}
@@ -0,0 +1,24 @@
+#ifndef VIDEO_PLAYER_YUV_CONVERTER_H_
+#define VIDEO_PLAYER_YUV_CONVERTER_H_
+
+#include <cstdint>
+
+enum class YuvFormat {
+  kI420,  // Y, U and V planes
+  kNV12,  // Y plane and interleaved UV plane
+};
+
+// A 4:2:0 image in decoder memory. For kNV12, planes[2] is unused.
+struct YuvImage {
+  YuvFormat format;
+  int width;
+  int height;
+  const uint8_t *planes[3];
+  int strides[3];
+};
+
+// Converts |src| (BT.601, limited range) to RGBA8888. Uses NEON or SSE2
+// kernels when available and scalar code for the remaining pixels.
+void ConvertYuvToRgba(const YuvImage &src, uint8_t *dst, int dst_stride);
+
+#endif  // VIDEO_PLAYER_YUV_CONVERTER_H_
@@ -0,0 +1,217 @@
+// Host tests of the frame hand-off between the decoder and raster threads.
+// They do not depend on Tizen, and are built and run on the host with:
+//
+//   g++ -std=c++17 -pthread -fsanitize=thread -I../src frame_queue_test.cc
+//       ../src/media_clock.cc -o frame_queue_test && ./frame_queue_test
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include "frame_queue.h"
+#include "media_clock.h"
+
+#define EXPECT(condition)                                         \
+  do {                                                            \
+    if (!(condition)) {                                           \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, \
+              #condition);                                        \
+      exit(1);                                                    \
+    }                                                             \
+  } while (0)
+
+struct TestFrame {
+  int64_t pts = 0;  // milliseconds
+  uint32_t serial = 0;
+};
+
+static std::atomic<int> live_frames{0};
+
+static TestFrame *NewFrame(int64_t pts, uint32_t serial) {
+  live_frames++;
+  TestFrame *frame = new TestFrame();
+  frame->pts = pts;
+  frame->serial = serial;
+  return frame;
+}
+
+static void DeleteFrame(TestFrame *frame) {
+  live_frames--;
+  delete frame;
+}
+
+static void TestPresentsDueFrames() {
+  {
+    FrameQueue<TestFrame> queue(DeleteFrame);
+    bool selected = false;
+    for (int64_t pts : {66, 0, 33}) {
+      queue.push(NewFrame(pts, 0));
+    }
+    EXPECT(queue.update(0, 0, &selected)->pts == 0);
+    EXPECT(selected);
+    // Not due yet, so the frame on screen is presented again.
+    EXPECT(queue.update(0, 20, &selected)->pts == 0);
+    EXPECT(!selected);
+    EXPECT(queue.getDuplicatedFrames() == 1);
+    // Frames that were due earlier but never shown are dropped.
+    EXPECT(queue.update(0, 70, &selected)->pts == 66);
+    EXPECT(selected);
+    EXPECT(queue.getDroppedFrames() == 1);
+    EXPECT(!queue.hasPendingFrames());
+  }
+  EXPECT(live_frames == 0);
+}
+
+static void TestDropsFramesOfEarlierSerials() {
+  {
+    FrameQueue<TestFrame> queue(DeleteFrame);
+    bool selected = false;
+    queue.push(NewFrame(0, 1));
+    queue.push(NewFrame(500, 1));
+    EXPECT(queue.update(1, 0, &selected)->pts == 0);
+    EXPECT(queue.hasPendingFrames());
+    // Seek back. Both the queued frame and the pushed one are stale.
+    queue.push(NewFrame(600, 1));
+    queue.push(NewFrame(100, 2));
+    EXPECT(queue.update(2, 100, &selected)->pts == 100);
+    EXPECT(!queue.hasPendingFrames());
+  }
+  EXPECT(live_frames == 0);
+}
+
+static void TestKeepsOrderAcrossDiscontinuities() {
+  {
+    FrameQueue<TestFrame> queue(DeleteFrame);
+    bool selected = false;
+    queue.push(NewFrame(4966, 0));
+    queue.push(NewFrame(5000, 0));
+    // Looped back to the start.
+    queue.push(NewFrame(0, 0));
+    EXPECT(queue.update(0, -1, &selected)->pts == 4966);
+    EXPECT(queue.update(0, -1, &selected)->pts == 5000);
+    EXPECT(queue.update(0, -1, &selected)->pts == 0);
+  }
+  EXPECT(live_frames == 0);
+}
+
+static void TestPresentsInDecodingOrderWithoutClock() {
+  {
+    FrameQueue<TestFrame> queue(DeleteFrame);
+    bool selected = false;
+    queue.push(NewFrame(33, 0));
+    queue.push(NewFrame(66, 0));
+    EXPECT(queue.update(0, -1, &selected)->pts == 33);
+    EXPECT(queue.update(0, -1, &selected)->pts == 66);
+  }
+  EXPECT(live_frames == 0);
+}
+
+static void TestExtrapolatesClock() {
+  MediaClock clock;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT(clock.get(start) == -1);
+  clock.update(1000, true, 2.0, start);
+  EXPECT(clock.get(start + std::chrono::milliseconds(100)) == 1200);
+  // Sampled after the caller read the time.
+  EXPECT(clock.get(start - std::chrono::milliseconds(10)) == 1000);
+  clock.update(1500, false, 2.0, start);
+  EXPECT(clock.get(start + std::chrono::milliseconds(100)) == 1500);
+}
+
+// Pushes frames on a decoder thread while a raster thread presents them and
+// the main thread seeks, then disposes the queue the way VideoPlayer does
+// while frames are still being pushed.
+static void TestConcurrentHandOff() {
+  constexpr int kFrameInterval = 10;  // milliseconds
+  std::atomic<uint32_t> serial{0};
+  std::atomic<bool> decoding{true};
+  std::atomic<bool> presenting{true};
+  std::mutex frame_mutex;
+  bool is_disposed = false;
+  MediaClock clock;
+  auto start = std::chrono::steady_clock::now();
+  clock.update(0, true, 1.0, start);
+  {
+    FrameQueue<TestFrame> queue(DeleteFrame);
+
+    std::thread decoder([&] {
+      int64_t pts = 0;
+      uint32_t decoded_serial = serial;
+      while (decoding) {
+        if (decoded_serial != serial) {
+          decoded_serial = serial;
+          pts = 0;
+        }
+        queue.push(NewFrame(pts, decoded_serial));
+        pts += kFrameInterval;
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+      }
+    });
+
+    std::thread raster([&] {
+      int64_t last_pts = -1;
+      uint32_t last_serial = 0;
+      while (presenting) {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        if (is_disposed) {
+          continue;
+        }
+        uint32_t current_serial = serial;
+        bool selected = false;
+        TestFrame *frame = queue.update(
+            current_serial, clock.get(std::chrono::steady_clock::now()),
+            &selected);
+        if (!frame || !selected) {
+          continue;
+        }
+        // A frame selected by the clock is never older than the previous
+        // one of the same seek, and never from an earlier seek.
+        EXPECT(frame->serial == current_serial);
+        if (frame->serial == last_serial) {
+          EXPECT(frame->pts >= last_pts);
+        }
+        last_serial = frame->serial;
+        last_pts = frame->pts;
+      }
+    });
+
+    for (int i = 0; i < 20; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      // Seek to the start.
+      serial++;
+      clock.update(0, true, 1.0, std::chrono::steady_clock::now());
+    }
+    {
+      std::lock_guard<std::mutex> lock(frame_mutex);
+      is_disposed = true;
+      queue.clear();
+    }
+    // The decoder is stopped only after the raster thread, like the native
+    // players in VideoPlayer::dispose().
+    presenting = false;
+    raster.join();
+    decoding = false;
+    decoder.join();
+    {
+      std::lock_guard<std::mutex> lock(frame_mutex);
+      queue.clear();
+    }
+    EXPECT(live_frames == 0);
+  }
+  EXPECT(live_frames == 0);
+}
+
+int main() {
+  TestPresentsDueFrames();
+  TestDropsFramesOfEarlierSerials();
+  TestKeepsOrderAcrossDiscontinuities();
+  TestPresentsInDecodingOrderWithoutClock();
+  TestExtrapolatesClock();
+  TestConcurrentHandOff();
+  printf("All tests passed.\n");
+  return 0;
+}